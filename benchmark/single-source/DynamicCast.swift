@@ -0,0 +1,110 @@
+//===--- DynamicCast.swift ------------------------------------------------===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2016 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+//  This benchmark tests the performance of repeated dynamic casts between
+//  the same pairs of types, as done when decoding heterogeneous data.
+//===----------------------------------------------------------------------===//
+
+import TestsUtils
+
+protocol Named { var name: Int { get } }
+protocol Sized { var size: Int { get } }
+
+struct Point : Named, Sized {
+  var name: Int { return 1 }
+  var size: Int { return 2 }
+}
+struct Label : Named {
+  var name: Int { return 3 }
+}
+struct Blob {}
+
+class Shape : Named {
+  var name: Int { return 4 }
+}
+class Polygon : Shape {}
+class Square : Polygon {}
+class Circle : Shape {}
+
+@inline(never)
+func makeValues() -> [Any] {
+  return [Point(), Label(), Blob(), 42, "x", Square(), Circle()]
+}
+
+@inline(never)
+func makeShapes() -> [Shape] {
+  return [Square(), Circle(), Polygon(), Shape()]
+}
+
+@inline(never)
+public func run_DynamicCastToProtocol(N: Int) {
+  let values = makeValues()
+  var count = 0
+  for _ in 1...N {
+    for _ in 1...1000 {
+      for value in values {
+        if let named = value as? Named {
+          count += named.name
+        }
+        if let sized = value as? Sized {
+          count += sized.size
+        }
+      }
+    }
+  }
+  CheckResults(count == 14000 * N, "IncorrectResults in DynamicCastToProtocol")
+}
+
+@inline(never)
+public func run_DynamicCastAnyToConcrete(N: Int) {
+  let values = makeValues()
+  var count = 0
+  for _ in 1...N {
+    for _ in 1...1000 {
+      for value in values {
+        if value is Point {
+          count += 1
+        }
+        if let i = value as? Int {
+          count += i
+        }
+        if value is String {
+          count += 1
+        }
+      }
+    }
+  }
+  CheckResults(count == 44000 * N,
+               "IncorrectResults in DynamicCastAnyToConcrete")
+}
+
+@inline(never)
+public func run_DynamicCastClassDowncast(N: Int) {
+  let shapes = makeShapes()
+  var count = 0
+  for _ in 1...N {
+    for _ in 1...1000 {
+      for shape in shapes {
+        if shape is Square {
+          count += 1
+        }
+        if shape is Polygon {
+          count += 1
+        }
+        if shape is Circle {
+          count += 1
+        }
+      }
+    }
+  }
+  CheckResults(count == 4000 * N,
+               "IncorrectResults in DynamicCastClassDowncast")
+}
@@ -0,0 +1,78 @@
+//===--- ProtocolConformance.swift ----------------------------------------===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2016 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+//  This benchmark tests the performance of protocol conformance lookups that
+//  miss the runtime's conformance cache. Every iteration checks conformances
+//  of types it has never seen before, so each check has to consult the
+//  conformance records of the whole process, including those of the
+//  standard library.
+//===----------------------------------------------------------------------===//
+
+import TestsUtils
+
+protocol P0 {}
+protocol P1 {}
+protocol P2 {}
+protocol P3 {}
+protocol P4 {}
+protocol P5 {}
+protocol P6 {}
+protocol P7 {}
+
+protocol Nested {
+  /// Count the protocols of P0...P7 that this type conforms to.
+  static func probe() -> Int
+
+  /// A type that wraps this one.
+  static func wrapped() -> Nested.Type
+}
+
+struct Box<T> : Nested {
+  static func probe() -> Int {
+    let value: Any = Box<T>()
+    var found = 0
+    if value is P0 { found += 1 }
+    if value is P1 { found += 1 }
+    if value is P2 { found += 1 }
+    if value is P3 { found += 1 }
+    if value is P4 { found += 1 }
+    if value is P5 { found += 1 }
+    if value is P6 { found += 1 }
+    if value is P7 { found += 1 }
+    return found
+  }
+
+  static func wrapped() -> Nested.Type {
+    return Box<Box<T>>.self
+  }
+}
+
+extension Box : P0 {}
+extension Box : P2 {}
+extension Box : P4 {}
+extension Box : P6 {}
+
+/// The next type whose conformances have not been looked up yet. Each run
+/// continues from here, so that no lookup is answered from the cache.
+var nextUnseenType: Nested.Type = Box<Int>.self
+
+@inline(never)
+public func run_ProtocolConformanceMiss(N: Int) {
+  var count = 0
+  for _ in 1...N {
+    for _ in 1...100 {
+      count += nextUnseenType.probe()
+      nextUnseenType = nextUnseenType.wrapped()
+    }
+  }
+  CheckResults(count == 400 * N,
+               "IncorrectResults in ProtocolConformanceMiss")
+}
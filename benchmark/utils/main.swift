@@ -45,6 +45,7 @@ import DictionaryBridge
 import DictionaryLiteral
 import DictionaryRemove
 import DictionarySwap
+import DynamicCast
 import ErrorHandling
 import Fibonacci
 import GlobalClass
@@ -71,6 +72,7 @@ import PolymorphicCalls
 import PopFront
 import PopFrontGeneric
 import Prims
+import ProtocolConformance
 import ProtocolDispatch
 import ProtocolDispatch2
 import RC4
@@ -132,6 +134,9 @@ precommitTests = [
   "DictionaryRemoveOfObjects": run_DictionaryRemoveOfObjects,
   "DictionarySwap": run_DictionarySwap,
   "DictionarySwapOfObjects": run_DictionarySwapOfObjects,
+  "DynamicCastAnyToConcrete": run_DynamicCastAnyToConcrete,
+  "DynamicCastClassDowncast": run_DynamicCastClassDowncast,
+  "DynamicCastToProtocol": run_DynamicCastToProtocol,
   "ErrorHandling": run_ErrorHandling,
   "GlobalClass": run_GlobalClass,
   "Hanoi": run_Hanoi,
@@ -178,6 +183,7 @@ precommitTests = [
   "PopFrontArrayGeneric": run_PopFrontArrayGeneric,
   "PopFrontUnsafePointer": run_PopFrontUnsafePointer,
   "Prims": run_Prims,
+  "ProtocolConformanceMiss": run_ProtocolConformanceMiss,
   "ProtocolDispatch": run_ProtocolDispatch,
   "ProtocolDispatch2": run_ProtocolDispatch2,
   "RC4": run_RC4,
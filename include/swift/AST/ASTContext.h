@@ -80,6 +80,7 @@ namespace swift {
   class DiagnosticEngine;
   class Substitution;
   class TypeCheckerDebugConsumer;
+  class ExpressionStatsTracker;
   class DocComment;
 
   enum class KnownProtocolKind : uint8_t;
@@ -224,6 +225,9 @@ public:
   /// A consumer of type checker debug output.
   std::unique_ptr<TypeCheckerDebugConsumer> TypeCheckerDebug;
 
+  /// If set, the type checker records the cost of each expression here.
+  ExpressionStatsTracker *ExpressionStats = nullptr;
+
   /// Cache for names of canonical GenericTypeParamTypes.
   mutable llvm::DenseMap<unsigned, Identifier>
     CanonicalGenericTypeParamTypeNames;
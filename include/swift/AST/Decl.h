@@ -2722,6 +2722,12 @@ class NominalTypeDecl : public GenericTypeDecl, public IterableDeclContext {
   /// Prepare the lookup table to make it ready for lookups.
   void prepareLookupTable(bool ignoreNewExtensions);
 
+  /// Prepare the lookup table for lookups of members with the given base
+  /// name, loading only those members from lazily-loaded contexts.
+  ///
+  /// \returns false if some context could not load members by name.
+  bool prepareLookupTableForName(Identifier name, bool ignoreNewExtensions);
+
   /// Note that we have added a member into the iterable declaration context,
   /// so that it can also be added to the lookup table (if needed).
   void addedMember(Decl *member);
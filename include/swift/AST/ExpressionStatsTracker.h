@@ -0,0 +1,78 @@
+//===--- ExpressionStatsTracker.h - Records expression costs ----*- C++ -*-===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2016 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef SWIFT_EXPRESSIONSTATSTRACKER_H
+#define SWIFT_EXPRESSIONSTATSTRACKER_H
+
+#include "swift/Basic/SourceLoc.h"
+#include <algorithm>
+#include <vector>
+
+namespace swift {
+
+/// The cost of type-checking one expression.
+///
+/// The time and the solver statistics exclude the expressions that were
+/// type-checked separately while checking this one, such as the bodies of
+/// multi-statement closures; those get records of their own.
+struct ExpressionStats {
+  SourceLoc Loc;
+  /// Wall time, in seconds.
+  double WallTime = 0;
+  unsigned NumStatesExplored = 0;
+  unsigned NumDisjunctions = 0;
+  unsigned NumDisjunctionTerms = 0;
+  unsigned NumTypeVariableBindings = 0;
+  unsigned MaxDepth = 0;
+};
+
+/// Keeps the statistics of the expressions that took the longest to
+/// type-check.
+class ExpressionStatsTracker {
+  unsigned Limit;
+
+  /// A min-heap on the wall time, so the cheapest kept expression is the
+  /// first to go.
+  std::vector<ExpressionStats> Worst;
+
+  static bool isMoreExpensive(const ExpressionStats &LHS,
+                              const ExpressionStats &RHS) {
+    return LHS.WallTime > RHS.WallTime;
+  }
+
+public:
+  explicit ExpressionStatsTracker(unsigned Limit) : Limit(Limit) {}
+
+  void add(const ExpressionStats &Stats) {
+    if (Limit == 0)
+      return;
+    if (Worst.size() == Limit) {
+      if (!isMoreExpensive(Stats, Worst.front()))
+        return;
+      std::pop_heap(Worst.begin(), Worst.end(), isMoreExpensive);
+      Worst.pop_back();
+    }
+    Worst.push_back(Stats);
+    std::push_heap(Worst.begin(), Worst.end(), isMoreExpensive);
+  }
+
+  /// Returns the recorded expressions, most expensive first.
+  std::vector<ExpressionStats> getMostExpensive() const {
+    std::vector<ExpressionStats> Result = Worst;
+    std::sort_heap(Result.begin(), Result.end(), isMoreExpensive);
+    return Result;
+  }
+};
+
+} // end namespace swift
+
+#endif // SWIFT_EXPRESSIONSTATSTRACKER_H
@@ -116,6 +116,10 @@ public:
   /// objects.
   unsigned EmitStackPromotionChecks : 1;
 
+  /// Assume that the code is only ever executed on a single thread, and use
+  /// non-atomic reference counting operations.
+  unsigned AssumeSingleThreaded : 1;
+
   /// The maximum number of bytes used on a stack frame for stack promotion
   /// (includes alloc_stack allocations).
   unsigned StackPromotionSizeLimit = 1024;
@@ -156,13 +160,26 @@ public:
   /// measurements on a non-clean build directory.
   unsigned UseIncrementalLLVMCodeGen : 1;
 
+  /// The MD5 hash of everything a multi-threaded compilation depends on: the
+  /// compiler, its arguments, the module's source files and the files it
+  /// imported. Empty if not known.
+  ///
+  /// Every object file records the hash of the inputs it was compiled from,
+  /// so that IR generation can be skipped altogether if all object files of
+  /// the module are up to date. This only helps when no input changed at
+  /// all: the hash covers the whole module, so any change regenerates the IR
+  /// of every file, and the per-object IR hash then decides which objects
+  /// LLVM rebuilds. SIL generation and optimization run in either case.
+  std::vector<uint8_t> InputsHash;
+
   IRGenOptions() : OutputKind(IRGenOutputKind::LLVMAssembly), Verify(true),
                    Optimize(false), Sanitize(SanitizerKind::None),
                    DebugInfoKind(IRGenDebugInfoKind::None),
                    UseJIT(false), DisableLLVMOptzns(false),
                    DisableLLVMARCOpts(false), DisableLLVMSLPVectorizer(false),
                    DisableFPElim(true), Playground(false),
-                   EmitStackPromotionChecks(false), GenerateProfile(false),
+                   EmitStackPromotionChecks(false),
+                   AssumeSingleThreaded(false), GenerateProfile(false),
                    PrintInlineTree(false), EmbedMode(IRGenEmbedMode::None),
                    HasValueNamesSetting(false), ValueNames(false),
                    StripReflectionNames(true), StripReflectionMetadata(true),
@@ -17,6 +17,7 @@
 #ifndef SWIFT_AST_LAZYRESOLVER_H
 #define SWIFT_AST_LAZYRESOLVER_H
 
+#include "swift/AST/Identifier.h"
 #include "swift/AST/TypeLoc.h"
 #include "llvm/ADT/PointerEmbeddedInt.h"
 
@@ -26,7 +27,6 @@ class AssociatedTypeDecl;
 class Decl;
 class DeclContext;
 class ExtensionDecl;
-class Identifier;
 class NominalTypeDecl;
 class NormalProtocolConformance;
 class ProtocolConformance;
@@ -134,6 +134,19 @@ public:
     llvm_unreachable("unimplemented");
   }
 
+  /// Populates the given vector with the members of \p D whose base name is
+  /// \p name, without loading the other members.
+  ///
+  /// The implementation should \em not add the members to D.
+  ///
+  /// \returns false if this loader cannot look up members by name, in which
+  /// case all members have to be loaded instead.
+  virtual bool
+  loadNamedMembers(const Decl *D, Identifier name, uint64_t contextData,
+                   SmallVectorImpl<ValueDecl *> &members) {
+    return false;
+  }
+
   /// Populates the given vector with all conformances for \p D.
   ///
   /// The implementation should \em not call setConformances on \p D.
@@ -613,6 +613,16 @@ public:
     return nullptr;
   }
 
+  /// Look up a type declared directly in \p parent or in one of its
+  /// extensions in this file.
+  ///
+  /// This is only a fast path that avoids loading all of the members of
+  /// \p parent; returning null means "not found here", not "not found".
+  virtual TypeDecl *lookupNestedType(Identifier name,
+                                     const NominalTypeDecl *parent) const {
+    return nullptr;
+  }
+
   /// Find ValueDecls in the module and pass them to the given consumer object.
   ///
   /// This does a simple local lookup, not recursively looking through imports.
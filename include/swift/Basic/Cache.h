@@ -129,6 +129,16 @@ protected:
   /// Invokes \c remove on all keys.
   void removeAll();
 
+  /// Sets the total cost of the values the cache aims to hold.
+  ///
+  /// \param Limit Total cost limit.  Zero means there is no limit.
+  ///
+  /// When the total cost of the cached values exceeds the limit, the least
+  /// recently used values that are not currently retained are evicted until
+  /// the total is within the limit again.  Platforms whose cache evicts its
+  /// values under system memory pressure may ignore the limit.
+  void setCostLimit(size_t Limit);
+
   /// Destroys cache.
   void destroy();
 };
@@ -192,6 +202,11 @@ public:
     removeAll();
   }
 
+  /// Sets the total cost of values to keep; see \c CacheImpl::setCostLimit.
+  void setCostLimit(size_t Limit) {
+    CacheImpl::setCostLimit(Limit);
+  }
+
 private:
   static uintptr_t keyHash(void *Key, void *UserData) {
     return KeyInfoT::getHashValue(*static_cast<KeyT*>(Key));
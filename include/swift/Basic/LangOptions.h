@@ -112,6 +112,10 @@ namespace swift {
     /// \brief Enable the iterative type checker.
     bool IterativeTypeChecker = false;
 
+    /// \brief Only deserialize the members of an imported type that have
+    /// the name being looked up, rather than all of them.
+    bool NamedLazyMemberLoading = false;
+
     /// Debug the generic signatures computed by the archetype builder.
     bool DebugGenericSignatures = false;
 
@@ -130,6 +134,10 @@ namespace swift {
     /// allocated by the constraint solver.
     unsigned SolverMemoryThreshold = 15000000;
 
+    /// \brief If non-zero, warn when type-checking an expression takes longer
+    /// than this many milliseconds.
+    unsigned WarnLongExpressionTypeChecking = 0;
+
     /// \brief Perform all dynamic allocations using malloc/free instead of
     /// optimized custom allocator, so that memory debugging tools can be used.
     bool UseMalloc = false;
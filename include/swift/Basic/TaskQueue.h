@@ -15,6 +15,7 @@
 
 #include "swift/Basic/LLVM.h"
 #include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/Optional.h"
 #include "llvm/Config/config.h"
 #include "llvm/Support/Program.h"
 
@@ -29,6 +30,17 @@ class Task; // forward declared to allow for platform-specific implementations
 
 typedef llvm::sys::ProcessInfo::ProcessId ProcessId;
 
+/// \brief The resources used by a task that has finished, as reported by the
+/// operating system.
+struct TaskResourceUsage {
+  /// The CPU time spent in user mode, in microseconds.
+  uint64_t UserTime;
+  /// The CPU time spent in the kernel on the task's behalf, in microseconds.
+  uint64_t SystemTime;
+  /// The largest resident set size of the task, in bytes.
+  uint64_t MaxResidentSetSize;
+};
+
 /// \brief Indicates how a TaskQueue should respond to the task finished event.
 enum class TaskFinishedResponse {
   /// Indicates that execution should continue.
@@ -72,12 +84,16 @@ public:
   /// \param ReturnCode the return code of the task which finished execution.
   /// \param Output the output from the task which finished execution,
   /// if available. (This may not be available on all platforms.)
+  /// \param Usage the resources used by the task, if available. (This may
+  /// not be available on all platforms.)
   /// \param Context the context which was passed when the task was added
   ///
   /// \returns true if further execution of tasks should stop,
   /// false if execution should continue
   typedef std::function<TaskFinishedResponse(ProcessId Pid, int ReturnCode,
-                                             StringRef Output, void *Context)>
+                                             StringRef Output,
+                                             Optional<TaskResourceUsage> Usage,
+                                             void *Context)>
     TaskFinishedCallback;
 
   /// \brief A callback which will be executed if a task exited abnormally due
@@ -88,12 +104,16 @@ public:
   /// no reason could be deduced, this may be empty.
   /// \param Output the output from the task which exited abnormally, if
   /// available. (This may not be available on all platforms.)
+  /// \param Usage the resources used by the task, if available. (This may
+  /// not be available on all platforms.)
   /// \param Context the context which was passed when the task was added
   ///
   /// \returns a TaskFinishedResponse indicating whether or not execution
   /// should proceed
   typedef std::function<TaskFinishedResponse(ProcessId Pid, StringRef ErrorMsg,
-                                             StringRef Output, void *Context)>
+                                             StringRef Output,
+                                             Optional<TaskResourceUsage> Usage,
+                                             void *Context)>
     TaskSignalledCallback;
 #pragma clang diagnostic pop
 
@@ -16,6 +16,7 @@
 #include "swift/Basic/LLVM.h"
 #include "llvm/ADT/Optional.h"
 #include "llvm/Support/Timer.h"
+#include <atomic>
 
 namespace swift {
   /// A convenience class for declaring a timer that's part of the Swift
@@ -26,23 +27,29 @@ namespace swift {
       Skipped,
       Enabled
     };
-    static State CompilationTimersEnabled;
+    /// Atomic because timers are also created on the threads of
+    /// multi-threaded LLVM code generation.
+    static std::atomic<State> CompilationTimersEnabled;
 
     Optional<llvm::NamedRegionTimer> Timer;
 
   public:
     explicit SharedTimer(StringRef name) {
-      if (CompilationTimersEnabled == State::Enabled)
+      if (CompilationTimersEnabled.load(std::memory_order_relaxed) ==
+          State::Enabled)
         Timer.emplace(name, StringRef("Swift compilation"));
       else
-        CompilationTimersEnabled = State::Skipped;
+        CompilationTimersEnabled.store(State::Skipped,
+                                       std::memory_order_relaxed);
     }
 
     /// Must be called before any SharedTimers have been created.
     static void enableCompilationTimers() {
-      assert(CompilationTimersEnabled != State::Skipped &&
+      assert(CompilationTimersEnabled.load(std::memory_order_relaxed) !=
+               State::Skipped &&
              "a timer has already been created");
-      CompilationTimersEnabled = State::Enabled;
+      CompilationTimersEnabled.store(State::Enabled,
+                                     std::memory_order_relaxed);
     }
   };
 }
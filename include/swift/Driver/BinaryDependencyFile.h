@@ -0,0 +1,139 @@
+//===--- BinaryDependencyFile.h - Binary reference dependencies -*- C++ -*-===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2016 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+//
+// A binary form of the reference dependencies (".swiftdeps") files that the
+// frontend emits and the driver reads for incremental builds. It carries the
+// same information as the YAML form, but the driver can read it in place,
+// without parsing or unescaping anything.
+//
+// The layout is:
+//
+//   magic            4 bytes: "\0SDP"
+//   version          uint32
+//   entry count      uint32
+//   string count     uint32
+//   interface hash   uint32 string index, or NoString
+//   entries          entry count x { uint32 string index, uint8 section,
+//                                    uint8 is-cascading }
+//   string offsets   (string count + 1) x uint32, relative to string data
+//   string data
+//
+// All integers are little-endian. Every distinct string is stored once. The
+// string of a member entry is the base name and the member name separated by
+// a NUL character, which is how DependencyGraph keys members.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef SWIFT_DRIVER_BINARYDEPENDENCYFILE_H
+#define SWIFT_DRIVER_BINARYDEPENDENCYFILE_H
+
+#include "swift/Basic/LLVM.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringRef.h"
+#include <vector>
+
+namespace swift {
+
+/// The sections of a reference dependencies file.
+enum class DependencySection : uint8_t {
+  ProvidesTopLevel,
+  ProvidesNominal,
+  ProvidesMember,
+  ProvidesDynamicLookup,
+  DependsTopLevel,
+  DependsNominal,
+  DependsMember,
+  DependsDynamicLookup,
+  DependsExternal,
+
+  Last_DependencySection = DependsExternal
+};
+
+/// Returns the key of \p section in the YAML form, such as
+/// "provides-top-level".
+StringRef getDependencySectionName(DependencySection section);
+
+/// Returns true if entries of \p section name a member of a type.
+static inline bool isMemberDependencySection(DependencySection section) {
+  return section == DependencySection::ProvidesMember ||
+         section == DependencySection::DependsMember;
+}
+
+/// Collects the entries of a reference dependencies file and writes them in
+/// the binary form.
+class BinaryDependencyFileWriter {
+  struct Entry {
+    uint32_t String;
+    DependencySection Section;
+    bool IsCascading;
+  };
+
+  llvm::StringMap<uint32_t> StringIndices;
+  std::vector<StringRef> Strings;
+  std::vector<Entry> Entries;
+  uint32_t InterfaceHash;
+
+  uint32_t intern(StringRef string);
+
+public:
+  BinaryDependencyFileWriter();
+
+  void addName(DependencySection section, StringRef name,
+               bool isCascading = true);
+  void addMember(DependencySection section, StringRef base, StringRef member,
+                 bool isCascading = true);
+  void setInterfaceHash(StringRef hash);
+
+  void write(raw_ostream &out) const;
+};
+
+/// Reads a binary reference dependencies file in place.
+///
+/// The whole file is validated up front, so reading entries cannot fail.
+/// Strings point into the file's data.
+class BinaryDependencyFileReader {
+  const char *EntryData = nullptr;
+  const char *OffsetData = nullptr;
+  const char *StringData = nullptr;
+  uint32_t NumEntries = 0;
+  uint32_t InterfaceHash = NoString;
+
+  StringRef getString(uint32_t index) const;
+
+public:
+  struct Entry {
+    DependencySection Section;
+    StringRef Name;
+    bool IsCascading;
+  };
+
+  static const uint32_t Version = 1;
+  static const uint32_t NoString = ~0U;
+
+  /// Returns true if \p data looks like a binary dependencies file rather
+  /// than a YAML one.
+  static bool isBinaryDependencyFile(StringRef data);
+
+  /// Prepares to read \p data, which must outlive the reader. Returns false
+  /// if \p data is not a well-formed binary dependencies file.
+  bool initialize(StringRef data);
+
+  unsigned getNumEntries() const { return NumEntries; }
+  Entry getEntry(unsigned index) const;
+
+  /// Returns the interface hash, or None if the file does not have one.
+  Optional<StringRef> getInterfaceHash() const;
+};
+
+} // end namespace swift
+
+#endif
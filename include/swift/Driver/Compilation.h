@@ -132,6 +132,11 @@ private:
   /// rebuilt.
   bool ShowIncrementalBuildDecisions = false;
 
+  /// Indicates whether compile jobs that are ready to run at the same time
+  /// should be combined into one frontend invocation per batch, with several
+  /// primary files each.
+  bool EnableBatchMode = false;
+
   static const Job *unwrap(const std::unique_ptr<const Job> &p) {
     return p.get();
   }
@@ -189,6 +194,13 @@ public:
     ShowIncrementalBuildDecisions = value;
   }
 
+  bool getBatchModeEnabled() const {
+    return EnableBatchMode;
+  }
+  void enableBatchMode(bool value = true) {
+    EnableBatchMode = value;
+  }
+
   void setCompilationRecordPath(StringRef path) {
     assert(CompilationRecordPath.empty() && "already set");
     CompilationRecordPath = path;
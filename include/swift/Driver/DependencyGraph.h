@@ -15,6 +15,7 @@
 
 #include "swift/Basic/LLVM.h"
 #include "swift/Basic/OptionSet.h"
+#include "swift/Driver/BinaryDependencyFile.h"
 #include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/iterator_range.h"
@@ -44,6 +45,10 @@ public:
   /// It is only used in the implementation.
   enum class DependencyKind : uint8_t;
 
+  /// One entry of a dependencies file: a name that a file provides or
+  /// depends on.
+  using DependencyFileEntry = BinaryDependencyFileReader::Entry;
+
   /// Describes the result of loading a dependency file for a particular node.
   enum class LoadResult {
     /// There was an error loading the file; the entire graph should be
@@ -129,6 +134,17 @@ private:
   /// \sa SourceFile::getInterfaceHash
   llvm::DenseMap<const void *, std::string> InterfaceHashes;
 
+  using DependencyCallbackTy = LoadResult(StringRef, DependencyKind, bool);
+  using InterfaceHashCallbackTy = LoadResult(StringRef);
+  using ParserTy =
+    LoadResult(llvm::function_ref<DependencyCallbackTy> providesCallback,
+               llvm::function_ref<DependencyCallbackTy> dependsCallback,
+               llvm::function_ref<InterfaceHashCallbackTy>
+                 interfaceHashCallback);
+
+  /// Loads the data for \p node that \p parse reports through its callbacks.
+  LoadResult loadWithParser(const void *node, llvm::function_ref<ParserTy> parse);
+
   LoadResult loadFromBuffer(const void *node, llvm::MemoryBuffer &buffer);
 
   // FIXME: We should be able to use llvm::mapped_iterator for this, but
@@ -161,6 +177,9 @@ private:
 protected:
   LoadResult loadFromString(const void *node, StringRef data);
   LoadResult loadFromPath(const void *node, StringRef path);
+  LoadResult loadFromEntries(const void *node,
+                             Optional<StringRef> interfaceHash,
+                             ArrayRef<DependencyFileEntry> entries);
 
   void addIndependentNode(const void *node) {
     bool newlyInserted = Provides.insert({node, {}}).second;
@@ -183,6 +202,16 @@ protected:
   }
 
 public:
+  /// Reads the dependencies file in \p buffer, in either form, and reports
+  /// its interface hash and entries in the order they appear.
+  ///
+  /// \returns false if the file is malformed
+  static bool
+  readDependencyFile(llvm::MemoryBuffer &buffer,
+                     llvm::function_ref<void(StringRef)> interfaceHashCallback,
+                     llvm::function_ref<void(const DependencyFileEntry &)>
+                       entryCallback);
+
   llvm::iterator_range<StringSetIterator> getExternalDependencies() const {
     return llvm::make_range(StringSetIterator(ExternalDependencies.begin()),
                             StringSetIterator(ExternalDependencies.end()));
@@ -258,6 +287,17 @@ public:
                                                data);
   }
 
+  /// Load "depends" and "provides" data for \p node from entries that were
+  /// read from its dependencies file earlier, such as the ones recorded in a
+  /// DependencyGraphCache.
+  ///
+  /// \sa loadFromPath
+  LoadResult loadFromEntries(T node, Optional<StringRef> interfaceHash,
+                             ArrayRef<DependencyFileEntry> entries) {
+    return DependencyGraphImpl::loadFromEntries(
+      Traits::getAsVoidPointer(node), interfaceHash, entries);
+  }
+
   /// Adds \p node to the dependency graph without any connections.
   ///
   /// This can be used for new nodes that may be updated later.
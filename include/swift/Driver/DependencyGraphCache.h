@@ -0,0 +1,117 @@
+//===--- DependencyGraphCache.h - Cached dependencies files -----*- C++ -*-===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2016 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+//
+// A single file, written next to the build record, that holds the parsed
+// entries of the reference dependencies file of every job in a build. The
+// next incremental build reads it once. A dependencies file that has not
+// changed since is then neither opened nor parsed: it costs a stat, and its
+// recorded entries are added to the dependency graph as they are.
+//
+// The layout is:
+//
+//   magic            4 bytes: "\0SDC"
+//   version          uint32
+//   file count       uint32
+//   files            file count x {
+//                      uint64 seconds, uint32 nanoseconds, uint64 size,
+//                      uint32 path size, uint32 interface hash size or
+//                      NoInterfaceHash, uint32 entry count,
+//                      path, interface hash,
+//                      entry count x { uint8 section, uint8 is-cascading,
+//                                      uint32 name size, name }
+//                    }
+//
+// All integers are little-endian. Names are as in BinaryDependencyFile.h.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef SWIFT_DRIVER_DEPENDENCYGRAPHCACHE_H
+#define SWIFT_DRIVER_DEPENDENCYGRAPHCACHE_H
+
+#include "swift/Basic/LLVM.h"
+#include "swift/Driver/DependencyGraph.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/TimeValue.h"
+#include <memory>
+#include <vector>
+
+namespace swift {
+
+/// The parsed reference dependencies files of the previous build, keyed by
+/// path.
+class DependencyGraphCache {
+public:
+  using DependencyFileEntry = DependencyGraphImpl::DependencyFileEntry;
+
+  /// What was recorded for one dependencies file.
+  struct Dependencies {
+    Optional<StringRef> InterfaceHash;
+    ArrayRef<DependencyFileEntry> Entries;
+  };
+
+private:
+  struct File {
+    llvm::sys::TimeValue ModTime;
+    uint64_t Size;
+    Optional<StringRef> InterfaceHash;
+    std::vector<DependencyFileEntry> Entries;
+  };
+
+  std::unique_ptr<llvm::MemoryBuffer> Buffer;
+  llvm::StringMap<File> Files;
+
+  bool parse(StringRef data);
+
+  /// Returns the recorded file at \p path if it has not changed since.
+  const File *lookupFile(StringRef path) const;
+
+public:
+  static const uint32_t Version = 2;
+  static const uint32_t NoInterfaceHash = ~0U;
+
+  /// Loads the cache at \p path. A missing or malformed cache is treated as
+  /// an empty one, so this returns false only to say that nothing was
+  /// loaded.
+  bool loadFromPath(StringRef path);
+
+  /// Loads the cache from \p data, which must outlive this cache.
+  ///
+  /// This is only intended for testing purposes.
+  bool loadFromString(StringRef data);
+
+  /// Returns what was recorded for the dependencies file at \p path, or None
+  /// if nothing was or if the file's size or modification time no longer
+  /// match the recorded ones.
+  ///
+  /// This only stats \p path; it never reads it.
+  Optional<Dependencies> lookup(StringRef path) const;
+
+  /// Returns true if the cache records exactly the dependencies files at
+  /// \p paths, and none of them changed since, so that there is no need to
+  /// write it again.
+  bool isUpToDate(ArrayRef<StringRef> paths) const;
+
+  /// Writes a new cache for the dependencies files at \p paths to \p out.
+  ///
+  /// The entries recorded in this cache are reused for files that have not
+  /// changed; only the others are read and parsed. Files that cannot be read
+  /// or parsed are left out. So are files modified in the same second as
+  /// this call, because a later change in that second might not change their
+  /// modification time on file systems with coarse timestamps.
+  void write(raw_ostream &out, ArrayRef<StringRef> paths) const;
+};
+
+} // end namespace swift
+
+#endif
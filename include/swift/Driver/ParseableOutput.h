@@ -33,13 +33,17 @@ using swift::sys::ProcessId;
 /// \brief Emits a "began" message to the given stream.
 void emitBeganMessage(raw_ostream &os, const Job &Cmd, ProcessId Pid);
 
-/// \brief Emits a "finished" message to the given stream.
+/// \brief Emits a "finished" message to the given stream, including the
+/// resources the task used if they are known.
 void emitFinishedMessage(raw_ostream &os, const Job &Cmd, ProcessId Pid,
-                         int ExitStatus, StringRef Output);
+                         int ExitStatus, StringRef Output,
+                         Optional<sys::TaskResourceUsage> Usage = None);
 
-/// \brief Emits a "signalled" message to the given stream.
+/// \brief Emits a "signalled" message to the given stream, including the
+/// resources the task used if they are known.
 void emitSignalledMessage(raw_ostream &os, const Job &Cmd, ProcessId Pid,
-                          StringRef ErrorMsg, StringRef Output);
+                          StringRef ErrorMsg, StringRef Output,
+                          Optional<sys::TaskResourceUsage> Usage = None);
 
 /// \brief Emits a "skipped" message to the given stream.
 void emitSkippedMessage(raw_ostream &os, const Job &Cmd);
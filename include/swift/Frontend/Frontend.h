@@ -26,6 +26,7 @@
 #include "swift/AST/IRGenOptions.h"
 #include "swift/AST/LinkLibrary.h"
 #include "swift/AST/Module.h"
+#include "swift/AST/ReferencedNameTracker.h"
 #include "swift/AST/SearchPathOptions.h"
 #include "swift/AST/SILOptions.h"
 #include "swift/Parse/CodeCompletionCallbacks.h"
@@ -313,9 +314,27 @@ class CompilerInstance {
 
   SourceFile *PrimarySourceFile = nullptr;
 
+  /// In batch mode, maps the buffer ID of each primary input to its position
+  /// in FrontendOptions::BatchPrimaryInputs.
+  llvm::SmallDenseMap<unsigned, unsigned, 4> BatchPrimaryBufferIDs;
+
+  /// In batch mode, the source file of each primary input, in the order of
+  /// FrontendOptions::BatchPrimaryInputs.
+  SmallVector<SourceFile *, 4> BatchPrimarySourceFiles;
+
+  /// In batch mode, the name trackers of the primary inputs other than the
+  /// first, which uses NameTracker.
+  std::vector<std::unique_ptr<ReferencedNameTracker>> BatchNameTrackers;
+
   void createSILModule(bool WholeModule = false);
   void setPrimarySourceFile(SourceFile *SF);
 
+  /// Notes that \p SF was created for one of the inputs, and makes it a
+  /// primary source file if its input is one.
+  void recordSourceFile(SourceFile *SF, unsigned BufferID);
+
+  bool isPrimarySourceFile(const SourceFile *SF) const;
+
 public:
   SourceManager &getSourceMgr() { return SourceMgr; }
 
@@ -386,6 +405,13 @@ public:
   /// \returns the primary SourceFile, or nullptr if there is no primary input
   SourceFile *getPrimarySourceFile() { return PrimarySourceFile; }
 
+  /// In batch mode, gets the primary SourceFiles in the order of
+  /// FrontendOptions::BatchPrimaryInputs. The first of them is the one
+  /// returned by getPrimarySourceFile(). Outside batch mode, this is empty.
+  ArrayRef<SourceFile *> getBatchPrimarySourceFiles() const {
+    return BatchPrimarySourceFiles;
+  }
+
   /// \brief Returns true if there was an error during setup.
   bool setup(const CompilerInvocation &Invocation);
 
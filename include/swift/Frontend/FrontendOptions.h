@@ -74,6 +74,24 @@ public:
   /// be generated for the whole module.
   Optional<SelectedInput> PrimaryInput;
 
+  /// In batch mode, every input for which output should be generated, in the
+  /// order they were given; PrimaryInput is the first of them. Empty when
+  /// there is at most one primary input.
+  std::vector<SelectedInput> BatchPrimaryInputs;
+
+  /// The paths to which the outputs for one input of a batch are written.
+  struct BatchOutputPaths {
+    std::string OutputFilename;
+    std::string ModuleOutputPath;
+    std::string ModuleDocOutputPath;
+    std::string DependenciesFilePath;
+    std::string ReferenceDependenciesFilePath;
+  };
+
+  /// In batch mode, the outputs for each of BatchPrimaryInputs, in the same
+  /// order.
+  std::vector<BatchOutputPaths> BatchOutputs;
+
   /// The kind of input on which the frontend should operate.
   InputFileKind InputKind = InputFileKind::IFK_Swift;
 
@@ -112,6 +130,10 @@ public:
   /// The path to which we should output a Swift reference dependencies file.
   std::string ReferenceDependenciesFilePath;
 
+  /// Write the reference dependencies file in the binary form rather than
+  /// as YAML.
+  bool EmitBinaryReferenceDependencies = false;
+
   /// The path to which we should output a fixits as source edits.
   std::string FixitsOutputPath;
 
@@ -169,6 +191,13 @@ public:
   /// If set, dumps wall time taken to check each function body to llvm::errs().
   bool DebugTimeFunctionBodies = false;
 
+  /// The path to which to write the statistics of the expressions that took
+  /// the longest to type-check, if any.
+  std::string ExpressionStatsPath;
+
+  /// The number of expressions listed in ExpressionStatsPath.
+  unsigned NumExpressionStats = 10;
+
   /// If set, prints the time taken in each major compilation phase to 
   /// llvm::errs().
   ///
@@ -179,6 +208,13 @@ public:
   /// until the end of all files.
   bool DelayedFunctionBodyParsing = false;
 
+  /// Indicates whether function bodies in non-primary files should be
+  /// skipped instead of parsed.
+  ///
+  /// Those bodies are never type-checked or emitted, so only the
+  /// declarations around them matter to the job.
+  bool SkipNonPrimaryFunctionBodies = false;
+
   /// Indicates whether or not an import statement can pick up a Swift source
   /// file (as opposed to a module file).
   bool EnableSourceImport = false;
@@ -244,6 +280,14 @@ public:
   /// Indicates a debug crash mode for the frontend.
   DebugCrashMode CrashMode = DebugCrashMode::None;
 
+  /// Indicates whether output should be generated for more than one primary
+  /// input, sharing a single ASTContext.
+  bool isInBatchMode() const { return !BatchPrimaryInputs.empty(); }
+
+  /// Returns these options as they apply to the \p index-th input of a
+  /// batch: with that input as the only primary input, writing its outputs.
+  FrontendOptions getOptionsForBatchPrimaryInput(unsigned index) const;
+
   /// Indicates whether the RequestedAction has output.
   bool actionHasOutput() const;
 
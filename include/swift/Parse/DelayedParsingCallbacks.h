@@ -44,6 +44,17 @@ class AlwaysDelayedCallbacks : public DelayedParsingCallbacks {
   }
 };
 
+/// Skips every function body, for files whose bodies will never be
+/// type-checked.
+class AlwaysSkippedCallbacks : public DelayedParsingCallbacks {
+  bool shouldDelayFunctionBodyParsing(Parser &TheParser,
+                                      AbstractFunctionDecl *AFD,
+                                      const DeclAttributes &Attrs,
+                                      SourceRange BodyRange) override {
+    return false;
+  }
+};
+
 /// \brief Implementation of callbacks that guide the parser in delayed
 /// parsing for code completion.
 class CodeCompleteDelayedCallbacks : public DelayedParsingCallbacks {
@@ -14,6 +14,9 @@
 #include <iterator>
 #include <atomic>
 #include <stdint.h>
+#include <assert.h>
+#include <new>
+#include <utility>
 
 #if defined(__FreeBSD__)
 #include <stdio.h>
@@ -123,9 +126,28 @@ template <class ElemTy> struct ConcurrentList {
   std::atomic<ConcurrentListNode<ElemTy> *> First;
 };
 
-/// A concurrent map that is implemented using a binary tree. It supports
-/// concurrent insertions but does not support removals or rebalancing of
-/// the tree.
+/// A concurrent map that is implemented using an open-addressed hash table
+/// with linear probing. It supports concurrent insertions and lookups but
+/// does not support removals.
+///
+/// Lookups are wait-free: they never retry and never block. Insertions are
+/// lock-free: a thread inserts a node by publishing it into an empty slot
+/// with a single compare-and-swap.
+///
+/// When a table becomes too full, a new table of twice the size is chained
+/// from it and its contents are migrated. Migration freezes every slot of
+/// the old table by setting the low bit of the slot, so that no new node can
+/// be published into it, and then copies the frozen nodes into the new table.
+/// Any inserting thread that observes a frozen slot helps to finish the
+/// migration before it inserts into the new table, which guarantees that a
+/// key is never present in two nodes. Readers that observe a frozen empty
+/// slot simply continue their search in the next table.
+///
+/// Nodes never move once allocated, so pointers to entries stay valid for
+/// the lifetime of the map. Retired tables are kept in the chain until the
+/// map is destroyed because concurrent readers may still be probing them;
+/// since each table is twice the size of its predecessor this costs at most
+/// as much memory as the current table.
 ///
 /// The entry type must provide the following operations:
 ///
@@ -133,83 +155,244 @@ template <class ElemTy> struct ConcurrentList {
 ///   long getKeyIntValueForDump() const;
 ///
 ///   /// A ternary comparison.  KeyTy is the type of the key provided
-///   /// to find or getOrInsert.
+///   /// to find or getOrInsert.  Only equality is significant to the map.
 ///   int compareWithKey(KeyTy key) const;
 ///
+///   /// Hash a key.  Keys that compare equal must have equal hashes.
+///   static size_t getKeyHash(KeyTy key);
+///
 ///   /// Return the amount of extra trailing space required by an entry,
 ///   /// where KeyTy is the type of the first argument to getOrInsert and
 ///   /// ArgTys is the type of the remaining arguments.
 ///   static size_t getExtraAllocationSize(KeyTy key, ArgTys...)
 template <class EntryTy> class ConcurrentMap {
   struct Node {
-    std::atomic<Node*> Left;
-    std::atomic<Node*> Right;
+    /// The full hash of the key, cached so that probing and migration never
+    /// need to rehash.
+    size_t Hash;
     EntryTy Payload;
 
     template <class... Args>
-    Node(Args &&... args)
-      : Left(nullptr), Right(nullptr), Payload(std::forward<Args>(args)...) {}
+    Node(size_t hash, Args &&... args)
+      : Hash(hash), Payload(std::forward<Args>(args)...) {}
 
     Node(const Node &) = delete;
     Node &operator=(const Node &) = delete;
+  };
+
+  static_assert(alignof(Node) >= 2, "slot tagging needs a free low bit");
+
+  /// A slot value that marks an empty slot that was frozen by a migration.
+  static constexpr uintptr_t FrozenEmpty = 1;
+
+  /// The tag bit that marks a frozen slot.
+  static constexpr uintptr_t FrozenBit = 1;
 
-    ~Node() {
-      // These can be relaxed accesses because there is no safe way for
-      // another thread to race an access to this node with our destruction
-      // of it.
-      ::delete Left.load(std::memory_order_relaxed);
-      ::delete Right.load(std::memory_order_relaxed);
+  static Node *getNode(uintptr_t slot) {
+    return reinterpret_cast<Node *>(slot & ~FrozenBit);
+  }
+
+  /// A single power-of-two sized table of slots. The slots are tail-allocated.
+  struct Table {
+    /// The table that the contents of this table are being migrated to, or
+    /// null if no migration has been started.
+    std::atomic<Table *> Next;
+
+    /// The number of occupied slots. This is only a heuristic used to decide
+    /// when to grow; probing never relies on it.
+    std::atomic<size_t> Count;
+
+    /// The number of slots minus one.
+    size_t Mask;
+
+    std::atomic<uintptr_t> *slots() {
+      return reinterpret_cast<std::atomic<uintptr_t> *>(this + 1);
     }
 
-#ifndef NDEBUG
-    void dump() const {
-      auto L = Left.load(std::memory_order_acquire);
-      auto R = Right.load(std::memory_order_acquire);
-      printf("\"%p\" [ label = \" {<f0> %08lx | {<f1> | <f2>}}\" "
-             "style=\"rounded\" shape=\"record\"];\n",
-             this, (long) Payload.getKeyValueForDump());
-
-      if (L) {
-        L->dump();
-        printf("\"%p\":f1 -> \"%p\":f0;\n", this, L);
+    size_t capacity() const { return Mask + 1; }
+
+    /// Grow once the table is three quarters full.
+    bool isFull() const {
+      return Count.load(std::memory_order_relaxed) >= capacity() / 4 * 3;
+    }
+
+    static Table *allocate(size_t capacity) {
+      assert((capacity & (capacity - 1)) == 0 && "capacity not a power of 2");
+      void *memory = ::operator new(sizeof(Table) +
+                                    capacity * sizeof(std::atomic<uintptr_t>));
+      auto table = ::new (memory) Table();
+      table->Next.store(nullptr, std::memory_order_relaxed);
+      table->Count.store(0, std::memory_order_relaxed);
+      table->Mask = capacity - 1;
+      auto slots = table->slots();
+      for (size_t i = 0; i != capacity; ++i)
+        ::new (&slots[i]) std::atomic<uintptr_t>(0);
+      return table;
+    }
+
+    static void deallocate(Table *table) {
+      table->~Table();
+      ::operator delete(table);
+    }
+  };
+
+  /// The number of slots in the first table.
+  static constexpr size_t InitialCapacity = 16;
+
+  /// The table that new insertions should start from.
+  std::atomic<Table *> Current;
+
+  /// The first table that was ever allocated, which heads the chain of all
+  /// tables, live and retired.
+  std::atomic<Table *> First;
+
+  /// Return the current table, allocating the initial table if necessary.
+  Table *getOrCreateCurrent() {
+    Table *current = Current.load(std::memory_order_acquire);
+    if (current)
+      return current;
+
+    Table *fresh = Table::allocate(InitialCapacity);
+    Table *expected = nullptr;
+    if (!First.compare_exchange_strong(expected, fresh,
+                                       std::memory_order_acq_rel,
+                                       std::memory_order_acquire)) {
+      Table::deallocate(fresh);
+      fresh = expected;
+    }
+    expected = nullptr;
+    Current.compare_exchange_strong(expected, fresh,
+                                    std::memory_order_release,
+                                    std::memory_order_relaxed);
+    return Current.load(std::memory_order_acquire);
+  }
+
+  /// Insert an already-allocated node that was frozen in a predecessor of
+  /// \p table. This is idempotent, so several threads may help to migrate
+  /// the same node.
+  static void migrateNode(Table *table, Node *node) {
+    auto slots = table->slots();
+    size_t index = node->Hash & table->Mask;
+    for (size_t probes = 0; probes <= table->Mask; ++probes) {
+      auto &slot = slots[index];
+      uintptr_t value = slot.load(std::memory_order_acquire);
+      while (value == 0) {
+        if (slot.compare_exchange_weak(value, uintptr_t(node),
+                                       std::memory_order_release,
+                                       std::memory_order_acquire)) {
+          table->Count.fetch_add(1, std::memory_order_relaxed);
+          return;
+        }
       }
-      if (R) {
-        R->dump();
-        printf("\"%p\":f2 -> \"%p\":f0;\n", this, R);
+
+      // The node is already present; another thread migrated it.
+      if (getNode(value) == node)
+        return;
+
+      // This table is itself being migrated. Anything that was here before
+      // the freeze will be carried over, so carry on in the next table.
+      if (value == FrozenEmpty) {
+        migrateNode(table->Next.load(std::memory_order_acquire), node);
+        return;
       }
+
+      index = (index + 1) & table->Mask;
     }
-#endif
-  };
+    assert(false && "migration target table overflowed");
+  }
+
+  /// Freeze every slot of \p table and copy its nodes into \p next, then
+  /// advance Current past \p table.
+  void migrate(Table *table, Table *next) {
+    auto slots = table->slots();
+    for (size_t i = 0; i <= table->Mask; ++i) {
+      uintptr_t value = slots[i].load(std::memory_order_acquire);
+      while (!(value & FrozenBit)) {
+        uintptr_t frozen = value ? (value | FrozenBit) : FrozenEmpty;
+        if (slots[i].compare_exchange_weak(value, frozen,
+                                           std::memory_order_acq_rel,
+                                           std::memory_order_acquire)) {
+          value = frozen;
+          break;
+        }
+      }
 
-  /// The root of the tree.
-  std::atomic<Node*> Root;
+      if (value != FrozenEmpty)
+        migrateNode(next, getNode(value));
+    }
+
+    // Publish the new table, unless somebody already advanced beyond it.
+    // Tables in the chain strictly grow, so the mask orders them.
+    Table *current = Current.load(std::memory_order_acquire);
+    while (current->Mask < next->Mask &&
+           !Current.compare_exchange_weak(current, next,
+                                          std::memory_order_release,
+                                          std::memory_order_acquire)) {
+    }
+  }
 
-  /// This member stores the address of the last node that was found by the
-  /// search procedure. We cache the last search to accelerate code that
-  /// searches the same value in a loop.
-  std::atomic<Node*> LastSearch;
+  /// Start (or join) the migration of \p table into a bigger table, and
+  /// return the bigger table once the migration is complete.
+  Table *grow(Table *table) {
+    Table *next = table->Next.load(std::memory_order_acquire);
+    if (!next) {
+      Table *fresh = Table::allocate(table->capacity() * 2);
+      if (table->Next.compare_exchange_strong(next, fresh,
+                                              std::memory_order_acq_rel,
+                                              std::memory_order_acquire)) {
+        next = fresh;
+      } else {
+        Table::deallocate(fresh);
+      }
+    }
+    migrate(table, next);
+    return next;
+  }
 
 public:
-  constexpr ConcurrentMap() : Root(nullptr), LastSearch(nullptr) {}
+  constexpr ConcurrentMap() : Current(nullptr), First(nullptr) {}
 
   ConcurrentMap(const ConcurrentMap &) = delete;
   ConcurrentMap &operator=(const ConcurrentMap &) = delete;
 
   ~ConcurrentMap() {
-    ::delete Root.load(std::memory_order_relaxed);
+    // Every node lives in the last table of the chain, since migrations
+    // always run to completion before anything is inserted into a new table.
+    // These can be relaxed accesses because there is no safe way for
+    // another thread to race an access to the map with our destruction of it.
+    Table *table = First.load(std::memory_order_relaxed);
+    while (table) {
+      Table *next = table->Next.load(std::memory_order_relaxed);
+      if (!next) {
+        auto slots = table->slots();
+        for (size_t i = 0; i <= table->Mask; ++i) {
+          if (Node *node = getNode(slots[i].load(std::memory_order_relaxed))) {
+            node->~Node();
+            ::operator delete(node);
+          }
+        }
+      }
+      Table::deallocate(table);
+      table = next;
+    }
   }
 
 #ifndef NDEBUG
   void dump() const {
-    auto R = Root.load(std::memory_order_acquire);
-    printf("digraph g {\n"
-           "graph [ rankdir = \"TB\"];\n"
-           "node  [ fontsize = \"16\" ];\n"
-           "edge  [ ];\n");
-    if (R) {
-      R->dump();
+    for (Table *table = First.load(std::memory_order_acquire); table;
+         table = table->Next.load(std::memory_order_acquire)) {
+      printf("table %p: %zu/%zu slots used%s\n", (void *) table,
+             table->Count.load(std::memory_order_relaxed), table->capacity(),
+             table->Next.load(std::memory_order_acquire) ? " (retired)" : "");
+      auto slots = table->slots();
+      for (size_t i = 0; i <= table->Mask; ++i) {
+        uintptr_t value = slots[i].load(std::memory_order_acquire);
+        if (Node *node = getNode(value))
+          printf("  [%zu] %08lx%s\n", i,
+                 (long) node->Payload.getKeyIntValueForDump(),
+                 (value & FrozenBit) ? " (frozen)" : "");
+      }
     }
-    printf("\n}\n");
   }
 #endif
 
@@ -217,25 +400,33 @@ public:
   /// \returns a pointer to the value or null if the value is not in the map.
   template <class KeyTy>
   EntryTy *find(const KeyTy &key) {
-    // Check if we are looking for the same key that we looked for in the last
-    // time we called this function.
-    if (Node *last = LastSearch.load(std::memory_order_acquire)) {
-      if (last->Payload.compareWithKey(key) == 0)
-        return &last->Payload;
-    }
-
-    // Search the tree, starting from the root.
-    Node *node = Root.load(std::memory_order_acquire);
-    while (node) {
-      int comparisonResult = node->Payload.compareWithKey(key);
-      if (comparisonResult == 0) {
-        LastSearch.store(node, std::memory_order_release);
-        return &node->Payload;
-      } else if (comparisonResult < 0) {
-        node = node->Left.load(std::memory_order_acquire);
-      } else {
-        node = node->Right.load(std::memory_order_acquire);
+    Table *table = Current.load(std::memory_order_acquire);
+    if (!table)
+      return nullptr;
+
+    size_t hash = EntryTy::getKeyHash(key);
+    while (table) {
+      auto slots = table->slots();
+      size_t index = hash & table->Mask;
+      for (size_t probes = 0; probes <= table->Mask; ++probes) {
+        uintptr_t value = slots[index].load(std::memory_order_acquire);
+
+        // An empty slot ends the probe sequence: the key is not present.
+        if (value == 0)
+          return nullptr;
+
+        // A frozen empty slot means the rest of the probe sequence may have
+        // moved on to the next table.
+        if (value == FrozenEmpty)
+          break;
+
+        Node *node = getNode(value);
+        if (node->Hash == hash && node->Payload.compareWithKey(key) == 0)
+          return &node->Payload;
+
+        index = (index + 1) & table->Mask;
       }
+      table = table->Next.load(std::memory_order_acquire);
     }
 
     return nullptr;
@@ -247,68 +438,80 @@ public:
   ///   or already existed (false)
   template <class KeyTy, class... ArgTys>
   std::pair<EntryTy*, bool> getOrInsert(KeyTy key, ArgTys &&... args) {
-    // Check if we are looking for the same key that we looked for the
-    // last time we called this function.
-    if (Node *last = LastSearch.load(std::memory_order_acquire)) {
-      if (last && last->Payload.compareWithKey(key) == 0)
-        return { &last->Payload, false };
-    }
+    size_t hash = EntryTy::getKeyHash(key);
 
     // The node we allocated.
     Node *newNode = nullptr;
 
-    // Start from the root.
-    auto edge = &Root;
-
+    Table *table = getOrCreateCurrent();
+  restart:
     while (true) {
-      // Load the edge.
-      Node *node = edge->load(std::memory_order_acquire);
+      // If a migration has been started, help finish it before inserting,
+      // so that the key cannot end up in both tables.
+      if (Table *next = table->Next.load(std::memory_order_acquire)) {
+        migrate(table, next);
+        table = next;
+        continue;
+      }
 
-      // If there's a node there, it's either a match or we're going to
-      // one of its children.
-      if (node) {
-      searchFromNode:
+      auto slots = table->slots();
+      size_t index = hash & table->Mask;
+      for (size_t probes = 0; probes <= table->Mask; ++probes) {
+        auto &slot = slots[index];
+        uintptr_t value = slot.load(std::memory_order_acquire);
+
+        while (value == 0) {
+          // Grow before we make the table too dense to probe efficiently.
+          if (table->isFull()) {
+            table = grow(table);
+            goto restart;
+          }
+
+          // Create a new node.
+          if (!newNode) {
+            size_t allocSize =
+              sizeof(Node) + EntryTy::getExtraAllocationSize(key, args...);
+            void *memory = ::operator new(allocSize);
+            newNode = ::new (memory) Node(hash, key,
+                                          std::forward<ArgTys>(args)...);
+          }
+
+          // Try to publish the new node into the empty slot.
+          if (slot.compare_exchange_strong(value, uintptr_t(newNode),
+                                           std::memory_order_release,
+                                           std::memory_order_acquire)) {
+            table->Count.fetch_add(1, std::memory_order_relaxed);
+            return { &newNode->Payload, true };
+          }
+
+          // Otherwise, we lost the race because some other thread filled or
+          // froze the slot before us; value holds what is there now.
+        }
 
-        // Compare our key against the node's key.
-        int comparisonResult = node->Payload.compareWithKey(key);
+        // The table is being migrated; help out and retry in the new table.
+        if (value & FrozenBit) {
+          Table *next = table->Next.load(std::memory_order_acquire);
+          assert(next && "frozen slot without a migration target");
+          migrate(table, next);
+          table = next;
+          goto restart;
+        }
 
-        // If it's equal, we can use this node.
-        if (comparisonResult == 0) {
+        Node *node = getNode(value);
+        if (node->Hash == hash && node->Payload.compareWithKey(key) == 0) {
           // Destroy the node we allocated before if we're carrying one around.
-          ::delete newNode;
-
-          // Cache and report that we found an existing node.
-          LastSearch.store(node, std::memory_order_release);
+          if (newNode) {
+            newNode->~Node();
+            ::operator delete(newNode);
+          }
           return { &node->Payload, false };
         }
 
-        // Otherwise, select the appropriate child edge and descend.
-        edge = (comparisonResult < 0 ? &node->Left : &node->Right);
-        continue;
-      }
-
-      // Create a new node.
-      if (!newNode) {
-        size_t allocSize =
-          sizeof(Node) + EntryTy::getExtraAllocationSize(key, args...);
-        void *memory = ::operator new(allocSize);
-        newNode = ::new (memory) Node(key, std::forward<ArgTys>(args)...);
-      }
-
-      // Try to set the edge to the new node.
-      if (std::atomic_compare_exchange_strong_explicit(edge, &node, newNode,
-                                                  std::memory_order_release,
-                                                  std::memory_order_acquire)) {
-        // If that succeeded, cache and report that we created a new node.
-        LastSearch.store(newNode, std::memory_order_release);
-        return { &newNode->Payload, true };
+        index = (index + 1) & table->Mask;
       }
 
-      // Otherwise, we lost the race because some other thread initialized
-      // the edge before us.  node will be set to the current value;
-      // repeat the search from there.
-      assert(node && "spurious failure from compare_exchange_strong?");
-      goto searchFromNode;
+      // We probed every slot without finding the key or a free slot.
+      table = grow(table);
     }
   }
 };
@@ -75,6 +75,11 @@
 # define SWIFT_ALLOWED_RUNTIME_GLOBAL_CTOR_END
 #endif
 
+/// Declares a variable with thread-local storage duration. The variable's type
+/// must be trivially constructible and destructible, and it is zero-filled
+/// in each new thread.
+#define SWIFT_THREAD_LOCAL __thread
+
 // Bring in visibility attribute macros
 #include "../../../stdlib/public/SwiftShims/Visibility.h"
 
@@ -109,6 +109,26 @@ SWIFT_RUNTIME_EXPORT
 extern "C"
 void swift_reportError(uint32_t flags, const char *message);
 
+/// Print the counts of metadata cache lookups, conformance lookups and
+/// dynamic casts that the process has done so far to standard error.
+/// They are printed at exit if the SWIFT_RUNTIME_DUMP_STATISTICS
+/// environment variable is set.
+SWIFT_RUNTIME_EXPORT
+extern "C"
+void swift_runtime_dumpStatistics();
+
+/// Return the total of one of the counters that swift_runtime_dumpStatistics
+/// prints, or ~0 if there is no such counter. \p name is a name from
+/// RuntimeStatistics.def, such as "ConformanceLookups", or the name of a
+/// metadata cache followed by ".Hits", ".Instantiations" or ".Waits", such
+/// as "GenericCache.Hits".
+///
+/// This is exported for the runtime unit tests, which cannot see the
+/// runtime's private headers. The counter names are not a stable interface.
+SWIFT_RUNTIME_EXPORT
+extern "C"
+uint64_t _swift_getRuntimeStatistic(const char *name);
+
 // namespace swift
 }
 
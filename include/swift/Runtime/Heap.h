@@ -18,5 +18,16 @@
 #define SWIFT_RUNTIME_HEAP_H
 
 #include <llvm/Support/Compiler.h>
+#include <stddef.h>
+
+namespace swift {
+
+/// Return the number of usable bytes in a block returned by swift_slowAlloc,
+/// which may be larger than the size that was requested. This is the runtime's
+/// analog of malloc_size and must be used instead of it, since the block may
+/// not have come from malloc.
+size_t _swift_slowAllocUsableSize(const void *ptr);
+
+} // end namespace swift
 
 #endif /* SWIFT_RUNTIME_HEAP_H */
@@ -218,6 +218,32 @@ static inline void _swift_retain_inlined(HeapObject *object) {
   }
 }
 
+/// Non-atomically increments the retain count of an object.
+///
+/// This may only be used when no other thread can access the object, for
+/// example in code compiled with -assume-single-threaded.
+///
+/// \param object - may be null, in which case this is a no-op
+SWIFT_RT_ENTRY_VISIBILITY
+extern "C"
+void swift_nonatomic_retain(HeapObject *object)
+    SWIFT_CC(RegisterPreservingCC);
+
+SWIFT_RUNTIME_EXPORT
+extern "C"
+void (*SWIFT_CC(RegisterPreservingCC) _swift_nonatomic_retain)(
+                                                           HeapObject *object);
+
+SWIFT_RT_ENTRY_VISIBILITY
+extern "C"
+void swift_nonatomic_retain_n(HeapObject *object, uint32_t n)
+    SWIFT_CC(RegisterPreservingCC);
+
+SWIFT_RUNTIME_EXPORT
+extern "C"
+void (*SWIFT_CC(RegisterPreservingCC) _swift_nonatomic_retain_n)(
+                                               HeapObject *object, uint32_t n);
+
 /// Atomically increments the reference count of an object, unless it has
 /// already been destroyed. Returns nil if the object is dead.
 SWIFT_RT_ENTRY_VISIBILITY
@@ -292,6 +318,31 @@ SWIFT_RUNTIME_EXPORT
 extern "C" void (*SWIFT_CC(RegisterPreservingCC)
                      _swift_release_n)(HeapObject *object, uint32_t n);
 
+/// Non-atomically decrements the retain count of an object. If the retain
+/// count reaches zero, the object is destroyed as by swift_release.
+///
+/// This may only be used when no other thread can access the object.
+///
+/// \param object - may be null, in which case this is a no-op
+SWIFT_RT_ENTRY_VISIBILITY
+extern "C"
+void swift_nonatomic_release(HeapObject *object)
+    SWIFT_CC(RegisterPreservingCC);
+
+SWIFT_RUNTIME_EXPORT
+extern "C" void (*SWIFT_CC(RegisterPreservingCC)
+                     _swift_nonatomic_release)(HeapObject *object);
+
+SWIFT_RT_ENTRY_VISIBILITY
+extern "C"
+void swift_nonatomic_release_n(HeapObject *object, uint32_t n)
+    SWIFT_CC(RegisterPreservingCC);
+
+SWIFT_RUNTIME_EXPORT
+extern "C" void (*SWIFT_CC(RegisterPreservingCC)
+                     _swift_nonatomic_release_n)(HeapObject *object,
+                                                 uint32_t n);
+
 /// Sets the RC_DEALLOCATING_FLAG flag. This is done non-atomically.
 /// The strong reference count of \p object must be 1 and no other thread may
 /// retain the object during executing this function.
@@ -582,8 +633,22 @@ static inline void swift_unownedTakeAssign(UnownedReference *dest,
 /*****************************************************************************/
 
 /// A weak reference value object.  This is ABI.
+///
+/// A native weak reference does not point to its referent, but to a side
+/// table allocated for the referent when it is first weakly referenced. The
+/// side table pointer is tagged with NativeTag, which can be neither an
+/// object pointer nor an ObjC tagged pointer on any supported platform, so
+/// that native and ObjC weak references can share this representation.
 struct WeakReference {
-  HeapObject *Value;
+  enum : uintptr_t { NativeTag = 0x2, NativeTagMask = 0x3 };
+
+  void *Value;
+
+  /// Return true if this holds a native weak reference. The value must not
+  /// be null or an ObjC tagged pointer.
+  bool isNative() const {
+    return (uintptr_t(Value) & NativeTagMask) == NativeTag;
+  }
 };
 
 /// Initialize a weak reference.
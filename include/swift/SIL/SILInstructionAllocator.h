@@ -0,0 +1,138 @@
+//===--- SILInstructionAllocator.h - Recycles instruction memory -*- C++ -*-===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2016 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines the SILInstructionAllocator class, which SILModule uses
+// to allocate the memory of SIL instructions.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef SWIFT_SIL_SILINSTRUCTIONALLOCATOR_H
+#define SWIFT_SIL_SILINSTRUCTIONALLOCATOR_H
+
+#include "swift/Basic/Malloc.h"
+#include "llvm/Support/Allocator.h"
+#include <algorithm>
+#include <cstdint>
+
+namespace swift {
+
+/// Allocates SIL instructions out of slabs, and recycles the memory of
+/// deleted instructions for later instructions of the same size.
+///
+/// The optimizer creates and deletes a large number of instructions, so
+/// going through malloc and free for each of them is noticeably slow.
+/// Instead, small instructions are grouped into size classes of
+/// \c Granularity bytes, and a deleted instruction goes onto the free list
+/// of its class. Instructions that are larger than \c MaxSmallSize, or that
+/// need more than \c Granularity alignment, are still allocated with malloc.
+///
+/// Every allocation is preceded by a header recording its size, because
+/// deallocate() is only passed the instruction.
+class SILInstructionAllocator {
+  struct Header {
+    /// The requested size, excluding the header.
+    uint32_t Size;
+    /// The distance from the start of the underlying allocation to the
+    /// instruction.
+    uint32_t Offset;
+  };
+
+  struct FreeBlock {
+    FreeBlock *Next;
+  };
+
+  static const size_t Granularity = 8;
+  static const size_t MaxSmallSize = 512;
+  static const unsigned NumSizeClasses = MaxSmallSize / Granularity;
+
+  static_assert(sizeof(Header) == Granularity,
+                "the header must keep small instructions aligned");
+
+  llvm::BumpPtrAllocator Slabs;
+  FreeBlock *FreeLists[NumSizeClasses] = {};
+
+  /// Allocate every instruction with malloc and free it as soon as it is
+  /// deleted, so that memory checkers see each instruction separately.
+  bool UseMalloc;
+
+  size_t LiveBytes = 0;
+  size_t PeakBytes = 0;
+  size_t NumRecycled = 0;
+
+  static unsigned getSizeClass(size_t Size) {
+    return (std::max(Size, sizeof(FreeBlock)) - 1) / Granularity;
+  }
+
+  bool isSmall(size_t Size, size_t Offset) const {
+    return !UseMalloc && Offset == sizeof(Header) && Size <= MaxSmallSize;
+  }
+
+  static Header &getHeader(void *Ptr) {
+    return reinterpret_cast<Header *>(Ptr)[-1];
+  }
+
+public:
+  explicit SILInstructionAllocator(bool UseMalloc) : UseMalloc(UseMalloc) {}
+
+  SILInstructionAllocator(const SILInstructionAllocator &) = delete;
+  SILInstructionAllocator &operator=(const SILInstructionAllocator &) = delete;
+
+  void *allocate(size_t Size, size_t Align) {
+    size_t Offset = std::max(Align, sizeof(Header));
+    void *Ptr;
+    if (isSmall(Size, Offset)) {
+      unsigned SizeClass = getSizeClass(Size);
+      if (FreeBlock *Block = FreeLists[SizeClass]) {
+        FreeLists[SizeClass] = Block->Next;
+        Ptr = Block;
+        ++NumRecycled;
+      } else {
+        size_t BlockSize = sizeof(Header) + (SizeClass + 1) * Granularity;
+        Ptr = (char *)Slabs.Allocate(BlockSize, Granularity) + Offset;
+      }
+    } else {
+      Ptr = (char *)AlignedAlloc(Offset + Size, Offset) + Offset;
+    }
+
+    getHeader(Ptr) = { uint32_t(Size), uint32_t(Offset) };
+    LiveBytes += Size;
+    PeakBytes = std::max(PeakBytes, LiveBytes);
+    return Ptr;
+  }
+
+  void deallocate(void *Ptr) {
+    Header H = getHeader(Ptr);
+    LiveBytes -= H.Size;
+    if (isSmall(H.Size, H.Offset)) {
+      unsigned SizeClass = getSizeClass(H.Size);
+      auto *Block = reinterpret_cast<FreeBlock *>(Ptr);
+      Block->Next = FreeLists[SizeClass];
+      FreeLists[SizeClass] = Block;
+      return;
+    }
+    AlignedFree((char *)Ptr - H.Offset);
+  }
+
+  /// The number of bytes taken by the instructions that currently exist.
+  size_t getLiveBytes() const { return LiveBytes; }
+
+  /// The largest value getLiveBytes() has had.
+  size_t getPeakBytes() const { return PeakBytes; }
+
+  /// The number of allocations that reused the memory of a deleted
+  /// instruction.
+  size_t getNumRecycled() const { return NumRecycled; }
+};
+
+} // end namespace swift
+
+#endif // SWIFT_SIL_SILINSTRUCTIONALLOCATOR_H
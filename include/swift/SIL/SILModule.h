@@ -27,6 +27,7 @@
 #include "swift/SIL/SILDeclRef.h"
 #include "swift/SIL/SILDefaultWitnessTable.h"
 #include "swift/SIL/SILFunction.h"
+#include "swift/SIL/SILInstructionAllocator.h"
 #include "swift/SIL/SILGlobalVariable.h"
 #include "swift/SIL/Notifications.h"
 #include "swift/SIL/SILType.h"
@@ -102,6 +103,11 @@ private:
   /// Allocator that manages the memory of all the pieces of the SILModule.
   mutable llvm::BumpPtrAllocator BPA;
 
+  /// Allocator for the memory of instructions, which unlike the other pieces
+  /// of the module are deleted and recreated all the time. This needs to be
+  /// declared before \p functions so that it outlives the instructions.
+  mutable SILInstructionAllocator InstAllocator;
+
   /// The swift Module associated with this SILModule.
   ModuleDecl *TheSwiftModule;
 
@@ -594,6 +600,19 @@ public:
   /// Deallocate memory of an instruction.
   void deallocateInst(SILInstruction *I);
 
+  /// Returns the number of bytes taken by the instructions in the module.
+  size_t getLiveInstBytes() const { return InstAllocator.getLiveBytes(); }
+
+  /// Returns the largest number of bytes the instructions in the module have
+  /// taken at any one time.
+  size_t getPeakInstBytes() const { return InstAllocator.getPeakBytes(); }
+
+  /// Returns the number of instructions that reused the memory of a deleted
+  /// instruction.
+  size_t getNumRecycledInsts() const {
+    return InstAllocator.getNumRecycled();
+  }
+
   /// \brief Looks up the llvm intrinsic ID and type for the builtin function.
   ///
   /// \returns Returns llvm::Intrinsic::not_intrinsic if the function is not an
@@ -65,6 +65,9 @@ class SILPassManager {
   /// Set to true when a pass invalidates an analysis.
   bool CurrentPassHasInvalidated = false;
 
+  /// The number of invalidateAnalysis calls so far, for -sil-pass-profile.
+  unsigned NumInvalidations = 0;
+
   /// True if we need to stop running passes and restart again on the
   /// same function.
   bool RestartPipeline = false;
@@ -119,6 +122,7 @@ public:
         AP->invalidate(K);
 
     CurrentPassHasInvalidated = true;
+    ++NumInvalidations;
 
     // Assume that all functions have changed. Clear all masks of all functions.
     CompletedPassesMap.clear();
@@ -147,6 +151,7 @@ public:
         AP->invalidate(F, K);
     
     CurrentPassHasInvalidated = true;
+    ++NumInvalidations;
     // Any change let all passes run again.
     CompletedPassesMap[F].reset();
   }
@@ -162,10 +167,14 @@ public:
         AP->invalidateForDeadFunction(F, K);
     
     CurrentPassHasInvalidated = true;
+    ++NumInvalidations;
     // Any change let all passes run again.
     CompletedPassesMap[F].reset();
   }
 
+  /// \returns the number of analysis invalidations requested so far.
+  unsigned getNumInvalidations() const { return NumInvalidations; }
+
   /// \brief Reset the state of the pass manager and remove all transformation
   /// owned by the pass manager. Analysis passes will be kept.
   void resetAndRemoveTransformations();
@@ -287,6 +287,18 @@ private:
 
   std::unique_ptr<SerializedObjCMethodTable> ObjCMethods;
 
+  class DeclMemberNamesTableInfo;
+  using SerializedDeclMemberNamesTable =
+    llvm::OnDiskIterableChainedHashTable<DeclMemberNamesTableInfo>;
+
+  std::unique_ptr<SerializedDeclMemberNamesTable> DeclMemberNames;
+
+  class NestedTypeDeclsTableInfo;
+  using SerializedNestedTypeDeclsTable =
+    llvm::OnDiskIterableChainedHashTable<NestedTypeDeclsTableInfo>;
+
+  std::unique_ptr<SerializedNestedTypeDeclsTable> NestedTypeDecls;
+
   llvm::DenseMap<const ValueDecl *, Identifier> PrivateDiscriminatorsByValue;
 
   TinyPtrVector<Decl *> ImportDecls;
@@ -394,6 +406,16 @@ private:
   std::unique_ptr<ModuleFile::SerializedObjCMethodTable>
   readObjCMethodTable(ArrayRef<uint64_t> fields, StringRef blobData);
 
+  /// Read an on-disk member name table stored in
+  /// index_block::DeclListLayout format.
+  std::unique_ptr<ModuleFile::SerializedDeclMemberNamesTable>
+  readDeclMemberNamesTable(ArrayRef<uint64_t> fields, StringRef blobData);
+
+  /// Read an on-disk nested type table stored in
+  /// index_block::DeclListLayout format.
+  std::unique_ptr<ModuleFile::SerializedNestedTypeDeclsTable>
+  readNestedTypeDeclsTable(ArrayRef<uint64_t> fields, StringRef blobData);
+
   /// Reads the index block, which contains global tables.
   ///
   /// Returns false if there was an error.
@@ -518,6 +540,13 @@ public:
   /// Searches the module's local type decls for the given mangled name.
   TypeDecl *lookupLocalType(StringRef MangledName);
 
+  /// Searches the types declared in \p parent and in the extensions of
+  /// \p parent in this module for one with the given name, without loading
+  /// the members of \p parent.
+  ///
+  /// If none is found, returns null.
+  TypeDecl *lookupNestedType(Identifier name, const NominalTypeDecl *parent);
+
   /// Searches the module's operators for one with the given name and fixity.
   ///
   /// If none is found, returns null.
@@ -616,6 +645,10 @@ public:
   virtual void loadAllMembers(Decl *D,
                               uint64_t contextData) override;
 
+  virtual bool
+  loadNamedMembers(const Decl *D, Identifier name, uint64_t contextData,
+                   SmallVectorImpl<ValueDecl *> &members) override;
+
   virtual void
   loadAllConformances(const Decl *D, uint64_t contextData,
                     SmallVectorImpl<ProtocolConformance*> &Conforms) override;
@@ -53,7 +53,7 @@ const uint16_t VERSION_MAJOR = 0;
 /// in source control, you should also update the comment to briefly
 /// describe what change you made. The content of this comment isn't important;
 /// it just ensures a conflict if two people change the module format.
-const uint16_t VERSION_MINOR = 246; // Last change: @_specialize attribute
+const uint16_t VERSION_MINOR = 249; // Last change: nested type data length
 
 using DeclID = PointerEmbeddedInt<unsigned, 31>;
 using DeclIDField = BCFixed<31>;
@@ -1468,6 +1468,16 @@ namespace index_block {
     DECL_CONTEXT_OFFSETS,
     LOCAL_TYPE_DECLS,
     NORMAL_CONFORMANCE_OFFSETS,
+
+    /// The member name index, which maps the base names of the members of
+    /// nominal types and extensions to the members with that name, keyed by
+    /// the offset of their container's MEMBERS record.
+    DECL_MEMBER_NAMES,
+
+    /// The nested type index, which maps the names of types declared inside
+    /// nominal types and their extensions to pairs of (parent type, nested
+    /// type).
+    NESTED_TYPE_DECLS,
   };
 
   using OffsetsLayout = BCGenericRecordLayout<
@@ -1476,7 +1486,7 @@ namespace index_block {
   >;
 
   using DeclListLayout = BCGenericRecordLayout<
-    BCFixed<4>,  // record ID
+    BCFixed<5>,  // record ID
     BCVBR<16>,  // table offset within the blob (see below)
     BCBlob  // map from identifier strings to decl kinds / decl IDs
   >;
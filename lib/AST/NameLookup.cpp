@@ -25,6 +25,7 @@
 #include "swift/Basic/SourceManager.h"
 #include "swift/Basic/STLExtras.h"
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/TinyPtrVector.h"
 
 using namespace swift;
@@ -688,6 +689,13 @@ class swift::MemberLookupTable {
   /// Lookup table mapping names to the set of declarations with that name.
   LookupTable Lookup;
 
+  /// The base names whose entries are complete, even though not all members
+  /// of the nominal type and its extensions have been loaded.
+  llvm::DenseSet<Identifier> LazilyCompleteNames;
+
+  /// The last extension that was taken into account by LazilyCompleteNames.
+  ExtensionDecl *LastExtensionLazilyIncluded = nullptr;
+
 public:
   /// Create a new member lookup table.
   explicit MemberLookupTable(ASTContext &ctx);
@@ -720,6 +728,22 @@ public:
     return Lookup.find(name);
   }
 
+  /// Whether all members with the given base name are in the table.
+  bool isLazilyComplete(NominalTypeDecl *nominal, Identifier name) {
+    // A new extension may add members with any name.
+    if (LastExtensionLazilyIncluded != nominal->LastExtension) {
+      LazilyCompleteNames.clear();
+      LastExtensionLazilyIncluded = nominal->LastExtension;
+      return false;
+    }
+    return LazilyCompleteNames.count(name);
+  }
+
+  /// Note that all members with the given base name are in the table.
+  void markLazilyComplete(Identifier name) {
+    LazilyCompleteNames.insert(name);
+  }
+
   // Only allow allocation of member lookup tables using the allocator in
   // ASTContext or by doing a placement new.
   void *operator new(size_t Bytes, ASTContext &C,
@@ -896,8 +920,79 @@ void NominalTypeDecl::makeMemberVisible(ValueDecl *member) {
   LookupTable.getPointer()->addMember(member);
 }
 
+/// Adds the members of \p container with the given base name to \p table.
+///
+/// If the members of \p container have not been loaded yet, only the ones
+/// with that name are.
+///
+/// \returns false if the members could not be loaded by name.
+static bool addNamedMembers(MemberLookupTable &table, const Decl *container,
+                            const IterableDeclContext *IDC, Identifier name) {
+  if (!IDC->isLazy()) {
+    // Members that are already in the table are skipped quickly.
+    table.addMembers(IDC->getMembers());
+    return true;
+  }
+
+  SmallVector<ValueDecl *, 4> members;
+  if (!IDC->getLoader()->loadNamedMembers(container, name,
+                                          IDC->getLoaderContextData(),
+                                          members))
+    return false;
+
+  for (auto member : members)
+    table.addMember(member);
+  return true;
+}
+
+bool NominalTypeDecl::prepareLookupTableForName(Identifier name,
+                                                bool ignoreNewExtensions) {
+  if (!LookupTable.getPointer()) {
+    auto &ctx = getASTContext();
+    LookupTable.setPointer(new (ctx) MemberLookupTable(ctx));
+  }
+  MemberLookupTable &table = *LookupTable.getPointer();
+
+  // Make sure we have the complete list of extensions, but not their
+  // members.
+  if (!ignoreNewExtensions) {
+    (void)getExtensions();
+    if (table.isLazilyComplete(this, name))
+      return true;
+  }
+
+  if (hasLazyMembers()) {
+    if (!addNamedMembers(table, this, this, name))
+      return false;
+  } else if (!LookupTable.getInt()) {
+    LookupTable.setInt(true);
+    table.addMembers(getMembers());
+  }
+
+  if (ignoreNewExtensions)
+    return true;
+
+  for (auto ext : getExtensions())
+    if (!addNamedMembers(table, ext, ext, name))
+      return false;
+
+  table.markLazilyComplete(name);
+  return true;
+}
+
 ArrayRef<ValueDecl *> NominalTypeDecl::lookupDirect(DeclName name,
                                                     bool ignoreNewExtensions) {
+  // If possible, only load the members with this name. Protocols always
+  // load all their members, which are the requirements.
+  if (getASTContext().LangOpts.NamedLazyMemberLoading &&
+      !isa<ProtocolDecl>(this) &&
+      prepareLookupTableForName(name.getBaseName(), ignoreNewExtensions)) {
+    auto known = LookupTable.getPointer()->find(name);
+    if (known == LookupTable.getPointer()->end())
+      return { };
+    return { known->second.begin(), known->second.size() };
+  }
+
   // Make sure we have the complete list of members (in this nominal and in all
   // extensions).
   if (!ignoreNewExtensions) {
@@ -14,12 +14,27 @@
 #include "Darwin/Cache-Mac.cpp"
 #else
 
-//  This file implements a default caching implementation that never evicts
-//  its entries.
+//  This file implements a default caching implementation that keeps the total
+//  cost of its values within a limit by evicting the least recently used
+//  values that are not retained.
+//
+//  Entries are spread over several shards by key hash, each with its own lock,
+//  so that concurrent lookups of different keys do not contend. Each shard
+//  keeps its entries in a list ordered by last use, stamped with a monotonic
+//  clock rather than a shared counter. Eviction repeatedly removes the oldest
+//  of the shards' least recently used entries.
+//
+//  Since a value may be released after its entry has been removed, retain
+//  counts are kept per value pointer in a separate set of shards; the value
+//  destroy callback is only invoked once a removed value is no longer
+//  retained. Callbacks are always invoked with no locks held.
 
 #include "swift/Basic/Cache.h"
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/Support/Mutex.h"
+#include <atomic>
+#include <chrono>
 
 using namespace swift::sys;
 using llvm::StringRef;
@@ -28,31 +43,171 @@ namespace {
 struct DefaultCacheKey {
   void *Key = nullptr;
   CacheImpl::CallBacks *CBs = nullptr;
+  uintptr_t Hash = 0;
+
+  DefaultCacheKey(void *Key, CacheImpl::CallBacks *CBs)
+    : Key(Key), CBs(CBs), Hash(CBs->keyHashCB(Key, CBs->UserData)) {}
+  DefaultCacheKey(void *Key, CacheImpl::CallBacks *CBs, uintptr_t Hash)
+    : Key(Key), CBs(CBs), Hash(Hash) {}
+};
+
+/// Identifies an entry by its key pointer alone, so that it can be looked up
+/// without calling the key callbacks, for instance after the key may have
+/// been destroyed.
+struct DefaultCacheKeyIdentity {
+  void *Key;
+  uintptr_t Hash;
+};
+
+struct DefaultCacheEntry {
+  DefaultCacheKeyIdentity Key;
+  void *Value;
+  size_t Cost;
+  /// When the entry was last used, in nanoseconds of a monotonic clock.
+  uint64_t LastUse;
+  /// The neighbours of the entry in its shard's list, more and less recently
+  /// used respectively.
+  DefaultCacheEntry *Prev = nullptr;
+  DefaultCacheEntry *Next = nullptr;
+
+  DefaultCacheEntry(DefaultCacheKeyIdentity Key, void *Value, size_t Cost)
+    : Key(Key), Value(Value), Cost(Cost), LastUse(0) {}
+};
 
-  //DefaultCacheKey() = default;
-  DefaultCacheKey(void *Key, CacheImpl::CallBacks *CBs) : Key(Key), CBs(CBs) {}
+/// The state of a value that is in the cache or still retained.
+struct DefaultCacheValueState {
+  /// The number of outstanding retains of the value.
+  unsigned RetainCount = 0;
+  /// The number of cache entries that hold the value.
+  unsigned EntryCount = 0;
+  /// The number of times the value was removed from the cache while
+  /// retained, each owing a call of the value destroy callback.
+  unsigned PendingDestroys = 0;
+};
+
+/// Keys and values whose destroy callbacks are owed once locks are dropped.
+struct DefaultCacheGarbage {
+  llvm::SmallVector<void *, 4> Keys;
+  llvm::SmallVector<void *, 4> Values;
 };
 
 struct DefaultCache {
-  llvm::sys::Mutex Mux;
+  static const unsigned NumShards = 16;
+  static const size_t DefaultCostLimit = size_t(1) << 30;
+
+  /// Reads a clock that all threads share without writing to shared memory.
+  static uint64_t now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+
+  /// The entries of a shard, which are guarded by its lock, along with
+  /// their list from most to least recently used.
+  struct EntryShard {
+    llvm::sys::Mutex Mux;
+    llvm::DenseMap<DefaultCacheKey, DefaultCacheEntry *> Entries;
+    DefaultCacheEntry *Head = nullptr;
+    DefaultCacheEntry *Tail = nullptr;
+
+    void unlink(DefaultCacheEntry *Entry) {
+      if (Entry->Prev)
+        Entry->Prev->Next = Entry->Next;
+      else
+        Head = Entry->Next;
+      if (Entry->Next)
+        Entry->Next->Prev = Entry->Prev;
+      else
+        Tail = Entry->Prev;
+      Entry->Prev = Entry->Next = nullptr;
+    }
+
+    /// Marks \p Entry as used now, moving it to the front of the list. The
+    /// entry may not be in the list yet.
+    void touch(DefaultCacheEntry *Entry) {
+      Entry->LastUse = now();
+      if (Entry == Head)
+        return;
+      // Any entry in the list but its head has a predecessor.
+      if (Entry->Prev)
+        unlink(Entry);
+      Entry->Next = Head;
+      if (Head)
+        Head->Prev = Entry;
+      else
+        Tail = Entry;
+      Head = Entry;
+    }
+  };
+
+  struct ValueShard {
+    llvm::sys::Mutex Mux;
+    llvm::DenseMap<void *, DefaultCacheValueState> Values;
+  };
+
   CacheImpl::CallBacks CBs;
-  llvm::DenseMap<DefaultCacheKey, void *> Entries;
+  EntryShard EntryShards[NumShards];
+  ValueShard ValueShards[NumShards];
+
+  std::atomic<size_t> TotalCost;
+  std::atomic<size_t> CostLimit;
+
+  /// Serializes eviction; a thread that finds another one evicting leaves
+  /// the job to it.
+  llvm::sys::Mutex EvictionMux;
+
+  explicit DefaultCache(CacheImpl::CallBacks CBs)
+    : CBs(std::move(CBs)), TotalCost(0), CostLimit(DefaultCostLimit) { }
+
+  EntryShard &getEntryShard(const DefaultCacheKey &CKey) {
+    return EntryShards[CKey.Hash % NumShards];
+  }
+
+  ValueShard &getValueShard(void *Value) {
+    return ValueShards[(reinterpret_cast<uintptr_t>(Value) >> 4) % NumShards];
+  }
 
-  explicit DefaultCache(CacheImpl::CallBacks CBs) : CBs(std::move(CBs)) { }
+  void retainValue(void *Value, bool AddEntry);
+  void releaseValue(void *Value, DefaultCacheGarbage &Garbage);
+  bool isRetained(void *Value);
+
+  /// Removes an entry from its shard, whose lock must be held.
+  void removeEntry(EntryShard &Shard,
+                   llvm::DenseMap<DefaultCacheKey,
+                                  DefaultCacheEntry *>::iterator Entry,
+                   DefaultCacheGarbage &Garbage);
+
+  /// Returns the least recently used entry of a shard, whose lock must be
+  /// held, that is not retained, if any.
+  DefaultCacheEntry *findEvictable(EntryShard &Shard);
+
+  void evictIfNeeded();
+
+  void collect(DefaultCacheGarbage &Garbage) {
+    for (void *Key : Garbage.Keys)
+      CBs.keyDestroyCB(Key, CBs.UserData);
+    for (void *Value : Garbage.Values)
+      CBs.valueDestroyCB(Value, CBs.UserData);
+  }
 };
 } // end anonymous namespace
 
 namespace llvm {
 template<> struct DenseMapInfo<DefaultCacheKey> {
   static inline DefaultCacheKey getEmptyKey() {
-    return { DenseMapInfo<void*>::getEmptyKey(), nullptr };
+    return { DenseMapInfo<void*>::getEmptyKey(), nullptr, 0 };
   }
   static inline DefaultCacheKey getTombstoneKey() {
-    return { DenseMapInfo<void*>::getTombstoneKey(), nullptr };
+    return { DenseMapInfo<void*>::getTombstoneKey(), nullptr, 0 };
   }
   static unsigned getHashValue(const DefaultCacheKey &Val) {
-    uintptr_t Hash = Val.CBs->keyHashCB(Val.Key, nullptr);
-    return DenseMapInfo<uintptr_t>::getHashValue(Hash);
+    return DenseMapInfo<uintptr_t>::getHashValue(Val.Hash);
+  }
+  static unsigned getHashValue(const DefaultCacheKeyIdentity &Val) {
+    return DenseMapInfo<uintptr_t>::getHashValue(Val.Hash);
+  }
+  static bool isEqual(const DefaultCacheKeyIdentity &LHS,
+                      const DefaultCacheKey &RHS) {
+    return LHS.Key == RHS.Key;
   }
   static bool isEqual(const DefaultCacheKey &LHS, const DefaultCacheKey &RHS) {
     if (LHS.Key == RHS.Key)
@@ -62,76 +217,204 @@ template<> struct DenseMapInfo<DefaultCacheKey> {
         RHS.Key == DenseMapInfo<void*>::getEmptyKey() ||
         RHS.Key == DenseMapInfo<void*>::getTombstoneKey())
       return false;
-    return LHS.CBs->keyIsEqualCB(LHS.Key, RHS.Key, nullptr);
+    return LHS.Hash == RHS.Hash &&
+           LHS.CBs->keyIsEqualCB(LHS.Key, RHS.Key, LHS.CBs->UserData);
   }
 };
 }
 
+void DefaultCache::retainValue(void *Value, bool AddEntry) {
+  ValueShard &Shard = getValueShard(Value);
+  llvm::sys::ScopedLock L(Shard.Mux);
+  auto &State = Shard.Values[Value];
+  ++State.RetainCount;
+  if (AddEntry)
+    ++State.EntryCount;
+}
+
+void DefaultCache::releaseValue(void *Value, DefaultCacheGarbage &Garbage) {
+  ValueShard &Shard = getValueShard(Value);
+  llvm::sys::ScopedLock L(Shard.Mux);
+  auto Found = Shard.Values.find(Value);
+  assert(Found != Shard.Values.end() && Found->second.RetainCount &&
+         "releasing a value that is not retained");
+  auto &State = Found->second;
+  if (--State.RetainCount != 0)
+    return;
+  Garbage.Values.append(State.PendingDestroys, Value);
+  if (State.EntryCount == 0)
+    Shard.Values.erase(Found);
+  else
+    State.PendingDestroys = 0;
+}
+
+bool DefaultCache::isRetained(void *Value) {
+  ValueShard &Shard = getValueShard(Value);
+  llvm::sys::ScopedLock L(Shard.Mux);
+  auto Found = Shard.Values.find(Value);
+  return Found != Shard.Values.end() && Found->second.RetainCount != 0;
+}
+
+void DefaultCache::removeEntry(
+    EntryShard &Shard,
+    llvm::DenseMap<DefaultCacheKey, DefaultCacheEntry *>::iterator Entry,
+    DefaultCacheGarbage &Garbage) {
+  void *Key = Entry->first.Key;
+  DefaultCacheEntry *CEntry = Entry->second;
+  Shard.Entries.erase(Entry);
+  Shard.unlink(CEntry);
+  Garbage.Keys.push_back(Key);
+  TotalCost.fetch_sub(CEntry->Cost, std::memory_order_relaxed);
+
+  {
+    ValueShard &VShard = getValueShard(CEntry->Value);
+    llvm::sys::ScopedLock L(VShard.Mux);
+    auto Found = VShard.Values.find(CEntry->Value);
+    assert(Found != VShard.Values.end() && "cached value has no state");
+    auto &State = Found->second;
+    --State.EntryCount;
+    if (State.RetainCount != 0) {
+      ++State.PendingDestroys;
+    } else {
+      Garbage.Values.push_back(CEntry->Value);
+      if (State.EntryCount == 0)
+        VShard.Values.erase(Found);
+    }
+  }
+  delete CEntry;
+}
+
+DefaultCacheEntry *DefaultCache::findEvictable(EntryShard &Shard) {
+  // A retained entry is in use, so it is moved to the front of the list
+  // rather than skipped by every later eviction.
+  size_t Remaining = Shard.Entries.size();
+  while (Shard.Tail && isRetained(Shard.Tail->Value)) {
+    if (Remaining-- == 0)
+      return nullptr;
+    Shard.touch(Shard.Tail);
+  }
+  return Shard.Tail;
+}
+
+void DefaultCache::evictIfNeeded() {
+  size_t Limit = CostLimit.load(std::memory_order_relaxed);
+  if (Limit == 0 || TotalCost.load(std::memory_order_relaxed) <= Limit)
+    return;
+  if (!EvictionMux.tryacquire())
+    return;
+
+  DefaultCacheGarbage Garbage;
+  while (TotalCost.load(std::memory_order_relaxed) > Limit) {
+    // Find the shard whose evictable entry was used longest ago.
+    EntryShard *Oldest = nullptr;
+    uint64_t OldestUse = 0;
+    for (auto &Shard : EntryShards) {
+      llvm::sys::ScopedLock L(Shard.Mux);
+      DefaultCacheEntry *CEntry = findEvictable(Shard);
+      if (CEntry && (!Oldest || CEntry->LastUse < OldestUse)) {
+        Oldest = &Shard;
+        OldestUse = CEntry->LastUse;
+      }
+    }
+    if (!Oldest)
+      break;
+
+    // The shard may have changed since it was scanned; its least recently
+    // used entry is still a good enough choice. Its key may already be
+    // destroyed, so look it up by key identity, which does not call the key
+    // callbacks.
+    llvm::sys::ScopedLock L(Oldest->Mux);
+    if (DefaultCacheEntry *CEntry = findEvictable(*Oldest))
+      removeEntry(*Oldest, Oldest->Entries.find_as(CEntry->Key), Garbage);
+  }
+  EvictionMux.release();
+
+  collect(Garbage);
+}
+
 CacheImpl::ImplTy CacheImpl::create(StringRef Name, const CallBacks &CBs) {
   return new DefaultCache(CBs);
 }
 
 void CacheImpl::setAndRetain(void *Key, void *Value, size_t Cost) {
   DefaultCache &DCache = *static_cast<DefaultCache*>(Impl);
-  llvm::sys::ScopedLock L(DCache.Mux);
-
+  DefaultCacheGarbage Garbage;
   DefaultCacheKey CKey(Key, &DCache.CBs);
-  auto Entry = DCache.Entries.find(CKey);
-  if (Entry != DCache.Entries.end()) {
-    DCache.CBs.keyDestroyCB(Entry->first.Key, nullptr);
-    DCache.CBs.valueDestroyCB(Entry->second, nullptr);
-    DCache.Entries.erase(Entry);
-  }
-
-  DCache.Entries[CKey] = Value;
+  auto &Shard = DCache.getEntryShard(CKey);
+  {
+    llvm::sys::ScopedLock L(Shard.Mux);
+    auto Entry = Shard.Entries.find(CKey);
+    if (Entry != Shard.Entries.end())
+      DCache.removeEntry(Shard, Entry, Garbage);
 
-  // FIXME: Not thread-safe! It should avoid deleting the value until
-  // 'releaseValue is called on it.
+    DCache.retainValue(Value, /*AddEntry=*/true);
+    auto *CEntry = new DefaultCacheEntry({ Key, CKey.Hash }, Value, Cost);
+    Shard.Entries[CKey] = CEntry;
+    Shard.touch(CEntry);
+    DCache.TotalCost.fetch_add(Cost, std::memory_order_relaxed);
+  }
+  DCache.collect(Garbage);
+  DCache.evictIfNeeded();
 }
 
 bool CacheImpl::getAndRetain(const void *Key, void **Value_out) {
   DefaultCache &DCache = *static_cast<DefaultCache*>(Impl);
-  llvm::sys::ScopedLock L(DCache.Mux);
-
   DefaultCacheKey CKey(const_cast<void*>(Key), &DCache.CBs);
-  auto Entry = DCache.Entries.find(CKey);
-  if (Entry != DCache.Entries.end()) {
-    // FIXME: Not thread-safe! It should avoid deleting the value until
-    // 'releaseValue is called on it.
-    *Value_out = Entry->second;
+  auto &Shard = DCache.getEntryShard(CKey);
+  llvm::sys::ScopedLock L(Shard.Mux);
+
+  auto Entry = Shard.Entries.find(CKey);
+  if (Entry != Shard.Entries.end()) {
+    DefaultCacheEntry *CEntry = Entry->second;
+    Shard.touch(CEntry);
+    DCache.retainValue(CEntry->Value, /*AddEntry=*/false);
+    *Value_out = CEntry->Value;
     return true;
   }
   return false;
 }
 
 void CacheImpl::releaseValue(void *Value) {
-  // FIXME: Implementation.
+  DefaultCache &DCache = *static_cast<DefaultCache*>(Impl);
+  DefaultCacheGarbage Garbage;
+  DCache.releaseValue(Value, Garbage);
+  DCache.collect(Garbage);
 }
 
 bool CacheImpl::remove(const void *Key) {
   DefaultCache &DCache = *static_cast<DefaultCache*>(Impl);
-  llvm::sys::ScopedLock L(DCache.Mux);
-
+  DefaultCacheGarbage Garbage;
   DefaultCacheKey CKey(const_cast<void*>(Key), &DCache.CBs);
-  auto Entry = DCache.Entries.find(CKey);
-  if (Entry != DCache.Entries.end()) {
-    DCache.CBs.keyDestroyCB(Entry->first.Key, nullptr);
-    DCache.CBs.valueDestroyCB(Entry->second, nullptr);
-    DCache.Entries.erase(Entry);
-    return true;
+  auto &Shard = DCache.getEntryShard(CKey);
+  {
+    llvm::sys::ScopedLock L(Shard.Mux);
+    auto Entry = Shard.Entries.find(CKey);
+    if (Entry == Shard.Entries.end())
+      return false;
+    DCache.removeEntry(Shard, Entry, Garbage);
   }
-  return false;
+  DCache.collect(Garbage);
+  return true;
 }
 
 void CacheImpl::removeAll() {
   DefaultCache &DCache = *static_cast<DefaultCache*>(Impl);
-  llvm::sys::ScopedLock L(DCache.Mux);
-
-  for (auto Entry : DCache.Entries) {
-    DCache.CBs.keyDestroyCB(Entry.first.Key, nullptr);
-    DCache.CBs.valueDestroyCB(Entry.second, nullptr);
+  DefaultCacheGarbage Garbage;
+  for (auto &Shard : DCache.EntryShards) {
+    llvm::sys::ScopedLock L(Shard.Mux);
+    // Erasing from a DenseMap does not invalidate other iterators.
+    for (auto I = Shard.Entries.begin(), E = Shard.Entries.end(); I != E;) {
+      auto Entry = I++;
+      DCache.removeEntry(Shard, Entry, Garbage);
+    }
   }
-  DCache.Entries.clear();
+  DCache.collect(Garbage);
+}
+
+void CacheImpl::setCostLimit(size_t Limit) {
+  DefaultCache &DCache = *static_cast<DefaultCache*>(Impl);
+  DCache.CostLimit.store(Limit, std::memory_order_relaxed);
+  DCache.evictIfNeeded();
 }
 
 void CacheImpl::destroy() {
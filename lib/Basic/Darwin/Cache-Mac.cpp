@@ -65,6 +65,10 @@ void CacheImpl::removeAll() {
   cache_remove_all(static_cast<cache_t*>(Impl));
 }
 
+void CacheImpl::setCostLimit(size_t Limit) {
+  // libcache evicts values based on system memory pressure instead.
+}
+
 void CacheImpl::destroy() {
   cache_destroy(static_cast<cache_t*>(Impl));
 }
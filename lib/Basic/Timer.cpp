@@ -14,4 +14,5 @@
 
 using namespace swift;
 
-SharedTimer::State SharedTimer::CompilationTimersEnabled = State::Initial;
+std::atomic<SharedTimer::State>
+SharedTimer::CompilationTimersEnabled(State::Initial);
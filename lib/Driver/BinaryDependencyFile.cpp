@@ -0,0 +1,185 @@
+//===--- BinaryDependencyFile.cpp - Binary reference dependencies ---------===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2016 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+
+#include "swift/Driver/BinaryDependencyFile.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/EndianStream.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace swift;
+using namespace llvm::support;
+
+static const char Magic[] = { '\0', 'S', 'D', 'P' };
+
+static const size_t HeaderSize = sizeof(Magic) + 4 * sizeof(uint32_t);
+static const size_t EntrySize = sizeof(uint32_t) + 2 * sizeof(uint8_t);
+
+StringRef swift::getDependencySectionName(DependencySection section) {
+  switch (section) {
+  case DependencySection::ProvidesTopLevel:
+    return "provides-top-level";
+  case DependencySection::ProvidesNominal:
+    return "provides-nominal";
+  case DependencySection::ProvidesMember:
+    return "provides-member";
+  case DependencySection::ProvidesDynamicLookup:
+    return "provides-dynamic-lookup";
+  case DependencySection::DependsTopLevel:
+    return "depends-top-level";
+  case DependencySection::DependsNominal:
+    return "depends-nominal";
+  case DependencySection::DependsMember:
+    return "depends-member";
+  case DependencySection::DependsDynamicLookup:
+    return "depends-dynamic-lookup";
+  case DependencySection::DependsExternal:
+    return "depends-external";
+  }
+  llvm_unreachable("bad dependency section");
+}
+
+BinaryDependencyFileWriter::BinaryDependencyFileWriter()
+  : InterfaceHash(BinaryDependencyFileReader::NoString) {}
+
+uint32_t BinaryDependencyFileWriter::intern(StringRef string) {
+  auto insertResult = StringIndices.insert({string, Strings.size()});
+  if (insertResult.second)
+    Strings.push_back(insertResult.first->getKey());
+  return insertResult.first->getValue();
+}
+
+void BinaryDependencyFileWriter::addName(DependencySection section,
+                                         StringRef name, bool isCascading) {
+  assert(!isMemberDependencySection(section) && "use addMember");
+  Entries.push_back({intern(name), section, isCascading});
+}
+
+void BinaryDependencyFileWriter::addMember(DependencySection section,
+                                           StringRef base, StringRef member,
+                                           bool isCascading) {
+  assert(isMemberDependencySection(section) && "use addName");
+  SmallString<64> joined{base};
+  joined.push_back('\0');
+  joined += member;
+  Entries.push_back({intern(joined), section, isCascading});
+}
+
+void BinaryDependencyFileWriter::setInterfaceHash(StringRef hash) {
+  InterfaceHash = intern(hash);
+}
+
+void BinaryDependencyFileWriter::write(raw_ostream &out) const {
+  endian::Writer<little> writer(out);
+
+  out.write(Magic, sizeof(Magic));
+  writer.write<uint32_t>(BinaryDependencyFileReader::Version);
+  writer.write<uint32_t>(Entries.size());
+  writer.write<uint32_t>(Strings.size());
+  writer.write<uint32_t>(InterfaceHash);
+
+  for (auto &entry : Entries) {
+    writer.write<uint32_t>(entry.String);
+    writer.write<uint8_t>(static_cast<uint8_t>(entry.Section));
+    writer.write<uint8_t>(entry.IsCascading);
+  }
+
+  uint32_t offset = 0;
+  for (auto string : Strings) {
+    writer.write<uint32_t>(offset);
+    offset += string.size();
+  }
+  writer.write<uint32_t>(offset);
+
+  for (auto string : Strings)
+    out << string;
+}
+
+bool BinaryDependencyFileReader::isBinaryDependencyFile(StringRef data) {
+  return data.startswith(StringRef(Magic, sizeof(Magic)));
+}
+
+bool BinaryDependencyFileReader::initialize(StringRef data) {
+  if (!isBinaryDependencyFile(data) || data.size() < HeaderSize)
+    return false;
+
+  const char *cursor = data.data() + sizeof(Magic);
+  if (endian::readNext<uint32_t, little, unaligned>(cursor) != Version)
+    return false;
+  uint32_t numEntries = endian::readNext<uint32_t, little, unaligned>(cursor);
+  uint32_t numStrings = endian::readNext<uint32_t, little, unaligned>(cursor);
+  uint32_t interfaceHash =
+    endian::readNext<uint32_t, little, unaligned>(cursor);
+
+  // Compute the sizes in 64 bits so that hostile counts cannot overflow.
+  uint64_t tablesSize = uint64_t(numEntries) * EntrySize +
+                        (uint64_t(numStrings) + 1) * sizeof(uint32_t);
+  if (tablesSize > data.size() - HeaderSize)
+    return false;
+  const char *entryData = cursor;
+  const char *offsetData = entryData + uint64_t(numEntries) * EntrySize;
+  const char *stringData = data.data() + HeaderSize + tablesSize;
+  size_t stringDataSize = data.end() - stringData;
+
+  // The offsets have to be ascending and end within the data.
+  uint32_t previousOffset = 0;
+  for (uint32_t i = 0; i <= numStrings; ++i) {
+    uint32_t offset =
+      endian::read<uint32_t, little, unaligned>(offsetData +
+                                                i * sizeof(uint32_t));
+    if (offset < previousOffset || offset > stringDataSize)
+      return false;
+    previousOffset = offset;
+  }
+
+  if (interfaceHash != NoString && interfaceHash >= numStrings)
+    return false;
+
+  for (uint32_t i = 0; i != numEntries; ++i) {
+    const char *entry = entryData + i * EntrySize;
+    uint32_t string = endian::read<uint32_t, little, unaligned>(entry);
+    uint8_t section = entry[sizeof(uint32_t)];
+    if (string >= numStrings ||
+        section > uint8_t(DependencySection::Last_DependencySection))
+      return false;
+  }
+
+  EntryData = entryData;
+  OffsetData = offsetData;
+  StringData = stringData;
+  NumEntries = numEntries;
+  InterfaceHash = interfaceHash;
+  return true;
+}
+
+StringRef BinaryDependencyFileReader::getString(uint32_t index) const {
+  const char *offsets = OffsetData + index * sizeof(uint32_t);
+  uint32_t begin = endian::readNext<uint32_t, little, unaligned>(offsets);
+  uint32_t end = endian::readNext<uint32_t, little, unaligned>(offsets);
+  return StringRef(StringData + begin, end - begin);
+}
+
+BinaryDependencyFileReader::Entry
+BinaryDependencyFileReader::getEntry(unsigned index) const {
+  assert(index < NumEntries && "entry index out of range");
+  const char *entry = EntryData + index * EntrySize;
+  uint32_t string = endian::readNext<uint32_t, little, unaligned>(entry);
+  auto section = static_cast<DependencySection>(entry[0]);
+  bool isCascading = entry[1] != 0;
+  return { section, getString(string), isCascading };
+}
+
+Optional<StringRef> BinaryDependencyFileReader::getInterfaceHash() const {
+  if (InterfaceHash == NoString)
+    return None;
+  return getString(InterfaceHash);
+}
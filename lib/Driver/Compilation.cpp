@@ -21,6 +21,7 @@
 #include "swift/Basic/type_traits.h"
 #include "swift/Driver/Action.h"
 #include "swift/Driver/DependencyGraph.h"
+#include "swift/Driver/DependencyGraphCache.h"
 #include "swift/Driver/Driver.h"
 #include "swift/Driver/Job.h"
 #include "swift/Driver/ParseableOutput.h"
@@ -83,6 +84,18 @@ namespace {
     ///
     /// Only intended for source files.
     llvm::SmallDenseMap<const Job *, bool, 16> UnfinishedCommands;
+
+    /// In batch mode, compile jobs that are ready to run and are waiting to
+    /// be combined into batches.
+    SmallVector<const Job *, 16> PendingBatchableCommands;
+
+    /// The jobs that run batches of compile jobs, which are not part of the
+    /// Compilation.
+    SmallVector<std::unique_ptr<Job>, 4> BatchCommands;
+
+    /// A map from each batch job to the compile jobs it performs.
+    llvm::SmallDenseMap<const Job *, SmallVector<const Job *, 4>, 4>
+        BatchConstituents;
   };
 }
 
@@ -215,6 +228,180 @@ static void writeCompilationRecord(StringRef path, StringRef argsHash,
   }
 }
 
+/// Returns the path of the DependencyGraphCache that goes with the build
+/// record at \p recordPath.
+static std::string getDependencyGraphCachePath(StringRef recordPath) {
+  return (recordPath + ".graph").str();
+}
+
+static void writeDependencyGraphCache(StringRef path,
+                                      const DependencyGraphCache &previous,
+                                      ArrayRef<StringRef> dependenciesFiles) {
+  if (previous.isUpToDate(dependenciesFiles))
+    return;
+
+  std::error_code error;
+  llvm::raw_fd_ostream out(path, error, llvm::sys::fs::F_None);
+  if (out.has_error()) {
+    // The cache is only an optimization; the next build reads every
+    // dependencies file instead.
+    out.clear_error();
+    return;
+  }
+  previous.write(out, dependenciesFiles);
+}
+
+/// Returns true if \p Cmd can be combined with other compile jobs into one
+/// frontend invocation.
+static bool isBatchableCommand(const Job *Cmd) {
+  if (!isa<CompileJobAction>(Cmd->getSource()))
+    return false;
+  if (!Cmd->getFilelistInfo().path.empty() ||
+      !Cmd->getExtraEnvironment().empty())
+    return false;
+
+  const CommandOutput &Output = Cmd->getOutput();
+  switch (Output.getPrimaryOutputType()) {
+  case types::TY_Object:
+  case types::TY_RawSIL:
+  case types::TY_SIL:
+  case types::TY_LLVM_IR:
+  case types::TY_LLVM_BC:
+  case types::TY_Assembly:
+  case types::TY_SwiftModuleFile:
+    break;
+  default:
+    return false;
+  }
+  if (Output.getPrimaryOutputFilenames().size() != 1)
+    return false;
+
+  // The frontend writes these once per invocation rather than once per
+  // primary file.
+  return Output.getAdditionalOutputForType(
+           types::TY_SerializedDiagnostics).empty() &&
+         Output.getAdditionalOutputForType(types::TY_Remapping).empty() &&
+         Output.getAdditionalOutputForType(types::TY_ObjCHeader).empty();
+}
+
+/// The frontend options that name an output of a single primary file. A
+/// batch passes each of them once per primary file, in the order of the
+/// primary files.
+static const char *const PerPrimaryOutputOptions[] = {
+  "-o",
+  "-emit-module-path",
+  "-emit-module-doc-path",
+  "-emit-dependencies-path",
+  "-emit-reference-dependencies-path",
+};
+
+static bool isPerPrimaryOutputOption(StringRef Arg) {
+  return std::find(std::begin(PerPrimaryOutputOptions),
+                   std::end(PerPrimaryOutputOptions),
+                   Arg) != std::end(PerPrimaryOutputOptions);
+}
+
+/// Returns the value of the last \p Option in the arguments of \p Cmd, or
+/// null if there is none.
+static const char *getLastArgValue(const Job *Cmd, StringRef Option) {
+  const ArgStringList &Args = Cmd->getArguments();
+  const char *Value = nullptr;
+  for (size_t i = 0, e = Args.size(); i + 1 < e; ++i)
+    if (Args[i] == Option)
+      Value = Args[i + 1];
+  return Value;
+}
+
+/// Builds the arguments of one frontend invocation that performs all the
+/// compile jobs in \p Batch, starting from the arguments of the first one.
+///
+/// The frontend arguments of a compile job start with "-frontend" and the
+/// mode option, followed by the inputs, one of them marked with
+/// -primary-file, or by a -filelist and a single -primary-file.
+///
+/// The frontend gives the Nth of each per-file output to the Nth primary file
+/// on its command line, so the outputs are added in the order the primary
+/// files are marked, which need not be the order of \p Batch.
+static ArgStringList buildBatchArguments(ArrayRef<const Job *> Batch) {
+  const ArgStringList &FirstArgs = Batch.front()->getArguments();
+  assert(FirstArgs.size() >= 2 && StringRef(FirstArgs[0]) == "-frontend" &&
+         "not a frontend invocation");
+
+  SmallVector<const char *, 16> PrimaryInputs;
+  llvm::DenseMap<StringRef, const Job *> JobsByPrimaryInput;
+  for (const Job *Cmd : Batch) {
+    const char *PrimaryInput = getLastArgValue(Cmd, "-primary-file");
+    assert(PrimaryInput && "batched compile job without a primary file");
+    PrimaryInputs.push_back(PrimaryInput);
+    JobsByPrimaryInput[PrimaryInput] = Cmd;
+  }
+
+  // The jobs of the batch, in the order their primary files are marked.
+  SmallVector<const Job *, 16> OrderedBatch;
+
+  ArgStringList Args(FirstArgs.begin(), FirstArgs.begin() + 2);
+  size_t i = 2, e = FirstArgs.size();
+
+  // Mark every primary file of the batch among the inputs.
+  for (; i != e; ++i) {
+    StringRef Arg = FirstArgs[i];
+    if (Arg == "-primary-file")
+      continue;
+    if (Arg.startswith("-"))
+      break;
+    auto Found = JobsByPrimaryInput.find(Arg);
+    if (Found != JobsByPrimaryInput.end()) {
+      Args.push_back("-primary-file");
+      OrderedBatch.push_back(Found->second);
+    }
+    Args.push_back(FirstArgs[i]);
+  }
+
+  for (; i != e; ++i) {
+    StringRef Arg = FirstArgs[i];
+    if (Arg == "-primary-file") {
+      // With a -filelist, the primary files are given on their own.
+      assert(OrderedBatch.empty() && "primary files given twice");
+      for (const char *PrimaryInput : PrimaryInputs) {
+        Args.push_back("-primary-file");
+        Args.push_back(PrimaryInput);
+      }
+      OrderedBatch.append(Batch.begin(), Batch.end());
+      ++i;
+      continue;
+    }
+    if (isPerPrimaryOutputOption(Arg)) {
+      ++i;
+      continue;
+    }
+    Args.push_back(FirstArgs[i]);
+  }
+
+  assert(OrderedBatch.size() == Batch.size() &&
+         "not every primary file of the batch was found");
+  for (const char *Option : PerPrimaryOutputOptions) {
+    for (const Job *Cmd : OrderedBatch) {
+      if (const char *Value = getLastArgValue(Cmd, Option)) {
+        Args.push_back(Option);
+        Args.push_back(Value);
+      }
+    }
+  }
+
+  return Args;
+}
+
+/// Creates a job that performs all the compile jobs in \p Batch in one
+/// frontend invocation.
+static std::unique_ptr<Job> makeBatchCommand(ArrayRef<const Job *> Batch) {
+  const Job *First = Batch.front();
+  SmallVector<const Job *, 4> NoInputs;
+  std::unique_ptr<CommandOutput> Output(new CommandOutput(First->getOutput()));
+  return llvm::make_unique<Job>(First->getSource(), std::move(NoInputs),
+                                std::move(Output), First->getExecutable(),
+                                buildBatchArguments(Batch));
+}
+
 static bool writeFilelistIfNecessary(const Job *job, DiagnosticEngine &diags) {
   FilelistInfo filelistInfo = job->getFilelistInfo();
   if (filelistInfo.path.empty())
@@ -264,6 +451,10 @@ int Compilation::performJobsImpl() {
 
   using DependencyGraph = DependencyGraph<const Job *>;
   DependencyGraph DepGraph;
+  DependencyGraphCache DepGraphCache;
+  if (getIncrementalBuildEnabled() && !CompilationRecordPath.empty())
+    DepGraphCache.loadFromPath(
+      getDependencyGraphCachePath(CompilationRecordPath));
   SmallPtrSet<const Job *, 16> DeferredCommands;
   SmallVector<const Job *, 16> InitialOutOfDateCommands;
 
@@ -307,10 +498,56 @@ int Compilation::performJobsImpl() {
     assert(Cmd->getExtraEnvironment().empty() &&
            "not implemented for compilations with multiple jobs");
     State.ScheduledCommands.insert(Cmd);
+    if (getBatchModeEnabled() && isBatchableCommand(Cmd)) {
+      State.PendingBatchableCommands.push_back(Cmd);
+      return;
+    }
     TQ->addTask(Cmd->getExecutable(), Cmd->getArguments(), llvm::None,
                 (void *)Cmd);
   };
 
+  // In batch mode, split the compile jobs that are ready to run into as many
+  // batches as there are commands allowed to run in parallel, and queue one
+  // frontend invocation per batch.
+  auto flushPendingBatchableCommands = [&] {
+    ArrayRef<const Job *> Pending = State.PendingBatchableCommands;
+    if (Pending.empty())
+      return;
+
+    size_t NumBatches = std::min<size_t>(
+      std::max(NumberOfParallelCommands, 1U), Pending.size());
+    for (size_t i = 0; i != NumBatches; ++i) {
+      size_t Begin = i * Pending.size() / NumBatches;
+      size_t End = (i + 1) * Pending.size() / NumBatches;
+      ArrayRef<const Job *> Batch = Pending.slice(Begin, End - Begin);
+
+      if (Batch.size() == 1) {
+        TQ->addTask(Batch.front()->getExecutable(),
+                    Batch.front()->getArguments(), llvm::None,
+                    (void *)Batch.front());
+        continue;
+      }
+
+      std::unique_ptr<Job> BatchCmd = makeBatchCommand(Batch);
+      State.BatchConstituents[BatchCmd.get()].append(Batch.begin(),
+                                                     Batch.end());
+      TQ->addTask(BatchCmd->getExecutable(), BatchCmd->getArguments(),
+                  llvm::None, (void *)BatchCmd.get());
+      State.BatchCommands.push_back(std::move(BatchCmd));
+    }
+    State.PendingBatchableCommands.clear();
+  };
+
+  // Returns the compile jobs performed by a task: the jobs of a batch, or
+  // the task's own job. \p Cmd is taken by reference so that the result can
+  // point to it.
+  auto getConstituents = [&] (const Job *const &Cmd) -> ArrayRef<const Job *> {
+    auto Found = State.BatchConstituents.find(Cmd);
+    if (Found != State.BatchConstituents.end())
+      return Found->second;
+    return Cmd;
+  };
+
   // When a task finishes, we need to reevaluate the other commands that
   // might have been blocked.
   auto markFinished = [&] (const Job *Cmd) {
@@ -344,7 +581,14 @@ int Compilation::performJobsImpl() {
       if (Cmd->getCondition() == Job::Condition::NewlyAdded) {
         DepGraph.addIndependentNode(Cmd);
       } else {
-        switch (DepGraph.loadFromPath(Cmd, DependenciesFile)) {
+        // Only read the dependencies files that changed since the last build.
+        DependencyGraphImpl::LoadResult DepsLoadResult;
+        if (auto Cached = DepGraphCache.lookup(DependenciesFile))
+          DepsLoadResult = DepGraph.loadFromEntries(Cmd, Cached->InterfaceHash,
+                                                    Cached->Entries);
+        else
+          DepsLoadResult = DepGraph.loadFromPath(Cmd, DependenciesFile);
+        switch (DepsLoadResult) {
         case DependencyGraphImpl::LoadResult::HadError:
           disableIncrementalBuild();
           for (const Job *Cmd : DeferredCommands)
@@ -425,58 +669,22 @@ int Compilation::performJobsImpl() {
   // Set up a callback which will be called immediately after a task has
   // started. This callback may be used to provide output indicating that the
   // task began.
-  auto taskBegan = [this] (ProcessId Pid, void *Context) {
+  auto taskBegan = [&] (ProcessId Pid, void *Context) {
     // TODO: properly handle task began.
     const Job *BeganCmd = (const Job *)Context;
 
     // For verbose output, print out each command as it begins execution.
-    if (Level == OutputLevel::Verbose)
+    if (Level == OutputLevel::Verbose) {
       BeganCmd->printCommandLine(llvm::errs());
-    else if (Level == OutputLevel::Parseable)
-      parseable_output::emitBeganMessage(llvm::errs(), *BeganCmd, Pid);
-  };
-
-  // Set up a callback which will be called immediately after a task has
-  // finished execution. This callback should determine if execution should
-  // continue (if execution should stop, this callback should return true), and
-  // it should also schedule any additional commands which we now know need
-  // to run.
-  auto taskFinished = [&] (ProcessId Pid, int ReturnCode, StringRef Output,
-                           void *Context) -> TaskFinishedResponse {
-    const Job *FinishedCmd = (const Job *)Context;
-
-    if (Level == OutputLevel::Parseable) {
-      // Parseable output was requested.
-      parseable_output::emitFinishedMessage(llvm::errs(), *FinishedCmd, Pid,
-                                            ReturnCode, Output);
-    } else {
-      // Otherwise, send the buffered output to stderr, though only if we
-      // support getting buffered output.
-      if (TaskQueue::supportsBufferingOutput())
-        llvm::errs() << Output;
-    }
-
-    if (ReturnCode != EXIT_SUCCESS) {
-      // The task failed, so return true without performing any further
-      // dependency analysis.
-
-      // Store this task's ReturnCode as our Result if we haven't stored
-      // anything yet.
-      if (Result == EXIT_SUCCESS)
-        Result = ReturnCode;
-
-      if (!isa<CompileJobAction>(FinishedCmd->getSource()) ||
-          ReturnCode != EXIT_FAILURE) {
-        Diags.diagnose(SourceLoc(), diag::error_command_failed,
-                       FinishedCmd->getSource().getClassName(),
-                       ReturnCode);
-      }
-
-      return ContinueBuildingAfterErrors ?
-          TaskFinishedResponse::ContinueExecution :
-          TaskFinishedResponse::StopExecution;
+    } else if (Level == OutputLevel::Parseable) {
+      for (const Job *Cmd : getConstituents(BeganCmd))
+        parseable_output::emitBeganMessage(llvm::errs(), *Cmd, Pid);
     }
+  };
 
+  // Marks a job that finished successfully as finished, and schedules the
+  // commands that were waiting on it.
+  auto finishCommand = [&] (const Job *FinishedCmd) {
     // When a task finishes, we need to reevaluate the other commands that
     // might have been blocked.
     markFinished(FinishedCmd);
@@ -515,18 +723,78 @@ int Compilation::performJobsImpl() {
         }
       }
     }
+  };
+
+  // Set up a callback which will be called immediately after a task has
+  // finished execution. This callback should determine if execution should
+  // continue (if execution should stop, this callback should return true), and
+  // it should also schedule any additional commands which we now know need
+  // to run.
+  auto taskFinished = [&] (ProcessId Pid, int ReturnCode, StringRef Output,
+                           Optional<TaskResourceUsage> Usage,
+                           void *Context) -> TaskFinishedResponse {
+    const Job *FinishedCmd = (const Job *)Context;
+
+    if (Level == OutputLevel::Parseable) {
+      // Parseable output was requested. The output and resource usage of a
+      // batch are reported with its first job. The diagnostics of the batch
+      // are not split by primary file; see DriverParseableOutput.rst.
+      StringRef CmdOutput = Output;
+      for (const Job *Cmd : getConstituents(FinishedCmd)) {
+        parseable_output::emitFinishedMessage(llvm::errs(), *Cmd, Pid,
+                                              ReturnCode, CmdOutput, Usage);
+        CmdOutput = StringRef();
+        Usage = None;
+      }
+    } else {
+      // Otherwise, send the buffered output to stderr, though only if we
+      // support getting buffered output.
+      if (TaskQueue::supportsBufferingOutput())
+        llvm::errs() << Output;
+    }
+
+    if (ReturnCode != EXIT_SUCCESS) {
+      // The task failed, so return true without performing any further
+      // dependency analysis.
+
+      // Store this task's ReturnCode as our Result if we haven't stored
+      // anything yet.
+      if (Result == EXIT_SUCCESS)
+        Result = ReturnCode;
+
+      if (!isa<CompileJobAction>(FinishedCmd->getSource()) ||
+          ReturnCode != EXIT_FAILURE) {
+        Diags.diagnose(SourceLoc(), diag::error_command_failed,
+                       FinishedCmd->getSource().getClassName(),
+                       ReturnCode);
+      }
+
+      return ContinueBuildingAfterErrors ?
+          TaskFinishedResponse::ContinueExecution :
+          TaskFinishedResponse::StopExecution;
+    }
+
+    for (const Job *Cmd : getConstituents(FinishedCmd))
+      finishCommand(Cmd);
+    flushPendingBatchableCommands();
 
     return TaskFinishedResponse::ContinueExecution;
   };
 
   auto taskSignalled = [&] (ProcessId Pid, StringRef ErrorMsg, StringRef Output,
+                            Optional<TaskResourceUsage> Usage,
                             void *Context) -> TaskFinishedResponse {
     const Job *SignalledCmd = (const Job *)Context;
 
     if (Level == OutputLevel::Parseable) {
       // Parseable output was requested.
-      parseable_output::emitSignalledMessage(llvm::errs(), *SignalledCmd, Pid,
-                                             ErrorMsg, Output);
+      StringRef CmdOutput = Output;
+      for (const Job *Cmd : getConstituents(SignalledCmd)) {
+        parseable_output::emitSignalledMessage(llvm::errs(), *Cmd, Pid,
+                                               ErrorMsg, CmdOutput, Usage);
+        CmdOutput = StringRef();
+        Usage = None;
+      }
     } else {
       // Otherwise, send the buffered output to stderr, though only if we
       // support getting buffered output.
@@ -549,6 +817,7 @@ int Compilation::performJobsImpl() {
 
   do {
     // Ask the TaskQueue to execute.
+    flushPendingBatchableCommands();
     TQ->execute(taskBegan, taskFinished, taskSignalled);
 
     // Mark all remaining deferred commands as skipped.
@@ -597,6 +866,17 @@ int Compilation::performJobsImpl() {
     checkForOutOfDateInputs(Diags, InputInfo);
     writeCompilationRecord(CompilationRecordPath, ArgsHash, BuildStartTime,
                            InputInfo);
+
+    SmallVector<StringRef, 16> DependenciesFiles;
+    for (const Job *Cmd : getJobs()) {
+      StringRef DependenciesFile =
+        Cmd->getOutput().getAdditionalOutputForType(types::TY_SwiftDeps);
+      if (!DependenciesFile.empty())
+        DependenciesFiles.push_back(DependenciesFile);
+    }
+    writeDependencyGraphCache(
+      getDependencyGraphCachePath(CompilationRecordPath), DepGraphCache,
+      DependenciesFiles);
   }
 
   if (Result == 0)
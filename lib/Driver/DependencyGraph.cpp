@@ -12,9 +12,9 @@
 
 #include "swift/Driver/DependencyGraph.h"
 #include "swift/Basic/DemangleWrappers.h"
+#include "swift/Driver/BinaryDependencyFile.h"
 #include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/SmallVector.h"
-#include "llvm/ADT/StringSwitch.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/MemoryBuffer.h"
@@ -49,6 +49,90 @@ using DependencyKind = DependencyGraphImpl::DependencyKind;
 using DependencyCallbackTy = LoadResult(StringRef, DependencyKind, bool);
 using InterfaceHashCallbackTy = LoadResult(StringRef);
 
+/// Returns the kind of the entries in \p section, and whether they are
+/// dependencies (rather than things provided).
+static std::pair<DependencyKind, bool>
+getKindAndDirection(DependencySection section) {
+  switch (section) {
+  case DependencySection::ProvidesTopLevel:
+    return { DependencyKind::TopLevelName, false };
+  case DependencySection::ProvidesNominal:
+    return { DependencyKind::NominalType, false };
+  case DependencySection::ProvidesMember:
+    return { DependencyKind::NominalTypeMember, false };
+  case DependencySection::ProvidesDynamicLookup:
+    return { DependencyKind::DynamicLookupName, false };
+  case DependencySection::DependsTopLevel:
+    return { DependencyKind::TopLevelName, true };
+  case DependencySection::DependsNominal:
+    return { DependencyKind::NominalType, true };
+  case DependencySection::DependsMember:
+    return { DependencyKind::NominalTypeMember, true };
+  case DependencySection::DependsDynamicLookup:
+    return { DependencyKind::DynamicLookupName, true };
+  case DependencySection::DependsExternal:
+    return { DependencyKind::ExternalFile, true };
+  }
+  llvm_unreachable("bad dependency section");
+}
+
+/// Returns the section that holds entries of \p kind in the given direction.
+static DependencySection getSection(DependencyKind kind, bool isDepends) {
+  for (unsigned candidate = 0;
+       candidate <= unsigned(DependencySection::Last_DependencySection);
+       ++candidate) {
+    auto kindAndDirection = getKindAndDirection(DependencySection(candidate));
+    if (kindAndDirection.first == kind && kindAndDirection.second == isDepends)
+      return DependencySection(candidate);
+  }
+  llvm_unreachable("no section for this kind of entry");
+}
+
+// After an entry, we know more about the node as a whole.
+// Update the "result" variable in the caller.
+// This is a macro rather than a lambda because it contains a return.
+#define UPDATE_RESULT(update) switch (update) {\
+    case LoadResult::HadError: \
+      return LoadResult::HadError; \
+    case LoadResult::UpToDate: \
+      break; \
+    case LoadResult::AffectsDownstream: \
+      result = LoadResult::AffectsDownstream; \
+      break; \
+    } \
+
+/// Passes \p entry to the callback for its direction.
+static LoadResult
+reportEntry(const DependencyGraphImpl::DependencyFileEntry &entry,
+            llvm::function_ref<DependencyCallbackTy> providesCallback,
+            llvm::function_ref<DependencyCallbackTy> dependsCallback) {
+  auto kindAndDirection = getKindAndDirection(entry.Section);
+  auto &callback = kindAndDirection.second ? dependsCallback : providesCallback;
+  return callback(entry.Name, kindAndDirection.first, entry.IsCascading);
+}
+
+static LoadResult
+parseBinaryDependencyFile(StringRef data,
+                    llvm::function_ref<DependencyCallbackTy> providesCallback,
+                    llvm::function_ref<DependencyCallbackTy> dependsCallback,
+                    llvm::function_ref<InterfaceHashCallbackTy> interfaceHashCallback) {
+  BinaryDependencyFileReader reader;
+  if (!reader.initialize(data))
+    return LoadResult::HadError;
+
+  LoadResult result = LoadResult::UpToDate;
+
+  if (auto interfaceHash = reader.getInterfaceHash())
+    UPDATE_RESULT(interfaceHashCallback(interfaceHash.getValue()));
+
+  for (unsigned i = 0, e = reader.getNumEntries(); i != e; ++i) {
+    UPDATE_RESULT(reportEntry(reader.getEntry(i), providesCallback,
+                              dependsCallback));
+  }
+
+  return result;
+}
+
 static LoadResult
 parseDependencyFile(llvm::MemoryBuffer &buffer,
                     llvm::function_ref<DependencyCallbackTy> providesCallback,
@@ -56,7 +140,10 @@ parseDependencyFile(llvm::MemoryBuffer &buffer,
                     llvm::function_ref<InterfaceHashCallbackTy> interfaceHashCallback) {
   namespace yaml = llvm::yaml;
 
-  // FIXME: Switch to a format other than YAML.
+  if (BinaryDependencyFileReader::isBinaryDependencyFile(buffer.getBuffer()))
+    return parseBinaryDependencyFile(buffer.getBuffer(), providesCallback,
+                                     dependsCallback, interfaceHashCallback);
+
   llvm::SourceMgr SM;
   yaml::Stream stream(buffer.getMemBufferRef(), SM);
   auto I = stream.begin();
@@ -73,19 +160,6 @@ parseDependencyFile(llvm::MemoryBuffer &buffer,
   LoadResult result = LoadResult::UpToDate;
   SmallString<64> scratch;
 
-  // After an entry, we know more about the node as a whole.
-  // Update the "result" variable above.
-  // This is a macro rather than a lambda because it contains a return.
-#define UPDATE_RESULT(update) switch (update) {\
-    case LoadResult::HadError: \
-      return LoadResult::HadError; \
-    case LoadResult::UpToDate: \
-      break; \
-    case LoadResult::AffectsDownstream: \
-      result = LoadResult::AffectsDownstream; \
-      break; \
-    } \
-
   // FIXME: LLVM's YAML support does incremental parsing in such a way that
   // for-range loops break.
   for (auto i = topLevelMap->begin(), e = topLevelMap->end(); i != e; ++i) {
@@ -106,45 +180,22 @@ parseDependencyFile(llvm::MemoryBuffer &buffer,
       UPDATE_RESULT(interfaceHashCallback(valueString));
 
     } else {
-      enum class DependencyDirection : bool {
-        Depends,
-        Provides
-      };
-      using KindPair = std::pair<DependencyKind, DependencyDirection>;
-
-      KindPair dirAndKind = llvm::StringSwitch<KindPair>(key->getValue(scratch))
-        .Case("depends-top-level",
-              std::make_pair(DependencyKind::TopLevelName,
-                             DependencyDirection::Depends))
-        .Case("depends-nominal",
-              std::make_pair(DependencyKind::NominalType,
-                             DependencyDirection::Depends))
-        .Case("depends-member",
-              std::make_pair(DependencyKind::NominalTypeMember,
-                             DependencyDirection::Depends))
-        .Case("depends-dynamic-lookup",
-              std::make_pair(DependencyKind::DynamicLookupName,
-                             DependencyDirection::Depends))
-        .Case("depends-external",
-              std::make_pair(DependencyKind::ExternalFile,
-                             DependencyDirection::Depends))
-        .Case("provides-top-level",
-              std::make_pair(DependencyKind::TopLevelName,
-                             DependencyDirection::Provides))
-        .Case("provides-nominal",
-              std::make_pair(DependencyKind::NominalType,
-                             DependencyDirection::Provides))
-        .Case("provides-member",
-              std::make_pair(DependencyKind::NominalTypeMember,
-                             DependencyDirection::Provides))
-        .Case("provides-dynamic-lookup",
-              std::make_pair(DependencyKind::DynamicLookupName,
-                             DependencyDirection::Provides))
-        .Default(std::make_pair(DependencyKind(),
-                                DependencyDirection::Depends));
-      if (dirAndKind.first == DependencyKind())
+      Optional<DependencySection> section;
+      for (unsigned candidate = 0;
+           candidate <= unsigned(DependencySection::Last_DependencySection);
+           ++candidate) {
+        if (keyString == getDependencySectionName(
+                           DependencySection(candidate))) {
+          section = DependencySection(candidate);
+          break;
+        }
+      }
+      if (!section)
         return LoadResult::HadError;
 
+      auto dirAndKind = getKindAndDirection(section.getValue());
+      bool isDepends = dirAndKind.second;
+
       auto *entries = dyn_cast<yaml::SequenceNode>(i->getValue());
       if (!entries)
         return LoadResult::HadError;
@@ -174,7 +225,6 @@ parseDependencyFile(llvm::MemoryBuffer &buffer,
           // iterators.
           assert(!(iter != entry->end()));
 
-          bool isDepends = dirAndKind.second == DependencyDirection::Depends;
           auto &callback = isDepends ? dependsCallback : providesCallback;
 
           // Smash the type and member names together so we can continue using
@@ -193,7 +243,6 @@ parseDependencyFile(llvm::MemoryBuffer &buffer,
           if (!entry)
             return LoadResult::HadError;
 
-          bool isDepends = dirAndKind.second == DependencyDirection::Depends;
           auto &callback = isDepends ? dependsCallback : providesCallback;
 
           UPDATE_RESULT(callback(entry->getValue(scratch), dirAndKind.first,
@@ -219,8 +268,60 @@ DependencyGraphImpl::loadFromString(const void *node, StringRef data) {
   return loadFromBuffer(node, *buffer);
 }
 
+bool DependencyGraphImpl::readDependencyFile(
+    llvm::MemoryBuffer &buffer,
+    llvm::function_ref<void(StringRef)> interfaceHashCallback,
+    llvm::function_ref<void(const DependencyFileEntry &)> entryCallback) {
+  auto reportCallback = [entryCallback](bool isDepends) {
+    return [entryCallback, isDepends](StringRef name, DependencyKind kind,
+                                      bool isCascading) -> LoadResult {
+      entryCallback({ getSection(kind, isDepends), name, isCascading });
+      return LoadResult::UpToDate;
+    };
+  };
+  auto providesCallback = reportCallback(false);
+  auto dependsCallback = reportCallback(true);
+
+  auto result = parseDependencyFile(buffer, providesCallback, dependsCallback,
+                                    [interfaceHashCallback](StringRef hash) {
+    interfaceHashCallback(hash);
+    return LoadResult::UpToDate;
+  });
+  return result != LoadResult::HadError;
+}
+
 LoadResult DependencyGraphImpl::loadFromBuffer(const void *node,
                                                llvm::MemoryBuffer &buffer) {
+  return loadWithParser(node, [&buffer](
+      llvm::function_ref<DependencyCallbackTy> providesCallback,
+      llvm::function_ref<DependencyCallbackTy> dependsCallback,
+      llvm::function_ref<InterfaceHashCallbackTy> interfaceHashCallback) {
+    return parseDependencyFile(buffer, providesCallback, dependsCallback,
+                               interfaceHashCallback);
+  });
+}
+
+LoadResult
+DependencyGraphImpl::loadFromEntries(const void *node,
+                                     Optional<StringRef> interfaceHash,
+                                     ArrayRef<DependencyFileEntry> entries) {
+  return loadWithParser(node, [&](
+      llvm::function_ref<DependencyCallbackTy> providesCallback,
+      llvm::function_ref<DependencyCallbackTy> dependsCallback,
+      llvm::function_ref<InterfaceHashCallbackTy> interfaceHashCallback)
+        -> LoadResult {
+    LoadResult result = LoadResult::UpToDate;
+    if (interfaceHash)
+      UPDATE_RESULT(interfaceHashCallback(*interfaceHash));
+    for (auto &entry : entries)
+      UPDATE_RESULT(reportEntry(entry, providesCallback, dependsCallback));
+    return result;
+  });
+}
+
+LoadResult
+DependencyGraphImpl::loadWithParser(const void *node,
+                                    llvm::function_ref<ParserTy> parse) {
   auto &provides = Provides[node];
 
   auto dependsCallback = [this, node](StringRef name, DependencyKind kind,
@@ -285,8 +386,7 @@ LoadResult DependencyGraphImpl::loadFromBuffer(const void *node,
     return LoadResult::UpToDate;
   };
 
-  return parseDependencyFile(buffer, providesCallback, dependsCallback,
-                             interfaceHashCallback);
+  return parse(providesCallback, dependsCallback, interfaceHashCallback);
 }
 
 void DependencyGraphImpl::markExternal(SmallVectorImpl<const void *> &visited,
@@ -0,0 +1,232 @@
+//===--- DependencyGraphCache.cpp - Cached dependencies files -------------===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2016 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+
+#include "swift/Driver/DependencyGraphCache.h"
+#include "llvm/Support/Allocator.h"
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/EndianStream.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+
+using namespace swift;
+using namespace llvm::support;
+
+static const char Magic[] = { '\0', 'S', 'D', 'C' };
+
+static const size_t HeaderSize = sizeof(Magic) + 2 * sizeof(uint32_t);
+static const size_t FileHeaderSize =
+  2 * sizeof(uint64_t) + 4 * sizeof(uint32_t);
+static const size_t EntryHeaderSize = 2 * sizeof(uint8_t) + sizeof(uint32_t);
+
+bool DependencyGraphCache::loadFromPath(StringRef path) {
+  Files.clear();
+  auto buffer = llvm::MemoryBuffer::getFile(path, /*FileSize=*/-1,
+                                            /*RequiresNullTerminator=*/false);
+  if (!buffer)
+    return false;
+  if (!parse(buffer.get()->getBuffer()))
+    return false;
+  Buffer = std::move(buffer.get());
+  return true;
+}
+
+bool DependencyGraphCache::loadFromString(StringRef data) {
+  return parse(data);
+}
+
+bool DependencyGraphCache::parse(StringRef data) {
+  Files.clear();
+  if (data.size() < HeaderSize ||
+      !data.startswith(StringRef(Magic, sizeof(Magic))))
+    return false;
+
+  const char *cursor = data.data() + sizeof(Magic);
+  auto remaining = [&]() -> uint64_t { return data.end() - cursor; };
+  if (endian::readNext<uint32_t, little, unaligned>(cursor) != Version)
+    return false;
+  uint32_t numFiles = endian::readNext<uint32_t, little, unaligned>(cursor);
+
+  auto fail = [&]() -> bool {
+    Files.clear();
+    return false;
+  };
+
+  for (uint32_t i = 0; i != numFiles; ++i) {
+    if (remaining() < FileHeaderSize)
+      return fail();
+    uint64_t seconds = endian::readNext<uint64_t, little, unaligned>(cursor);
+    uint32_t nanoseconds =
+      endian::readNext<uint32_t, little, unaligned>(cursor);
+    uint64_t size = endian::readNext<uint64_t, little, unaligned>(cursor);
+    uint32_t pathSize = endian::readNext<uint32_t, little, unaligned>(cursor);
+    uint32_t hashSize = endian::readNext<uint32_t, little, unaligned>(cursor);
+    uint32_t numEntries = endian::readNext<uint32_t, little, unaligned>(cursor);
+
+    // Compute sizes in 64 bits so that hostile sizes cannot overflow.
+    uint64_t stringsSize = uint64_t(pathSize) +
+      (hashSize == NoInterfaceHash ? 0 : hashSize);
+    if (stringsSize > remaining() ||
+        uint64_t(numEntries) * EntryHeaderSize > remaining() - stringsSize)
+      return fail();
+
+    StringRef path(cursor, pathSize);
+    cursor += pathSize;
+    File file;
+    file.ModTime = llvm::sys::TimeValue(seconds, nanoseconds);
+    file.Size = size;
+    if (hashSize != NoInterfaceHash) {
+      file.InterfaceHash = StringRef(cursor, hashSize);
+      cursor += hashSize;
+    }
+
+    file.Entries.reserve(numEntries);
+    for (uint32_t j = 0; j != numEntries; ++j) {
+      if (remaining() < EntryHeaderSize)
+        return fail();
+      uint8_t section = endian::readNext<uint8_t, little, unaligned>(cursor);
+      uint8_t isCascading =
+        endian::readNext<uint8_t, little, unaligned>(cursor);
+      uint32_t nameSize = endian::readNext<uint32_t, little, unaligned>(cursor);
+      if (section > uint8_t(DependencySection::Last_DependencySection) ||
+          isCascading > 1 || nameSize > remaining())
+        return fail();
+      file.Entries.push_back({ DependencySection(section),
+                               StringRef(cursor, nameSize),
+                               bool(isCascading) });
+      cursor += nameSize;
+    }
+
+    Files.insert({ path, std::move(file) });
+  }
+
+  if (cursor != data.end())
+    return fail();
+  return true;
+}
+
+const DependencyGraphCache::File *
+DependencyGraphCache::lookupFile(StringRef path) const {
+  auto iter = Files.find(path);
+  if (iter == Files.end())
+    return nullptr;
+
+  llvm::sys::fs::file_status status;
+  if (llvm::sys::fs::status(path, status))
+    return nullptr;
+  const File &file = iter->getValue();
+  if (status.getSize() != file.Size ||
+      status.getLastModificationTime() != file.ModTime)
+    return nullptr;
+  return &file;
+}
+
+Optional<DependencyGraphCache::Dependencies>
+DependencyGraphCache::lookup(StringRef path) const {
+  const File *file = lookupFile(path);
+  if (!file)
+    return None;
+  return Dependencies{ file->InterfaceHash, file->Entries };
+}
+
+bool DependencyGraphCache::isUpToDate(ArrayRef<StringRef> paths) const {
+  if (paths.size() != Files.size())
+    return false;
+  return std::all_of(paths.begin(), paths.end(), [this](StringRef path) {
+    return lookupFile(path) != nullptr;
+  });
+}
+
+void DependencyGraphCache::write(raw_ostream &out,
+                                 ArrayRef<StringRef> paths) const {
+  auto now = llvm::sys::TimeValue::now();
+
+  struct NewFile {
+    StringRef Path;
+    const File *Recorded;
+  };
+  SmallVector<NewFile, 16> newFiles;
+
+  // The files that have to be read again, and the strings of their entries.
+  // Member names contain a NUL, so the strings are copied with their sizes.
+  std::vector<std::unique_ptr<File>> readFiles;
+  llvm::BumpPtrAllocator allocator;
+  auto save = [&allocator](StringRef string) -> StringRef {
+    char *copy = allocator.Allocate<char>(string.size());
+    std::copy(string.begin(), string.end(), copy);
+    return StringRef(copy, string.size());
+  };
+
+  for (StringRef path : paths) {
+    if (const File *file = lookupFile(path)) {
+      newFiles.push_back({ path, file });
+      continue;
+    }
+
+    // Stat before reading, so that a change made while reading shows up as a
+    // newer modification time next time.
+    llvm::sys::fs::file_status status;
+    if (llvm::sys::fs::status(path, status))
+      continue;
+    auto modTime = status.getLastModificationTime();
+    if (modTime.seconds() >= now.seconds())
+      continue;
+
+    auto buffer = llvm::MemoryBuffer::getFile(path);
+    if (!buffer || buffer.get()->getBufferSize() != status.getSize())
+      continue;
+
+    std::unique_ptr<File> file(new File());
+    file->ModTime = modTime;
+    file->Size = status.getSize();
+    bool wellFormed = DependencyGraphImpl::readDependencyFile(
+      *buffer.get(),
+      [&](StringRef hash) {
+        file->InterfaceHash = save(hash);
+      },
+      [&](const DependencyFileEntry &entry) {
+        file->Entries.push_back({ entry.Section, save(entry.Name),
+                                  entry.IsCascading });
+      });
+    if (!wellFormed)
+      continue;
+
+    newFiles.push_back({ path, file.get() });
+    readFiles.push_back(std::move(file));
+  }
+
+  endian::Writer<little> writer(out);
+  out.write(Magic, sizeof(Magic));
+  writer.write<uint32_t>(Version);
+  writer.write<uint32_t>(newFiles.size());
+
+  for (auto &newFile : newFiles) {
+    const File &file = *newFile.Recorded;
+    writer.write<uint64_t>(file.ModTime.seconds());
+    writer.write<uint32_t>(file.ModTime.nanoseconds());
+    writer.write<uint64_t>(file.Size);
+    writer.write<uint32_t>(newFile.Path.size());
+    writer.write<uint32_t>(file.InterfaceHash ? file.InterfaceHash->size()
+                                              : NoInterfaceHash);
+    writer.write<uint32_t>(file.Entries.size());
+    out << newFile.Path;
+    if (file.InterfaceHash)
+      out << *file.InterfaceHash;
+
+    for (auto &entry : file.Entries) {
+      writer.write<uint8_t>(uint8_t(entry.Section));
+      writer.write<uint8_t>(entry.IsCascading);
+      writer.write<uint32_t>(entry.Name.size());
+      out << entry.Name;
+    }
+  }
+}
@@ -360,6 +360,7 @@ std::unique_ptr<Compilation> Driver::buildCompilation(
     ArgList->hasArg(options::OPT_driver_skip_execution);
   bool ShowIncrementalBuildDecisions =
     ArgList->hasArg(options::OPT_driver_show_incremental);
+  bool BatchMode = ArgList->hasArg(options::OPT_enable_batch_mode);
 
   bool Incremental = ArgList->hasArg(options::OPT_incremental) &&
     !ArgList->hasArg(options::OPT_whole_module_optimization) &&
@@ -514,6 +515,9 @@ std::unique_ptr<Compilation> Driver::buildCompilation(
   if (ShowIncrementalBuildDecisions)
     C->setShowsIncrementalBuildDecisions();
 
+  if (BatchMode && OI.CompilerMode == OutputInfo::Mode::StandardCompile)
+    C->enableBatchMode();
+
   // This has to happen after building jobs, because otherwise we won't even
   // emit .swiftdeps files for the next build.
   if (rebuildEverything)
@@ -18,6 +18,7 @@
 #include "swift/Option/Options.h"
 #include "swift/Option/SanitizerOptions.h"
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/Triple.h"
 #include "llvm/Option/Arg.h"
 #include "llvm/Option/ArgList.h"
@@ -112,32 +113,112 @@ static void debugFailWithCrash() {
   LLVM_BUILTIN_TRAP;
 }
 
-static unsigned readFileList(std::vector<std::string> &inputFiles,
-                             const llvm::opt::Arg *filelistPath,
-                             const llvm::opt::Arg *primaryFileArg = nullptr) {
-  bool foundPrimaryFile = false;
-  unsigned primaryFileIndex = 0;
-  StringRef primaryFile;
-  if (primaryFileArg)
-    primaryFile = primaryFileArg->getValue();
-
+static void readFileList(std::vector<std::string> &inputFiles,
+                         const llvm::opt::Arg *filelistPath) {
   llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> buffer =
       llvm::MemoryBuffer::getFile(filelistPath->getValue());
   assert(buffer && "can't read filelist; unrecoverable");
 
-  for (StringRef line : make_range(llvm::line_iterator(*buffer.get()), {})) {
+  for (StringRef line : make_range(llvm::line_iterator(*buffer.get()), {}))
     inputFiles.push_back(line);
-    if (foundPrimaryFile)
-      continue;
-    if (line == primaryFile)
-      foundPrimaryFile = true;
-    else
-      ++primaryFileIndex;
+}
+
+/// Matches the outputs given for a batch of primary inputs to those inputs:
+/// the Nth -o, and the Nth of each option naming a per-file output, belongs
+/// to the Nth primary input.
+///
+/// \returns true on error
+static bool parseBatchOutputs(FrontendOptions &Opts, ArgList &Args,
+                              DiagnosticEngine &Diags) {
+  using namespace options;
+  unsigned numPrimaries = Opts.BatchPrimaryInputs.size();
+
+  switch (Opts.RequestedAction) {
+  case FrontendOptions::Parse:
+  case FrontendOptions::EmitModuleOnly:
+  case FrontendOptions::EmitSILGen:
+  case FrontendOptions::EmitSIL:
+  case FrontendOptions::EmitIR:
+  case FrontendOptions::EmitBC:
+  case FrontendOptions::EmitAssembly:
+  case FrontendOptions::EmitObject:
+    break;
+  case FrontendOptions::NoneAction:
+  case FrontendOptions::DumpParse:
+  case FrontendOptions::DumpInterfaceHash:
+  case FrontendOptions::DumpAST:
+  case FrontendOptions::PrintAST:
+  case FrontendOptions::DumpTypeRefinementContexts:
+  case FrontendOptions::EmitSIBGen:
+  case FrontendOptions::EmitSIB:
+  case FrontendOptions::Immediate:
+  case FrontendOptions::REPL:
+    Diags.diagnose(SourceLoc(), diag::error_batch_mode_unsupported,
+                   Args.getLastArg(OPT_modes_Group)->getSpelling());
+    return true;
+  }
+
+  // Outputs that only make sense for a whole compilation.
+  for (OptSpecifier opt : { OPT_serialize_diagnostics_path,
+                            OPT_emit_objc_header_path,
+                            OPT_emit_fixits_path, OPT_dump_api_path }) {
+    if (const Arg *A = Args.getLastArg(opt)) {
+      Diags.diagnose(SourceLoc(), diag::error_batch_mode_unsupported,
+                     A->getSpelling());
+      return true;
+    }
+  }
+
+  Opts.BatchOutputs.resize(numPrimaries);
+
+  if (Opts.actionHasOutput()) {
+    if (Opts.OutputFilenames.size() != numPrimaries) {
+      Diags.diagnose(SourceLoc(), diag::error_batch_mode_output_count, "-o",
+                     numPrimaries);
+      return true;
+    }
+    for (unsigned i = 0; i != numPrimaries; ++i)
+      Opts.BatchOutputs[i].OutputFilename = Opts.OutputFilenames[i];
+  }
+
+  auto parsePaths = [&](const std::string &requested, OptSpecifier opt,
+                        StringRef spelling,
+                        std::string FrontendOptions::BatchOutputPaths::*path)
+                       -> bool {
+    if (requested.empty())
+      return false;
+    std::vector<std::string> values = Args.getAllArgValues(opt);
+    if (values.size() != numPrimaries) {
+      Diags.diagnose(SourceLoc(), diag::error_batch_mode_output_count,
+                     spelling, numPrimaries);
+      return true;
+    }
+    for (unsigned i = 0; i != numPrimaries; ++i)
+      Opts.BatchOutputs[i].*path = values[i];
+    return false;
+  };
+
+  if (Opts.RequestedAction == FrontendOptions::EmitModuleOnly &&
+      !Args.hasArg(OPT_emit_module_path)) {
+    for (auto &outputs : Opts.BatchOutputs)
+      outputs.ModuleOutputPath = outputs.OutputFilename;
+  } else if (parsePaths(Opts.ModuleOutputPath, OPT_emit_module_path,
+                        "-emit-module-path",
+                        &FrontendOptions::BatchOutputPaths::ModuleOutputPath)) {
+    return true;
   }
 
-  if (primaryFileArg)
-    assert(foundPrimaryFile && "primary file not found in filelist");
-  return primaryFileIndex;
+  return parsePaths(Opts.ModuleDocOutputPath, OPT_emit_module_doc_path,
+                    "-emit-module-doc-path",
+                    &FrontendOptions::BatchOutputPaths::ModuleDocOutputPath) ||
+         parsePaths(Opts.DependenciesFilePath, OPT_emit_dependencies_path,
+                    "-emit-dependencies-path",
+                    &FrontendOptions::BatchOutputPaths::DependenciesFilePath) ||
+         parsePaths(Opts.ReferenceDependenciesFilePath,
+                    OPT_emit_reference_dependencies_path,
+                    "-emit-reference-dependencies-path",
+                    &FrontendOptions::BatchOutputPaths::
+                      ReferenceDependenciesFilePath);
 }
 
 static bool ParseFrontendArgs(FrontendOptions &Opts, ArgList &Args,
@@ -173,12 +254,24 @@ static bool ParseFrontendArgs(FrontendOptions &Opts, ArgList &Args,
   Opts.EmitSortedSIL |= Args.hasArg(OPT_emit_sorted_sil);
 
   Opts.DelayedFunctionBodyParsing |= Args.hasArg(OPT_delayed_function_body_parsing);
+  Opts.SkipNonPrimaryFunctionBodies |=
+    Args.hasArg(OPT_skip_non_primary_function_bodies);
   Opts.EnableTesting |= Args.hasArg(OPT_enable_testing);
   Opts.EnableResilience |= Args.hasArg(OPT_enable_resilience);
 
   Opts.PrintStats |= Args.hasArg(OPT_print_stats);
   Opts.PrintClangStats |= Args.hasArg(OPT_print_clang_stats);
   Opts.DebugTimeFunctionBodies |= Args.hasArg(OPT_debug_time_function_bodies);
+
+  if (const Arg *A = Args.getLastArg(OPT_debug_expression_stats_path))
+    Opts.ExpressionStatsPath = A->getValue();
+  if (const Arg *A = Args.getLastArg(OPT_debug_expression_stats_count)) {
+    if (StringRef(A->getValue()).getAsInteger(10, Opts.NumExpressionStats)) {
+      Diags.diagnose(SourceLoc(), diag::error_invalid_arg_value,
+                     A->getAsString(Args), A->getValue());
+      return true;
+    }
+  }
   Opts.DebugTimeCompilation |= Args.hasArg(OPT_debug_time_compilation);
 
   Opts.PlaygroundTransform |= Args.hasArg(OPT_playground);
@@ -197,13 +290,21 @@ static bool ParseFrontendArgs(FrontendOptions &Opts, ArgList &Args,
     }
   }
 
+  std::vector<SelectedInput> PrimaryInputs;
   if (const Arg *A = Args.getLastArg(OPT_filelist)) {
-    const Arg *primaryFileArg = Args.getLastArg(OPT_primary_file);
-    auto primaryFileIndex = readFileList(Opts.InputFilenames, A,
-                                         primaryFileArg);
-    if (primaryFileArg)
-      Opts.PrimaryInput = SelectedInput(primaryFileIndex);
+    readFileList(Opts.InputFilenames, A);
     assert(!Args.hasArg(OPT_INPUT) && "mixing -filelist with inputs");
+
+    llvm::StringMap<unsigned> InputIndices;
+    for (unsigned i = 0, e = Opts.InputFilenames.size(); i != e; ++i)
+      InputIndices.insert({Opts.InputFilenames[i], i});
+    for (const Arg *primaryFileArg : make_range(
+           Args.filtered_begin(OPT_primary_file), Args.filtered_end())) {
+      auto found = InputIndices.find(primaryFileArg->getValue());
+      assert(found != InputIndices.end() &&
+             "primary file not found in filelist");
+      PrimaryInputs.push_back(SelectedInput(found->getValue()));
+    }
   } else {
     for (const Arg *A : make_range(Args.filtered_begin(OPT_INPUT,
                                                        OPT_primary_file),
@@ -211,7 +312,7 @@ static bool ParseFrontendArgs(FrontendOptions &Opts, ArgList &Args,
       if (A->getOption().matches(OPT_INPUT)) {
         Opts.InputFilenames.push_back(A->getValue());
       } else if (A->getOption().matches(OPT_primary_file)) {
-        Opts.PrimaryInput = SelectedInput(Opts.InputFilenames.size());
+        PrimaryInputs.push_back(SelectedInput(Opts.InputFilenames.size()));
         Opts.InputFilenames.push_back(A->getValue());
       } else {
         llvm_unreachable("Unknown input-related argument!");
@@ -219,6 +320,13 @@ static bool ParseFrontendArgs(FrontendOptions &Opts, ArgList &Args,
     }
   }
 
+  // More than one primary input makes a batch: they share one ASTContext, and
+  // each gets its own outputs.
+  if (!PrimaryInputs.empty())
+    Opts.PrimaryInput = PrimaryInputs.front();
+  if (PrimaryInputs.size() > 1)
+    Opts.BatchPrimaryInputs = std::move(PrimaryInputs);
+
   Opts.ParseStdlib |= Args.hasArg(OPT_parse_stdlib);
 
   // Determine what the user has asked the frontend to do.
@@ -576,6 +684,8 @@ static bool ParseFrontendArgs(FrontendOptions &Opts, ArgList &Args,
                           OPT_emit_reference_dependencies,
                           OPT_emit_reference_dependencies_path,
                           "swiftdeps", false);
+  Opts.EmitBinaryReferenceDependencies |=
+    Args.hasArg(OPT_emit_binary_reference_dependencies);
   determineOutputFilename(Opts.SerializedDiagnosticsPath,
                           OPT_serialize_diagnostics,
                           OPT_serialize_diagnostics_path,
@@ -609,6 +719,9 @@ static bool ParseFrontendArgs(FrontendOptions &Opts, ArgList &Args,
                           SERIALIZED_MODULE_DOC_EXTENSION,
                           false);
 
+  if (Opts.isInBatchMode() && parseBatchOutputs(Opts, Args, Diags))
+    return true;
+
   if (!Opts.DependenciesFilePath.empty()) {
     switch (Opts.RequestedAction) {
     case FrontendOptions::NoneAction:
@@ -754,6 +867,8 @@ static bool ParseLangArgs(LangOptions &Opts, ArgList &Args,
   
   Opts.DebugConstraintSolver |= Args.hasArg(OPT_debug_constraints);
   Opts.IterativeTypeChecker |= Args.hasArg(OPT_iterative_type_checker);
+  Opts.NamedLazyMemberLoading |=
+    Args.hasArg(OPT_enable_named_lazy_member_loading);
   Opts.DebugGenericSignatures |= Args.hasArg(OPT_debug_generic_signatures);
 
   Opts.DebuggerSupport |= Args.hasArg(OPT_debugger_support);
@@ -806,6 +921,17 @@ static bool ParseLangArgs(LangOptions &Opts, ArgList &Args,
     
     Opts.SolverMemoryThreshold = threshold;
   }
+
+  if (const Arg *A = Args.getLastArg(OPT_warn_long_expression_type_checking)) {
+    unsigned limit;
+    if (StringRef(A->getValue()).getAsInteger(10, limit)) {
+      Diags.diagnose(SourceLoc(), diag::error_invalid_arg_value,
+                     A->getAsString(Args), A->getValue());
+      return true;
+    }
+
+    Opts.WarnLongExpressionTypeChecking = limit;
+  }
   
   for (const Arg *A : make_range(Args.filtered_begin(OPT_D),
                                  Args.filtered_end())) {
@@ -1175,6 +1301,7 @@ static bool ParseIRGenArgs(IRGenOptions &Opts, ArgList &Args,
     Opts.Verify = false;
 
   Opts.EmitStackPromotionChecks |= Args.hasArg(OPT_stack_promotion_checks);
+  Opts.AssumeSingleThreaded |= Args.hasArg(OPT_assume_single_threaded);
   if (const Arg *A = Args.getLastArg(OPT_stack_promotion_limit)) {
     unsigned limit;
     if (StringRef(A->getValue()).getAsInteger(10, limit)) {
@@ -52,6 +52,34 @@ void CompilerInstance::setPrimarySourceFile(SourceFile *SF) {
   PrimarySourceFile->setReferencedNameTracker(NameTracker);
 }
 
+void CompilerInstance::recordSourceFile(SourceFile *SF, unsigned BufferID) {
+  if (BufferID == PrimaryBufferID)
+    setPrimarySourceFile(SF);
+
+  auto Found = BatchPrimaryBufferIDs.find(BufferID);
+  if (Found == BatchPrimaryBufferIDs.end())
+    return;
+
+  if (BatchPrimarySourceFiles.empty()) {
+    BatchPrimarySourceFiles.resize(
+      Invocation.getFrontendOptions().BatchPrimaryInputs.size());
+  }
+  BatchPrimarySourceFiles[Found->second] = SF;
+
+  // Each primary input of a batch tracks the names it references separately.
+  if (SF != PrimarySourceFile && NameTracker) {
+    BatchNameTrackers.emplace_back(new ReferencedNameTracker());
+    SF->setReferencedNameTracker(BatchNameTrackers.back().get());
+  }
+}
+
+bool CompilerInstance::isPrimarySourceFile(const SourceFile *SF) const {
+  if (SF == PrimarySourceFile)
+    return true;
+  auto BufferID = SF->getBufferID();
+  return BufferID && BatchPrimaryBufferIDs.count(*BufferID);
+}
+
 bool CompilerInstance::setup(const CompilerInvocation &Invok) {
   Invocation = Invok;
 
@@ -133,6 +161,25 @@ bool CompilerInstance::setup(const CompilerInvocation &Invok) {
   const Optional<SelectedInput> &PrimaryInput =
     Invocation.getFrontendOptions().PrimaryInput;
 
+  // In batch mode, find out which of the buffers below are primary inputs.
+  llvm::SmallDenseMap<unsigned, unsigned, 4> BatchPrimaryBufferInputs;
+  llvm::SmallDenseMap<unsigned, unsigned, 4> BatchPrimaryFileInputs;
+  const std::vector<SelectedInput> &BatchPrimaryInputs =
+    Invocation.getFrontendOptions().BatchPrimaryInputs;
+  for (unsigned i = 0, e = BatchPrimaryInputs.size(); i != e; ++i) {
+    if (BatchPrimaryInputs[i].isBuffer())
+      BatchPrimaryBufferInputs[BatchPrimaryInputs[i].Index] = i;
+    else
+      BatchPrimaryFileInputs[BatchPrimaryInputs[i].Index] = i;
+  }
+  auto noteBatchPrimary =
+      [this](const llvm::SmallDenseMap<unsigned, unsigned, 4> &Inputs,
+             unsigned Index, unsigned BufferID) {
+    auto Found = Inputs.find(Index);
+    if (Found != Inputs.end())
+      BatchPrimaryBufferIDs[BufferID] = Found->second;
+  };
+
   // Add the memory buffers first, these will be associated with a filename
   // and they can replace the contents of an input filename.
   for (unsigned i = 0, e = Invocation.getInputBuffers().size(); i != e; ++i) {
@@ -152,6 +199,7 @@ bool CompilerInstance::setup(const CompilerInvocation &Invok) {
 
       if (PrimaryInput && PrimaryInput->isBuffer() && PrimaryInput->Index == i)
         PrimaryBufferID = BufferID;
+      noteBatchPrimary(BatchPrimaryBufferInputs, i, BufferID);
     }
   }
 
@@ -169,6 +217,7 @@ bool CompilerInstance::setup(const CompilerInvocation &Invok) {
       if (PrimaryInput && PrimaryInput->isFilename() &&
           PrimaryInput->Index == i)
         PrimaryBufferID = ExistingBufferID.getValue();
+      noteBatchPrimary(BatchPrimaryFileInputs, i, ExistingBufferID.getValue());
 
       continue; // replaced by a memory buffer.
     }
@@ -211,6 +260,7 @@ bool CompilerInstance::setup(const CompilerInvocation &Invok) {
 
     if (PrimaryInput && PrimaryInput->isFilename() && PrimaryInput->Index == i)
       PrimaryBufferID = BufferID;
+    noteBatchPrimary(BatchPrimaryFileInputs, i, BufferID);
   }
 
   // Set the primary file to the code-completion point if one exists.
@@ -380,6 +430,21 @@ void CompilerInstance::performSema() {
     DelayedCB.reset(new AlwaysDelayedCallbacks);
   }
 
+  // Files other than the primary files are only type-checked as far as the
+  // primary files need their declarations, so their function bodies can be
+  // skipped altogether.
+  std::unique_ptr<DelayedParsingCallbacks> NonPrimaryDelayedCB;
+  if (PrimaryBufferID != NO_SUCH_BUFFER && !Invocation.isCodeCompletion() &&
+      options.SkipNonPrimaryFunctionBodies) {
+    NonPrimaryDelayedCB.reset(new AlwaysSkippedCallbacks);
+  }
+  auto getDelayedCallbacks = [&](SourceFile *SF) -> DelayedParsingCallbacks * {
+    if (NonPrimaryDelayedCB && SF->Kind != SourceFileKind::SIL &&
+        !isPrimarySourceFile(SF))
+      return NonPrimaryDelayedCB.get();
+    return DelayedCB.get();
+  };
+
   PersistentParserState PersistentState;
 
   // Make sure the main file is the first file in the module. This may only be
@@ -398,8 +463,7 @@ void CompilerInstance::performSema() {
     MainModule->addFile(*MainFile);
     addAdditionalInitialImports(MainFile);
 
-    if (MainBufferID == PrimaryBufferID)
-      setPrimarySourceFile(MainFile);
+    recordSourceFile(MainFile, MainBufferID);
   }
 
   bool hadLoadError = false;
@@ -424,15 +488,14 @@ void CompilerInstance::performSema() {
     MainModule->addFile(*NextInput);
     addAdditionalInitialImports(NextInput);
 
-    if (BufferID == PrimaryBufferID)
-      setPrimarySourceFile(NextInput);
+    recordSourceFile(NextInput, BufferID);
 
     bool Done;
     do {
       // Parser may stop at some erroneous constructions like #else, #endif
       // or '}' in some cases, continue parsing until we are done
       parseIntoSourceFile(*NextInput, BufferID, &Done, nullptr,
-                          &PersistentState, DelayedCB.get());
+                          &PersistentState, getDelayedCallbacks(NextInput));
     } while (!Done);
 
     performNameBinding(*NextInput);
@@ -463,11 +526,10 @@ void CompilerInstance::performSema() {
 
   // Parse the main file last.
   if (MainBufferID != NO_SUCH_BUFFER) {
-    bool mainIsPrimary =
-      (PrimaryBufferID == NO_SUCH_BUFFER || MainBufferID == PrimaryBufferID);
-
     SourceFile &MainFile =
       MainModule->getMainSourceFile(Invocation.getSourceFileKind());
+    bool mainIsPrimary =
+      (PrimaryBufferID == NO_SUCH_BUFFER || isPrimarySourceFile(&MainFile));
     SILParserState SILContext(TheSILModule.get());
     unsigned CurTUElem = 0;
     bool Done;
@@ -478,7 +540,7 @@ void CompilerInstance::performSema() {
       // with 'sil' definitions.
       parseIntoSourceFile(MainFile, MainFile.getBufferID().getValue(), &Done,
                           TheSILModule ? &SILContext : nullptr,
-                          &PersistentState, DelayedCB.get());
+                          &PersistentState, getDelayedCallbacks(&MainFile));
       if (mainIsPrimary) {
         performTypeChecking(MainFile, PersistentState.getTopLevelContext(),
                             TypeCheckOptions, CurTUElem);
@@ -496,7 +558,7 @@ void CompilerInstance::performSema() {
   // Type-check each top-level input besides the main source file.
   for (auto File : MainModule->getFiles())
     if (auto SF = dyn_cast<SourceFile>(File))
-      if (PrimaryBufferID == NO_SUCH_BUFFER || SF == PrimarySourceFile)
+      if (PrimaryBufferID == NO_SUCH_BUFFER || isPrimarySourceFile(SF))
         performTypeChecking(*SF, PersistentState.getTopLevelContext(),
                             TypeCheckOptions);
 
@@ -519,7 +581,7 @@ void CompilerInstance::performSema() {
 
   for (auto File : MainModule->getFiles())
     if (auto SF = dyn_cast<SourceFile>(File))
-      if (PrimaryBufferID == NO_SUCH_BUFFER || SF == PrimarySourceFile)
+      if (PrimaryBufferID == NO_SUCH_BUFFER || isPrimarySourceFile(SF))
         finishTypeChecking(*SF);
 }
 
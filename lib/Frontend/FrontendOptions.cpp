@@ -71,6 +71,24 @@ bool FrontendOptions::actionIsImmediate() const {
   llvm_unreachable("Unknown ActionType");
 }
 
+FrontendOptions
+FrontendOptions::getOptionsForBatchPrimaryInput(unsigned index) const {
+  assert(index < BatchPrimaryInputs.size() && "not a primary input of a batch");
+  const BatchOutputPaths &outputs = BatchOutputs[index];
+
+  FrontendOptions result = *this;
+  result.PrimaryInput = BatchPrimaryInputs[index];
+  result.BatchPrimaryInputs.clear();
+  result.BatchOutputs.clear();
+  if (!outputs.OutputFilename.empty())
+    result.setSingleOutputFilename(outputs.OutputFilename);
+  result.ModuleOutputPath = outputs.ModuleOutputPath;
+  result.ModuleDocOutputPath = outputs.ModuleDocOutputPath;
+  result.DependenciesFilePath = outputs.DependenciesFilePath;
+  result.ReferenceDependenciesFilePath = outputs.ReferenceDependenciesFilePath;
+  return result;
+}
+
 void FrontendOptions::forAllOutputPaths(
     std::function<void(const std::string &)> fn) const {
   if (RequestedAction != FrontendOptions::EmitModuleOnly) {
@@ -938,7 +938,10 @@ void IRGenFunction::emitNativeStrongRetain(llvm::Value *value) {
   
   // Emit the call.
   llvm::CallInst *call =
-    Builder.CreateCall(IGM.getNativeStrongRetainFn(), value);
+    Builder.CreateCall(IGM.Opts.AssumeSingleThreaded
+                         ? IGM.getNativeNonAtomicStrongRetainFn()
+                         : IGM.getNativeStrongRetainFn(),
+                       value);
   call->setDoesNotThrow();
 }
 
@@ -1109,7 +1112,10 @@ void IRGenFunction::emitStrongRetainAndUnownedRelease(llvm::Value *value,
 /// Emit a release of a live value.
 void IRGenFunction::emitNativeStrongRelease(llvm::Value *value) {
   if (doesNotRequireRefCounting(value)) return;
-  emitUnaryRefCountCall(*this, IGM.getNativeStrongReleaseFn(), value);
+  emitUnaryRefCountCall(*this, IGM.Opts.AssumeSingleThreaded
+                                 ? IGM.getNativeNonAtomicStrongReleaseFn()
+                                 : IGM.getNativeStrongReleaseFn(),
+                        value);
 }
 
 void IRGenFunction::emitNativeSetDeallocating(llvm::Value *value) {
@@ -262,6 +262,29 @@ static void getHashOfModule(MD5::MD5Result &Result, IRGenOptions &Opts,
   HashStream.final(Result);
 }
 
+/// Returns the contents of the section \p HashSectionName of \p ObjectFile,
+/// or None if there is no such section.
+static Optional<StringRef> getHashSection(const object::ObjectFile *ObjectFile,
+                                          StringRef HashSectionName) {
+  // Strip the segment name. For mach-o the GlobalVariable's section name format
+  // is <segment>,<section>.
+  size_t Comma = HashSectionName.find(',');
+  if (Comma != StringRef::npos)
+    HashSectionName = HashSectionName.substr(Comma + 1);
+
+  // Search for the section which holds the hash.
+  for (auto &Section : ObjectFile->sections()) {
+    StringRef SectionName;
+    Section.getName(SectionName);
+    if (SectionName == HashSectionName) {
+      StringRef SectionData;
+      Section.getContents(SectionData);
+      return SectionData;
+    }
+  }
+  return None;
+}
+
 /// Returns false if the hash of the current module \p HashData matches the
 /// hash which is stored in an existing output object file.
 static bool needsRecompile(StringRef OutputFilename, ArrayRef<uint8_t> HashData,
@@ -277,36 +300,111 @@ static bool needsRecompile(StringRef OutputFilename, ArrayRef<uint8_t> HashData,
   if (!ObjectFile)
     return true;
 
-  const char *HashSectionName = HashGlobal->getSection();
-  // Strip the segment name. For mach-o the GlobalVariable's section name format
-  // is <segment>,<section>.
-  if (const char *Comma = ::strchr(HashSectionName, ','))
-    HashSectionName = Comma + 1;
+  auto SectionData = getHashSection(ObjectFile, HashGlobal->getSection());
+  if (!SectionData)
+    return true;
 
-  // Search for the section which holds the hash.
-  for (auto &Section : ObjectFile->sections()) {
-    StringRef SectionName;
-    Section.getName(SectionName);
-    if (SectionName == HashSectionName) {
-      StringRef SectionData;
-      Section.getContents(SectionData);
-      ArrayRef<uint8_t> PrevHashData((uint8_t *)SectionData.data(),
-                                     SectionData.size());
-      DEBUG(if (PrevHashData.size() == sizeof(MD5::MD5Result)) {
-        if (DiagMutex) DiagMutex->lock();
-        SmallString<32> HashStr;
-        MD5::stringifyResult(*(MD5::MD5Result *)PrevHashData.data(), HashStr);
-        llvm::dbgs() << OutputFilename << ": prev MD5=" << HashStr <<
-          (HashData == PrevHashData ? " skipping\n" : " recompiling\n");
-        if (DiagMutex) DiagMutex->unlock();
-      });
-      if (HashData == PrevHashData)
-        return false;
+  ArrayRef<uint8_t> PrevHashData((uint8_t *)SectionData->data(),
+                                 SectionData->size());
+  DEBUG(if (PrevHashData.size() == sizeof(MD5::MD5Result)) {
+    if (DiagMutex) DiagMutex->lock();
+    SmallString<32> HashStr;
+    MD5::stringifyResult(*(MD5::MD5Result *)PrevHashData.data(), HashStr);
+    llvm::dbgs() << OutputFilename << ": prev MD5=" << HashStr <<
+      (HashData == PrevHashData ? " skipping\n" : " recompiling\n");
+    if (DiagMutex) DiagMutex->unlock();
+  });
+  return HashData != PrevHashData;
+}
+
+/// Stores \p InputsHash in the existing output object file, which is reused
+/// for a compilation of different inputs. Returns true if that failed.
+static bool updateInputsHash(StringRef OutputFilename,
+                             ArrayRef<uint8_t> InputsHash,
+                             llvm::GlobalVariable *InputsHashGlobal) {
+  std::string Contents;
+  {
+    auto BinaryOwner = object::createBinary(OutputFilename);
+    if (!BinaryOwner)
+      return true;
+    auto *ObjectFile = dyn_cast<object::ObjectFile>(BinaryOwner->getBinary());
+    if (!ObjectFile)
+      return true;
 
+    auto SectionData = getHashSection(ObjectFile,
+                                      InputsHashGlobal->getSection());
+    if (!SectionData || SectionData->size() != InputsHash.size())
+      return true;
+    if (SectionData->equals(StringRef((const char *)InputsHash.data(),
+                                      InputsHash.size())))
+      return false;
+
+    StringRef Data = ObjectFile->getData();
+    Contents = Data;
+    std::copy(InputsHash.begin(), InputsHash.end(),
+              Contents.begin() + (SectionData->data() - Data.data()));
+  }
+
+  // Write the updated object file next to the old one and rename it into
+  // place, so that a failure never leaves a truncated object file behind.
+  SmallString<128> TmpName(OutputFilename);
+  TmpName += "-%%%%%%%%.tmp";
+  int TmpFD;
+  if (llvm::sys::fs::createUniqueFile(TmpName.str(), TmpFD, TmpName))
+    return true;
+  {
+    llvm::raw_fd_ostream OS(TmpFD, /*shouldClose=*/true);
+    OS << Contents;
+    OS.close();
+    if (OS.has_error()) {
+      OS.clear_error();
+      llvm::sys::fs::remove(TmpName.str());
       return true;
     }
   }
-  return true;
+  if (llvm::sys::fs::rename(TmpName.str(), OutputFilename)) {
+    llvm::sys::fs::remove(TmpName.str());
+    return true;
+  }
+  return false;
+}
+
+/// Returns true if every output object file of the multi-threaded compilation
+/// of \p M exists and was compiled from the inputs of this compilation,
+/// according to the hash of the inputs recorded in it.
+///
+/// The inputs hash is shared by all object files, so this is all or nothing:
+/// if any input changed, none of the object files are up to date.
+static bool haveUpToDateObjectFiles(IRGenOptions &Opts, swift::Module *M) {
+  if (!Opts.UseIncrementalLLVMCodeGen || Opts.InputsHash.empty() ||
+      Opts.OutputKind != IRGenOutputKind::ObjectFile || Opts.PrintInlineTree)
+    return false;
+
+  const llvm::Triple &Triple = M->getASTContext().LangOpts.Target;
+  std::string InputsHashSectionName =
+    IRGenModule::getHashSectionName(Triple.getObjectFormat(), "swift_inhash");
+  StringRef InputsHash((const char *)Opts.InputsHash.data(),
+                       Opts.InputsHash.size());
+
+  auto OutputIter = Opts.OutputFilenames.begin();
+  for (auto *File : M->getFiles()) {
+    auto nextSF = dyn_cast<SourceFile>(File);
+    if (!nextSF || nextSF->ASTStage < SourceFile::TypeChecked)
+      continue;
+    if (OutputIter == Opts.OutputFilenames.end())
+      return false;
+
+    auto BinaryOwner = object::createBinary(*OutputIter++);
+    if (!BinaryOwner)
+      return false;
+    auto *ObjectFile = dyn_cast<object::ObjectFile>(BinaryOwner->getBinary());
+    if (!ObjectFile)
+      return false;
+    auto SectionData = getHashSection(ObjectFile, InputsHashSectionName);
+    if (!SectionData || *SectionData != InputsHash)
+      return false;
+  }
+  return OutputIter != Opts.OutputFilenames.begin();
 }
 
 /// Run the LLVM passes. In multi-threaded compilation this will be done for
@@ -314,6 +412,7 @@ static bool needsRecompile(StringRef OutputFilename, ArrayRef<uint8_t> HashData,
 static bool performLLVM(IRGenOptions &Opts, DiagnosticEngine &Diags,
                         llvm::sys::Mutex *DiagMutex,
                         llvm::GlobalVariable *HashGlobal,
+                        llvm::GlobalVariable *InputsHashGlobal,
                         llvm::Module *Module,
                         llvm::TargetMachine *TargetMachine,
                         StringRef OutputFilename) {
@@ -335,14 +434,21 @@ static bool performLLVM(IRGenOptions &Opts, DiagnosticEngine &Diags,
     if (Opts.OutputKind == IRGenOutputKind::ObjectFile &&
         !Opts.PrintInlineTree &&
         !needsRecompile(OutputFilename, HashData, HashGlobal, DiagMutex)) {
-      // The llvm IR did not change. We don't need to re-create the object file.
-      return false;
+      // The llvm IR did not change. We don't need to re-create the object file,
+      // only to record that it is up to date with the current inputs.
+      if (!InputsHashGlobal ||
+          !updateInputsHash(OutputFilename, Opts.InputsHash, InputsHashGlobal))
+        return false;
     }
 
     // Store the hash in the global variable so that it is written into the
     // object file.
     auto *HashConstant = ConstantDataArray::get(Module->getContext(), HashData);
     HashGlobal->setInitializer(HashConstant);
+    if (InputsHashGlobal) {
+      InputsHashGlobal->setInitializer(
+        ConstantDataArray::get(Module->getContext(), Opts.InputsHash));
+    }
   }
 
   llvm::SmallString<0> Buffer;
@@ -627,13 +733,19 @@ static std::unique_ptr<llvm::Module> performIRGeneration(IRGenOptions &Opts,
   embedBitcode(IGM.getModule(), Opts);
 
   if (performLLVM(IGM.Opts, IGM.Context.Diags, nullptr, IGM.ModuleHash,
-                  IGM.getModule(), IGM.TargetMachine, IGM.OutputFilename))
+                  IGM.ModuleInputsHash, IGM.getModule(), IGM.TargetMachine,
+                  IGM.OutputFilename))
     return nullptr;
   return std::unique_ptr<llvm::Module>(IGM.releaseModule());
 }
 
 static void ThreadEntryPoint(IRGenModuleDispatcher *dispatcher,
                              llvm::sys::Mutex *DiagMutex, int ThreadIdx) {
+  // A thread only stops once the queue is empty, so this is its busy time.
+  // The wall time is the one to look at; user and system time are those of
+  // the whole process.
+  SharedTimer timer("LLVM codegen thread " + std::to_string(ThreadIdx));
+
   while (IRGenModule *IGM = dispatcher->fetchFromQueue()) {
     DEBUG(
       DiagMutex->lock();
@@ -643,7 +755,8 @@ static void ThreadEntryPoint(IRGenModuleDispatcher *dispatcher,
     );
     embedBitcode(IGM->getModule(), IGM->Opts);
     performLLVM(IGM->Opts, IGM->Context.Diags, DiagMutex, IGM->ModuleHash,
-                IGM->getModule(), IGM->TargetMachine, IGM->OutputFilename);
+                IGM->ModuleInputsHash, IGM->getModule(), IGM->TargetMachine,
+                IGM->OutputFilename);
     if (IGM->Context.Diags.hadAnyError())
       return;
   }
@@ -661,6 +774,14 @@ static void performParallelIRGeneration(IRGenOptions &Opts,
                                         SILModule *SILMod,
                                         StringRef ModuleName, int numThreads) {
 
+  // If none of the inputs changed since the existing object files were
+  // compiled, there is nothing to do. Otherwise the IR of every file is
+  // generated, and only LLVM is skipped for objects whose IR is unchanged.
+  if (haveUpToDateObjectFiles(Opts, M)) {
+    DEBUG(dbgs() << "all object files are up to date\n");
+    return;
+  }
+
   IRGenModuleDispatcher dispatcher;
   
   auto OutputIter = Opts.OutputFilenames.begin();
@@ -807,6 +928,11 @@ static void performParallelIRGeneration(IRGenOptions &Opts,
   // Bail out if there are any errors.
   if (Ctx.hadError()) return;
 
+  // The modules cannot be split, because each one becomes an output file.
+  // So hand out the most expensive ones first, which keeps a big source file
+  // from being picked up last and holding up the whole compilation.
+  dispatcher.sortQueueByCost();
+
   std::vector<std::thread> Threads;
   llvm::sys::Mutex DiagMutex;
 
@@ -893,7 +1019,7 @@ swift::createSwiftModuleObjectFile(SILModule &SILMod, StringRef Buffer,
 
   ASTSym->setSection(Section);
   ASTSym->setAlignment(8);
-  ::performLLVM(Opts, Ctx.Diags, nullptr, nullptr, IGM.getModule(),
+  ::performLLVM(Opts, Ctx.Diags, nullptr, nullptr, nullptr, IGM.getModule(),
                 TargetMachine, OutputPath);
 }
 
@@ -905,8 +1031,8 @@ bool swift::performLLVM(IRGenOptions &Opts, ASTContext &Ctx,
     return true;
 
   embedBitcode(Module, Opts);
-  if (::performLLVM(Opts, Ctx.Diags, nullptr, nullptr, Module, TargetMachine,
-                    Opts.getSingleOutputFilename()))
+  if (::performLLVM(Opts, Ctx.Diags, nullptr, nullptr, nullptr, Module,
+                    TargetMachine, Opts.getSingleOutputFilename()))
     return true;
   return false;
 }
@@ -130,7 +130,7 @@ IRGenModule::IRGenModule(IRGenModuleDispatcher &dispatcher, SourceFile *SF,
     Triple(Triple), TargetMachine(TargetMachine),
     SILMod(SILMod), OutputFilename(OutputFilename), dispatcher(dispatcher),
     TargetInfo(SwiftTargetInfo::get(*this)),
-    DebugInfo(0), ModuleHash(nullptr),
+    DebugInfo(0), ModuleHash(nullptr), ModuleInputsHash(nullptr),
     ObjCInterop(Context.LangOpts.EnableObjCInterop),
     Types(*new TypeConverter(*this))
 {
@@ -954,6 +954,22 @@ void IRGenModule::cleanupClangCodeGenMetadata() {
                          (uint32_t)(swiftVersion << 8));
 }
 
+std::string
+IRGenModule::getHashSectionName(llvm::Triple::ObjectFormatType Format,
+                                StringRef Name) {
+  switch (Format) {
+  case llvm::Triple::MachO:
+    // On Darwin the linker ignores the __LLVM segment.
+    return ("__LLVM,__" + Name).str();
+  case llvm::Triple::ELF:
+  case llvm::Triple::COFF:
+    return ("." + Name).str();
+  default:
+    llvm_unreachable("Don't know how to emit the module hash for the selected"
+                     "object format.");
+  }
+}
+
 void IRGenModule::finalize() {
   const char *ModuleHashVarName = "llvm.swift_module_hash";
   if (Opts.OutputKind == IRGenOutputKind::ObjectFile &&
@@ -969,20 +985,23 @@ void IRGenModule::finalize() {
     ModuleHash = new llvm::GlobalVariable(Module, ZeroConst->getType(), true,
                                           llvm::GlobalValue::PrivateLinkage,
                                           ZeroConst, ModuleHashVarName);
-    switch (TargetInfo.OutputObjectFormat) {
-    case llvm::Triple::MachO:
-      // On Darwin the linker ignores the __LLVM segment.
-      ModuleHash->setSection("__LLVM,__swift_modhash");
-      break;
-    case llvm::Triple::ELF:
-    case llvm::Triple::COFF:
-      ModuleHash->setSection(".swift_modhash");
-      break;
-    default:
-      llvm_unreachable("Don't know how to emit the module hash for the selected"
-                       "object format.");
-    }
+    ModuleHash->setSection(getHashSectionName(TargetInfo.OutputObjectFormat,
+                                              "swift_modhash"));
     addUsedGlobal(ModuleHash);
+
+    // Likewise for the hash of the inputs. It must not be part of the hash of
+    // the module, so that objects whose IR did not change can be reused after
+    // any change to the inputs.
+    if (!Opts.InputsHash.empty()) {
+      assert(Opts.InputsHash.size() == sizeof(llvm::MD5::MD5Result));
+      ModuleInputsHash =
+        new llvm::GlobalVariable(Module, ZeroConst->getType(), true,
+                                 llvm::GlobalValue::PrivateLinkage,
+                                 ZeroConst, "llvm.swift_module_inputs_hash");
+      ModuleInputsHash->setSection(
+        getHashSectionName(TargetInfo.OutputObjectFormat, "swift_inhash"));
+      addUsedGlobal(ModuleInputsHash);
+    }
   }
   emitLazyPrivateDefinitions();
   emitAutolinkInfo();
@@ -1023,6 +1042,24 @@ void IRGenModuleDispatcher::addGenModule(SourceFile *SF, IRGenModule *IGM) {
   Queue.push_back(IGM);
 }
 
+void IRGenModuleDispatcher::sortQueueByCost() {
+  assert(QueueIndex == 0 && "modules have already been fetched");
+
+  llvm::DenseMap<IRGenModule *, size_t> Costs;
+  for (IRGenModule *IGM : Queue) {
+    size_t Cost = 0;
+    for (const llvm::Function &F : *IGM->getModule())
+      for (const llvm::BasicBlock &BB : F)
+        Cost += BB.size();
+    Costs[IGM] = Cost;
+  }
+
+  std::stable_sort(Queue.begin(), Queue.end(),
+                   [&](IRGenModule *LHS, IRGenModule *RHS) {
+                     return Costs[LHS] > Costs[RHS];
+                   });
+}
+
 IRGenModule *IRGenModuleDispatcher::getGenModule(DeclContext *ctxt) {
   if (GenModules.size() == 1 || !ctxt) {
     return getPrimaryIGM();
@@ -250,6 +250,12 @@ public:
     return it->second;
   }
   
+  /// Orders the queue of IRGenModules by decreasing cost of LLVM compilation,
+  /// as estimated by the number of LLVM instructions in each module.
+  ///
+  /// Must be called before the first call to fetchFromQueue().
+  void sortQueueByCost();
+
   /// In multi-threaded compilation fetch the next IRGenModule from the queue.
   IRGenModule *fetchFromQueue() {
     int idx = QueueIndex++;
@@ -337,6 +343,15 @@ public:
   /// incremental compilation.
   llvm::GlobalVariable *ModuleHash;
 
+  /// A global variable which stores the hash of the inputs the module was
+  /// compiled from, if it is known. Used for incremental compilation.
+  llvm::GlobalVariable *ModuleInputsHash;
+
+  /// Returns the object file section which holds the hash \p Name, e.g.
+  /// "swift_modhash", for the object file format \p Format.
+  static std::string getHashSectionName(llvm::Triple::ObjectFormatType Format,
+                                        StringRef Name);
+
   /// Does the current target require Objective-C interoperation?
   bool ObjCInterop = true;
 
@@ -61,6 +61,14 @@ class ARCEntryPointBuilder {
   NullablePtr<Constant> UnknownReleaseN;
   NullablePtr<Constant> BridgeRetainN;
   NullablePtr<Constant> BridgeReleaseN;
+  NullablePtr<Constant> NonAtomicRetain;
+  NullablePtr<Constant> NonAtomicRelease;
+  NullablePtr<Constant> NonAtomicRetainN;
+  NullablePtr<Constant> NonAtomicReleaseN;
+
+  // Whether native retains and releases are created with the non-atomic
+  // entry points.
+  bool NonAtomic;
 
   // The type cache.
   NullablePtr<Type> ObjectPtrTy;
@@ -85,7 +93,7 @@ class ARCEntryPointBuilder {
 
 public:
   ARCEntryPointBuilder(Function &F)
-      : B(&*F.begin()), Retain(), ObjectPtrTy(),
+      : B(&*F.begin()), Retain(), NonAtomic(false), ObjectPtrTy(),
         DefaultCC(SWIFT_LLVM_CC(DefaultCC)),
         RegisterPreservingCC(SWIFT_LLVM_CC(RegisterPreservingCC)) {
     //TODO: If the target does not support the new calling convention,
@@ -103,6 +111,12 @@ public:
     B.SetInsertPoint(I);
   }
 
+  /// Create native retains and releases with the non-atomic entry points,
+  /// for use when replacing calls that were non-atomic themselves.
+  void setNonAtomic(bool Value) {
+    NonAtomic = Value;
+  }
+
   Value *createInsertValue(Value *V1, Value *V2, unsigned Idx) {
     return B.CreateInsertValue(V1, V2, Idx);
   }
@@ -120,7 +134,7 @@ public:
     V = B.CreatePointerCast(V, getObjectPtrTy());
 
     // Create the call.
-    CallInst *CI = CreateCall(getRetain(), V);
+    CallInst *CI = CreateCall(NonAtomic ? getNonAtomicRetain() : getRetain(), V);
     CI->setTailCall(true);
     return CI;
   }
@@ -130,7 +144,7 @@ public:
     V = B.CreatePointerCast(V, getObjectPtrTy());
 
     // Create the call.
-    CallInst *CI = CreateCall(getRelease(), V);
+    CallInst *CI = CreateCall(NonAtomic ? getNonAtomicRelease() : getRelease(), V);
     CI->setTailCall(true);
     return CI;
   }
@@ -148,7 +162,8 @@ public:
   CallInst *createRetainN(Value *V, uint32_t n) {
     // Cast just to make sure that we have the right object type.
     V = B.CreatePointerCast(V, getObjectPtrTy());
-    CallInst *CI = CreateCall(getRetainN(), {V, getIntConstant(n)});
+    CallInst *CI = CreateCall(NonAtomic ? getNonAtomicRetainN() : getRetainN(),
+                              {V, getIntConstant(n)});
     CI->setTailCall(true);
     return CI;
   }
@@ -156,7 +171,8 @@ public:
   CallInst *createReleaseN(Value *V, uint32_t n) {
     // Cast just to make sure we have the right object type.
     V = B.CreatePointerCast(V, getObjectPtrTy());
-    CallInst *CI = CreateCall(getReleaseN(), {V, getIntConstant(n)});
+    CallInst *CI = CreateCall(NonAtomic ? getNonAtomicReleaseN() : getReleaseN(),
+                              {V, getIntConstant(n)});
     CI->setTailCall(true);
     return CI;
   }
@@ -295,6 +311,92 @@ private:
     return ReleaseN.get();
   }
 
+  /// Return a callable function for swift_nonatomic_retain.
+  Constant *getNonAtomicRetain() {
+    if (NonAtomicRetain)
+      return NonAtomicRetain.get();
+    auto *ObjectPtrTy = getObjectPtrTy();
+    auto *VoidTy = Type::getVoidTy(getModule().getContext());
+
+    llvm::Constant *cache = nullptr;
+    NonAtomicRetain = getWrapperFn(getModule(),
+                                   cache,
+                                   "swift_nonatomic_retain",
+                                   SWIFT_RT_ENTRY_REF_AS_STR(
+                                     swift_nonatomic_retain),
+                                   RegisterPreservingCC,
+                                   {VoidTy},
+                                   {ObjectPtrTy},
+                                   {NoUnwind});
+
+    return NonAtomicRetain.get();
+  }
+
+  /// Return a callable function for swift_nonatomic_release.
+  Constant *getNonAtomicRelease() {
+    if (NonAtomicRelease)
+      return NonAtomicRelease.get();
+    auto *ObjectPtrTy = getObjectPtrTy();
+    auto *VoidTy = Type::getVoidTy(getModule().getContext());
+
+    llvm::Constant *cache = nullptr;
+    NonAtomicRelease = getWrapperFn(getModule(),
+                                    cache,
+                                    "swift_nonatomic_release",
+                                    SWIFT_RT_ENTRY_REF_AS_STR(
+                                      swift_nonatomic_release),
+                                    RegisterPreservingCC,
+                                    {VoidTy},
+                                    {ObjectPtrTy},
+                                    {NoUnwind});
+
+    return NonAtomicRelease.get();
+  }
+
+  /// Return a callable function for swift_nonatomic_retain_n.
+  Constant *getNonAtomicRetainN() {
+    if (NonAtomicRetainN)
+      return NonAtomicRetainN.get();
+    auto *ObjectPtrTy = getObjectPtrTy();
+    auto *Int32Ty = Type::getInt32Ty(getModule().getContext());
+    auto *VoidTy = Type::getVoidTy(getModule().getContext());
+
+    llvm::Constant *cache = nullptr;
+    NonAtomicRetainN = getWrapperFn(getModule(),
+                                    cache,
+                                    "swift_nonatomic_retain_n",
+                                    SWIFT_RT_ENTRY_REF_AS_STR(
+                                      swift_nonatomic_retain_n),
+                                    RegisterPreservingCC,
+                                    {VoidTy},
+                                    {ObjectPtrTy, Int32Ty},
+                                    {NoUnwind});
+
+    return NonAtomicRetainN.get();
+  }
+
+  /// Return a callable function for swift_nonatomic_release_n.
+  Constant *getNonAtomicReleaseN() {
+    if (NonAtomicReleaseN)
+      return NonAtomicReleaseN.get();
+    auto *ObjectPtrTy = getObjectPtrTy();
+    auto *Int32Ty = Type::getInt32Ty(getModule().getContext());
+    auto *VoidTy = Type::getVoidTy(getModule().getContext());
+
+    llvm::Constant *cache = nullptr;
+    NonAtomicReleaseN = getWrapperFn(getModule(),
+                                     cache,
+                                     "swift_nonatomic_release_n",
+                                     SWIFT_RT_ENTRY_REF_AS_STR(
+                                       swift_nonatomic_release_n),
+                                     RegisterPreservingCC,
+                                     {VoidTy},
+                                     {ObjectPtrTy, Int32Ty},
+                                     {NoUnwind});
+
+    return NonAtomicReleaseN.get();
+  }
+
   /// getUnknownRetainN - Return a callable function for swift_unknownRetain_n.
   Constant *getUnknownRetainN() {
     if (UnknownRetainN)
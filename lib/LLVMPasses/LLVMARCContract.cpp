@@ -89,6 +89,14 @@ private:
 
 } // end anonymous namespace
 
+/// Return true if all of the given retains or releases are non-atomic, in
+/// which case the call that merges them may be non-atomic as well.
+static bool allNonAtomic(const TinyPtrVector<CallInst *> &List) {
+  return std::all_of(List.begin(), List.end(), [](CallInst *CI) {
+    return isNonAtomicRefCountingCall(*CI);
+  });
+}
+
 void SwiftARCContractImpl::
 performRRNOptimization(DenseMap<Value *, LocalState> &PtrToLocalStateMap) {
   // Go through all of our pointers and merge all of the retains with the
@@ -99,6 +107,7 @@ performRRNOptimization(DenseMap<Value *, LocalState> &PtrToLocalStateMap) {
     if (RetainList.size() > 1) {
       // Create the retainN call right by the first retain.
       B.setInsertPoint(RetainList[0]);
+      B.setNonAtomic(allNonAtomic(RetainList));
       O = RetainList[0]->getArgOperand(0);
       B.createRetainN(RC->getSwiftRCIdentityRoot(O), RetainList.size());
 
@@ -118,6 +127,7 @@ performRRNOptimization(DenseMap<Value *, LocalState> &PtrToLocalStateMap) {
       // Create the releaseN call right by the last release.
       auto *OldCI = ReleaseList[ReleaseList.size() - 1];
       B.setInsertPoint(OldCI);
+      B.setNonAtomic(allNonAtomic(ReleaseList));
       O = OldCI->getArgOperand(0);
       B.createReleaseN(RC->getSwiftRCIdentityRoot(O), ReleaseList.size());
 
@@ -30,9 +30,11 @@ enum RT_Kind {
   RT_NoMemoryAccessed,
 
   /// void swift_retain(SwiftHeapObject *object)
+  /// void swift_nonatomic_retain(SwiftHeapObject *object)
   RT_Retain,
 
   /// void swift_retain_n(SwiftHeapObject *object)
+  /// void swift_nonatomic_retain_n(SwiftHeapObject *object)
   RT_RetainN,
 
   /// void swift::swift_retainUnowned(HeapObject *object)
@@ -42,9 +44,11 @@ enum RT_Kind {
   RT_CheckUnowned,
   
   /// void swift_release(SwiftHeapObject *object)
+  /// void swift_nonatomic_release(SwiftHeapObject *object)
   RT_Release,
 
   /// void swift_release_n(SwiftHeapObject *object)
+  /// void swift_nonatomic_release_n(SwiftHeapObject *object)
   RT_ReleaseN,
 
   /// SwiftHeapObject *swift_allocObject(SwiftHeapMetadata *metadata,
@@ -106,6 +110,10 @@ inline RT_Kind classifyInstruction(const llvm::Instruction &I) {
     .Case("swift_retain_n", RT_RetainN)
     .Case("swift_release", RT_Release)
     .Case("swift_release_n", RT_ReleaseN)
+    .Case("swift_nonatomic_retain", RT_Retain)
+    .Case("swift_nonatomic_retain_n", RT_RetainN)
+    .Case("swift_nonatomic_release", RT_Release)
+    .Case("swift_nonatomic_release_n", RT_ReleaseN)
     .Case("swift_allocObject", RT_AllocObject)
     .Case("objc_release", RT_ObjCRelease)
     .Case("objc_retain", RT_ObjCRetain)
@@ -125,6 +133,10 @@ inline RT_Kind classifyInstruction(const llvm::Instruction &I) {
     .Case(SWIFT_WRAPPER_NAME("swift_retain_n"), RT_RetainN)
     .Case(SWIFT_WRAPPER_NAME("swift_release"), RT_Release)
     .Case(SWIFT_WRAPPER_NAME("swift_release_n"), RT_ReleaseN)
+    .Case(SWIFT_WRAPPER_NAME("swift_nonatomic_retain"), RT_Retain)
+    .Case(SWIFT_WRAPPER_NAME("swift_nonatomic_retain_n"), RT_RetainN)
+    .Case(SWIFT_WRAPPER_NAME("swift_nonatomic_release"), RT_Release)
+    .Case(SWIFT_WRAPPER_NAME("swift_nonatomic_release_n"), RT_ReleaseN)
     .Case(SWIFT_WRAPPER_NAME("swift_allocObject"), RT_AllocObject)
     .Case(SWIFT_WRAPPER_NAME("objc_release"), RT_ObjCRelease)
     .Case(SWIFT_WRAPPER_NAME("objc_retain"), RT_ObjCRetain)
@@ -142,5 +154,19 @@ inline RT_Kind classifyInstruction(const llvm::Instruction &I) {
       .Default(RT_Unknown);
 }
 
+/// Return true if \p CI is a call to one of the non-atomic native reference
+/// counting entry points. These are classified like their atomic
+/// counterparts, but any call that replaces them must stay non-atomic.
+inline bool isNonAtomicRefCountingCall(const llvm::CallInst &CI) {
+  llvm::Function *F = CI.getCalledFunction();
+  if (F == 0) return false;
+  StringRef Name = F->getName();
+#if defined(SWIFT_WRAPPER_PREFIX)
+  if (Name.startswith(SWIFT_WRAPPER_PREFIX))
+    Name = Name.drop_front(strlen(SWIFT_WRAPPER_PREFIX));
+#endif
+  return Name.startswith("swift_nonatomic_");
+}
+
 } // end namespace swift
 #endif
@@ -76,7 +76,8 @@ class SILModule::SerializationCallback : public SerializedSILLoader::Callback {
 SILModule::SILModule(Module *SwiftModule, SILOptions &Options,
                      const DeclContext *associatedDC,
                      bool wholeModule)
-  : TheSwiftModule(SwiftModule), AssociatedDeclContext(associatedDC),
+  : InstAllocator(SwiftModule->getASTContext().LangOpts.UseMalloc),
+    TheSwiftModule(SwiftModule), AssociatedDeclContext(associatedDC),
     Stage(SILStage::Raw), Callback(new SILModule::SerializationCallback()),
     wholeModule(wholeModule), Options(Options), Types(*this) {
 }
@@ -105,11 +106,11 @@ void *SILModule::allocate(unsigned Size, unsigned Align) const {
 }
 
 void *SILModule::allocateInst(unsigned Size, unsigned Align) const {
-  return AlignedAlloc(Size, Align);
+  return InstAllocator.allocate(Size, Align);
 }
 
 void SILModule::deallocateInst(SILInstruction *I) {
-  AlignedFree(I);
+  InstAllocator.deallocate(I);
 }
 
 SILWitnessTable *
@@ -13,6 +13,7 @@
 #define DEBUG_TYPE "sil-passmanager"
 
 #include "swift/Basic/DemangleWrappers.h"
+#include "swift/Basic/JSONSerialization.h"
 #include "swift/SILOptimizer/PassManager/PassManager.h"
 #include "swift/SIL/SILFunction.h"
 #include "swift/SIL/SILModule.h"
@@ -23,8 +24,11 @@
 #include "swift/SILOptimizer/Analysis/FunctionOrder.h"
 #include "swift/SILOptimizer/Analysis/BasicCalleeAnalysis.h"
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Process.h"
 #include "llvm/Support/TimeValue.h"
 #include "llvm/Support/GraphWriter.h"
 
@@ -44,6 +48,16 @@ llvm::cl::opt<bool> SILPrintPassTime(
     "sil-print-pass-time", llvm::cl::init(false),
     llvm::cl::desc("Print the execution time of each SIL pass"));
 
+llvm::cl::opt<std::string> SILPassProfile(
+    "sil-pass-profile", llvm::cl::init(""),
+    llvm::cl::desc("Write a JSON report of the time, instruction count and "
+                   "invalidation effects of each SIL pass to this file"));
+
+llvm::cl::opt<unsigned> SILPassProfileNumFunctions(
+    "sil-pass-profile-functions", llvm::cl::init(10),
+    llvm::cl::desc("The number of most expensive functions to list for each "
+                   "pass in the -sil-pass-profile report"));
+
 llvm::cl::opt<unsigned> SILNumOptPassesToRun(
     "sil-opt-pass-count", llvm::cl::init(UINT_MAX),
     llvm::cl::desc("Stop optimizing after <N> optimization passes"));
@@ -148,6 +162,195 @@ static bool isDisabled(SILTransform *T) {
   return false;
 }
 
+namespace {
+/// The -sil-pass-profile statistics of one pass, accumulated over all the
+/// functions and pass managers of the compilation.
+struct PassProfile {
+  struct FunctionTime {
+    std::string Name;
+    uint64_t Nanoseconds;
+  };
+
+  std::string Name;
+  uint64_t Runs = 0;
+  uint64_t Nanoseconds = 0;
+  int64_t InstructionsDelta = 0;
+  int64_t MallocDelta = 0;
+  uint64_t Invalidations = 0;
+  llvm::StringMap<uint64_t> FunctionNanoseconds;
+
+  /// The most expensive functions, filled in just before writing the report.
+  std::vector<FunctionTime> TopFunctions;
+};
+
+/// The passes in the order in which they first ran.
+struct PassProfileReport {
+  std::vector<PassProfile> Passes;
+  llvm::StringMap<unsigned> PassIndices;
+
+  /// Instruction memory of the module, filled in just before writing the
+  /// report.
+  uint64_t LiveInstBytes = 0;
+  uint64_t PeakInstBytes = 0;
+  uint64_t NumRecycledInsts = 0;
+
+  PassProfile &get(StringRef Name) {
+    auto Inserted = PassIndices.insert({Name, Passes.size()});
+    if (Inserted.second) {
+      Passes.emplace_back();
+      Passes.back().Name = Name.str();
+    }
+    return Passes[Inserted.first->second];
+  }
+
+  void write(StringRef Path);
+};
+
+/// Records one run of a pass in the -sil-pass-profile report.
+class PassProfileScope {
+  SILPassManager &PM;
+  SILTransform *T;
+  /// The function a function pass runs on, or null for a module pass.
+  SILFunction *F;
+  llvm::sys::TimeValue StartTime;
+  size_t StartMalloc;
+  int64_t StartInstructions;
+  unsigned StartInvalidations;
+
+  int64_t countInstructions() const {
+    int64_t Count = 0;
+    auto countIn = [&](SILFunction &Fn) {
+      for (auto &BB : Fn)
+        Count += std::distance(BB.begin(), BB.end());
+    };
+    if (F)
+      countIn(*F);
+    else
+      for (auto &Fn : *PM.getModule())
+        countIn(Fn);
+    return Count;
+  }
+
+public:
+  PassProfileScope(SILPassManager &PM, SILTransform *T, SILFunction *F)
+      : PM(PM), T(T), F(F) {
+    if (SILPassProfile.empty())
+      return;
+    StartInstructions = countInstructions();
+    StartInvalidations = PM.getNumInvalidations();
+    StartMalloc = llvm::sys::Process::GetMallocUsage();
+    StartTime = llvm::sys::TimeValue::now();
+  }
+
+  ~PassProfileScope();
+};
+} // end anonymous namespace
+
+static PassProfileReport &getPassProfileReport() {
+  static PassProfileReport Report;
+  return Report;
+}
+
+PassProfileScope::~PassProfileScope() {
+  if (SILPassProfile.empty())
+    return;
+  llvm::sys::TimeValue Elapsed = llvm::sys::TimeValue::now() - StartTime;
+  uint64_t Delta = uint64_t(Elapsed.seconds()) * 1000000000 +
+                   Elapsed.nanoseconds();
+  size_t EndMalloc = llvm::sys::Process::GetMallocUsage();
+
+  PassProfile &Profile = getPassProfileReport().get(T->getName());
+  ++Profile.Runs;
+  Profile.Nanoseconds += Delta;
+  Profile.InstructionsDelta += countInstructions() - StartInstructions;
+  Profile.MallocDelta += int64_t(EndMalloc) - int64_t(StartMalloc);
+  Profile.Invalidations += PM.getNumInvalidations() - StartInvalidations;
+  Profile.FunctionNanoseconds[F ? F->getName() : "<module>"] += Delta;
+}
+
+namespace swift {
+namespace json {
+template <> struct ObjectTraits<PassProfile::FunctionTime> {
+  static void mapping(Output &out, PassProfile::FunctionTime &value) {
+    out.mapRequired("name", value.Name);
+    out.mapRequired("time_ns", value.Nanoseconds);
+  }
+};
+
+template <> struct ObjectTraits<PassProfile> {
+  static void mapping(Output &out, PassProfile &value) {
+    out.mapRequired("name", value.Name);
+    out.mapRequired("runs", value.Runs);
+    out.mapRequired("time_ns", value.Nanoseconds);
+    out.mapRequired("instructions_delta", value.InstructionsDelta);
+    out.mapRequired("malloc_delta", value.MallocDelta);
+    out.mapRequired("invalidations", value.Invalidations);
+    out.mapRequired("top_functions", value.TopFunctions);
+  }
+};
+
+template <> struct ObjectTraits<PassProfileReport> {
+  static void mapping(Output &out, PassProfileReport &value) {
+    out.mapRequired("live_instruction_bytes", value.LiveInstBytes);
+    out.mapRequired("peak_instruction_bytes", value.PeakInstBytes);
+    out.mapRequired("recycled_instructions", value.NumRecycledInsts);
+    out.mapRequired("passes", value.Passes);
+  }
+};
+
+template <> struct ArrayTraits<std::vector<PassProfile::FunctionTime>> {
+  static size_t size(Output &out,
+                     std::vector<PassProfile::FunctionTime> &seq) {
+    return seq.size();
+  }
+  static PassProfile::FunctionTime &
+  element(Output &out, std::vector<PassProfile::FunctionTime> &seq,
+          size_t index) {
+    return seq[index];
+  }
+};
+
+template <> struct ArrayTraits<std::vector<PassProfile>> {
+  static size_t size(Output &out, std::vector<PassProfile> &seq) {
+    return seq.size();
+  }
+  static PassProfile &element(Output &out, std::vector<PassProfile> &seq,
+                              size_t index) {
+    return seq[index];
+  }
+};
+} // end namespace json
+} // end namespace swift
+
+void PassProfileReport::write(StringRef Path) {
+  for (PassProfile &Profile : Passes) {
+    Profile.TopFunctions.clear();
+    for (auto &Entry : Profile.FunctionNanoseconds)
+      Profile.TopFunctions.push_back({Entry.getKey().str(), Entry.getValue()});
+    // Sort by name for equal times, to keep the report deterministic.
+    std::sort(Profile.TopFunctions.begin(), Profile.TopFunctions.end(),
+              [](const PassProfile::FunctionTime &LHS,
+                 const PassProfile::FunctionTime &RHS) {
+                if (LHS.Nanoseconds != RHS.Nanoseconds)
+                  return LHS.Nanoseconds > RHS.Nanoseconds;
+                return LHS.Name < RHS.Name;
+              });
+    if (Profile.TopFunctions.size() > SILPassProfileNumFunctions)
+      Profile.TopFunctions.resize(SILPassProfileNumFunctions);
+  }
+
+  std::error_code EC;
+  llvm::raw_fd_ostream OS(Path, EC, llvm::sys::fs::F_None);
+  if (EC) {
+    llvm::errs() << "error: cannot write SIL pass profile '" << Path
+                 << "': " << EC.message() << '\n';
+    return;
+  }
+  json::Output Out(OS);
+  Out << *this;
+  OS << '\n';
+}
+
 static void printModule(SILModule *Mod, bool EmitVerboseSIL) {
   if (SILPrintOnlyFun.empty() && SILPrintOnlyFuns.empty()) {
     Mod->dump();
@@ -256,7 +459,10 @@ void SILPassManager::runPassesOnFunction(PassList FuncTransforms,
     Mod->registerDeleteNotificationHandler(SFT);
     if (breakBeforeRunning(F->getName(), SFT->getName()))
       LLVM_BUILTIN_DEBUGTRAP;
-    SFT->run();
+    {
+      PassProfileScope Profile(*this, SFT, F);
+      SFT->run();
+    }
     assert(analysesUnlocked() && "Expected all analyses to be unlocked!");
     Mod->removeDeleteNotificationHandler(SFT);
 
@@ -340,7 +546,9 @@ void SILPassManager::runFunctionPasses(PassList FuncTransforms) {
   const unsigned MaxIterationsWithoutProgress = 20;
 
   // Pop functions off the worklist, and run all function transforms
-  // on each of them.
+  // on each of them. This is intentionally serial: passes allocate from
+  // the module, share the analysis caches and may push new functions onto
+  // the worklist (see "The Swift Pass Manager" in docs/OptimizerDesign.md).
   while (!FunctionWorklist.empty() && continueTransforming()) {
     auto *F = FunctionWorklist.back();
 
@@ -430,7 +638,10 @@ void SILPassManager::runModulePass(SILModuleTransform *SMT) {
   llvm::sys::TimeValue StartTime = llvm::sys::TimeValue::now();
   assert(analysesUnlocked() && "Expected all analyses to be unlocked!");
   Mod->registerDeleteNotificationHandler(SMT);
-  SMT->run();
+  {
+    PassProfileScope Profile(*this, SMT, nullptr);
+    SMT->run();
+  }
   Mod->removeDeleteNotificationHandler(SMT);
   assert(analysesUnlocked() && "Expected all analyses to be unlocked!");
 
@@ -529,6 +740,16 @@ void SILPassManager::run() {
 
 /// D'tor.
 SILPassManager::~SILPassManager() {
+  // The report accumulates over all pass managers, so the last one to be
+  // destroyed leaves the complete report behind.
+  if (!SILPassProfile.empty()) {
+    PassProfileReport &Report = getPassProfileReport();
+    Report.LiveInstBytes = Mod->getLiveInstBytes();
+    Report.PeakInstBytes = Mod->getPeakInstBytes();
+    Report.NumRecycledInsts = Mod->getNumRecycledInsts();
+    Report.write(SILPassProfile);
+  }
+
   // Free all transformations.
   for (auto T : Transformations)
     delete T;
@@ -429,12 +429,23 @@ ConstraintSystem::SolverState::~SolverState() {
       ++JOIN2(Largest,Name);
     #include "ConstraintSolverStats.def"
   }
+
+  // Attribute the work to the expression being type-checked.
+  if (auto *exprStats = CS.getTypeChecker().CurrentExpressionStats) {
+    exprStats->NumStatesExplored += NumStatesExplored;
+    exprStats->NumDisjunctions += NumDisjunctions;
+    exprStats->NumDisjunctionTerms += NumDisjunctionTerms;
+    exprStats->NumTypeVariableBindings += NumTypeVariableBindings;
+    exprStats->MaxDepth = std::max(exprStats->MaxDepth, MaxDepth);
+  }
 }
 
 ConstraintSystem::SolverScope::SolverScope(ConstraintSystem &cs)
   : cs(cs), CGScope(cs.CG)
 {
   ++cs.solverState->depth;
+  cs.solverState->MaxDepth = std::max(cs.solverState->MaxDepth,
+                                      cs.solverState->depth);
 
   resolvedOverloadSets = cs.resolvedOverloadSets;
   numTypeVariables = cs.TypeVariables.size();
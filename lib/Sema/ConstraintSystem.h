@@ -997,6 +997,9 @@ private:
     /// \brief Depth of the solution stack.
     unsigned depth = 0;
 
+    /// \brief The largest depth of the solution stack so far.
+    unsigned MaxDepth = 0;
+
     /// \brief Whether to record failures or not.
     bool recordFixes = false;
 
@@ -36,6 +36,7 @@
 #include "llvm/Support/Allocator.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/SaveAndRestore.h"
+#include "llvm/Support/Timer.h"
 #include <iterator>
 #include <map>
 #include <memory>
@@ -1263,6 +1264,44 @@ namespace {
       }
     }
   };
+
+  /// Records the cost of type-checking an expression, for
+  /// -debug-expression-stats-path and -warn-long-expression-type-checking.
+  ///
+  /// Expressions type-checked while this one is (e.g. the bodies of
+  /// multi-statement closures) are timed separately, and their time is
+  /// taken out of this one's.
+  class ExpressionTimer {
+    TypeChecker &TC;
+    ExpressionStats Stats;
+    ExpressionStats *OuterStats;
+    double StartTime;
+
+  public:
+    ExpressionTimer(TypeChecker &TC, Expr *E)
+        : TC(TC), OuterStats(TC.CurrentExpressionStats),
+          StartTime(llvm::TimeRecord::getCurrentTime().getWallTime()) {
+      Stats.Loc = E->getLoc();
+      TC.CurrentExpressionStats = &Stats;
+    }
+
+    ~ExpressionTimer() {
+      double elapsed =
+        llvm::TimeRecord::getCurrentTime(false).getWallTime() - StartTime;
+      Stats.WallTime += elapsed;
+      TC.CurrentExpressionStats = OuterStats;
+      if (OuterStats)
+        OuterStats->WallTime -= elapsed;
+
+      if (auto *tracker = TC.Context.ExpressionStats)
+        tracker->add(Stats);
+
+      unsigned limit = TC.Context.LangOpts.WarnLongExpressionTypeChecking;
+      unsigned elapsedMS = unsigned(Stats.WallTime * 1000);
+      if (limit && elapsedMS >= limit && Stats.Loc.isValid())
+        TC.diagnose(Stats.Loc, diag::debug_long_expression, elapsedMS, limit);
+    }
+  };
 }
 
 
@@ -1275,6 +1314,10 @@ bool TypeChecker::typeCheckExpression(Expr *&expr, DeclContext *dc,
                                       ExprTypeCheckListener *listener) {
   PrettyStackTraceExpr stackTrace(Context, "type-checking", expr);
 
+  Optional<ExpressionTimer> timer;
+  if (Context.ExpressionStats || Context.LangOpts.WarnLongExpressionTypeChecking)
+    timer.emplace(*this, expr);
+
   // Construct a constraint system from this expression.
   ConstraintSystemOptions csOptions = ConstraintSystemFlags::AllowFixes;
   if (options.contains(TypeCheckExprFlags::PreferForceUnwrapToOptional))
@@ -22,6 +22,7 @@
 #include "swift/AST/AnyFunctionRef.h"
 #include "swift/AST/Availability.h"
 #include "swift/AST/DiagnosticsSema.h"
+#include "swift/AST/ExpressionStatsTracker.h"
 #include "swift/AST/KnownProtocols.h"
 #include "swift/AST/LazyResolver.h"
 #include "swift/AST/TypeRefinementContext.h"
@@ -477,6 +478,10 @@ public:
   /// will need to compute captures for.
   std::vector<AnyFunctionRef> ClosuresWithUncomputedCaptures;
 
+  /// The statistics of the expression being type-checked, when they are
+  /// being recorded. The constraint solver adds its work to them.
+  ExpressionStats *CurrentExpressionStats = nullptr;
+
   /// Describes an attempt to capture a local function.
   struct LocalFunctionCapture {
     FuncDecl *LocalFunction;
@@ -10,6 +10,7 @@
 //
 //===----------------------------------------------------------------------===//
 
+#define DEBUG_TYPE "serialization"
 #include "swift/Serialization/ModuleFile.h"
 #include "swift/Serialization/ModuleFormat.h"
 #include "swift/AST/AST.h"
@@ -19,6 +20,7 @@
 #include "swift/ClangImporter/ClangImporter.h"
 #include "swift/Parse/Parser.h"
 #include "swift/Serialization/BCReadingExtras.h"
+#include "llvm/Support/Debug.h"
 #include "llvm/Support/raw_ostream.h"
 
 using namespace swift;
@@ -1241,10 +1243,30 @@ Decl *ModuleFile::resolveCrossReference(Module *M, uint32_t pathLen) {
         return nullptr;
       }
 
-      auto members = nominal->lookupDirect(memberName, onlyInNominal);
-      values.append(members.begin(), members.end());
-      filterValues(filterTy, M, genericSig, isType, inProtocolExt, ctorInit,
-                   values);
+      // Nested types can usually be found through the nested type table of
+      // the module that declares them, without loading all of the members
+      // of the parent.
+      if (isType) {
+        Module *declaringModule = M ? M : nominal->getModuleContext();
+        for (FileUnit *file : declaringModule->getFiles()) {
+          TypeDecl *nested = file->lookupNestedType(memberName, nominal);
+          if (!nested)
+            continue;
+          if (onlyInNominal && nested->getDeclContext() != nominal)
+            continue;
+          values.push_back(nested);
+          break;
+        }
+        filterValues(filterTy, M, genericSig, isType, inProtocolExt, ctorInit,
+                     values);
+      }
+
+      if (values.empty()) {
+        auto members = nominal->lookupDirect(memberName, onlyInNominal);
+        values.append(members.begin(), members.end());
+        filterValues(filterTy, M, genericSig, isType, inProtocolExt, ctorInit,
+                     values);
+      }
       break;
     }
 
@@ -4085,6 +4107,15 @@ Type ModuleFile::getType(TypeID TID) {
 void ModuleFile::loadAllMembers(Decl *D, uint64_t contextData) {
   PrettyStackTraceDecl trace("loading members for", D);
 
+  DEBUG({
+    llvm::dbgs() << "loading all members of ";
+    if (auto *nominal = dyn_cast<NominalTypeDecl>(D))
+      llvm::dbgs() << nominal->getName();
+    else
+      llvm::dbgs() << "an extension";
+    llvm::dbgs() << "\n";
+  });
+
   BCOffsetRAII restoreOffset(DeclTypeCursor);
   DeclTypeCursor.JumpToBit(contextData);
   SmallVector<Decl *, 16> members;
@@ -4108,6 +4139,36 @@ void ModuleFile::loadAllMembers(Decl *D, uint64_t contextData) {
   }
 }
 
+bool ModuleFile::loadNamedMembers(const Decl *D, Identifier name,
+                                  uint64_t contextData,
+                                  SmallVectorImpl<ValueDecl *> &members) {
+  // Modules written before the member name table existed.
+  if (!DeclMemberNames)
+    return false;
+
+  PrettyStackTraceDecl trace("loading members by name for", D);
+
+  DEBUG({
+    llvm::dbgs() << "loading members named " << name << " of ";
+    if (auto *nominal = dyn_cast<NominalTypeDecl>(D))
+      llvm::dbgs() << nominal->getName();
+    else
+      llvm::dbgs() << "an extension";
+    llvm::dbgs() << "\n";
+  });
+
+  auto iter = DeclMemberNames->find(name);
+  if (iter == DeclMemberNames->end())
+    return true;
+
+  for (auto entry : *iter) {
+    if (entry.first != contextData)
+      continue;
+    members.push_back(cast<ValueDecl>(getDecl(entry.second)));
+  }
+  return true;
+}
+
 void
 ModuleFile::loadAllConformances(const Decl *D, uint64_t contextData,
                           SmallVectorImpl<ProtocolConformance*> &conformances) {
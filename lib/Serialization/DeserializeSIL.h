@@ -23,6 +23,11 @@ namespace llvm {
 }
 
 namespace swift {
+  /// Lazily reads the SIL entities of one module file into a SILModule.
+  ///
+  /// This is not thread-safe: reading a function body resolves decls and
+  /// types through the ModuleFile and lowers types through the SILModule.
+  /// See "Deserialization of SIL bodies is serial" in docs/Serialization.rst.
   class SILDeserializer {
     ModuleFile *MF;
     SILModule &SILMod;
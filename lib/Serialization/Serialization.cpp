@@ -106,6 +106,86 @@ namespace {
     }
   };
 
+  class DeclMemberNamesTableInfo {
+  public:
+    using key_type = Identifier;
+    using key_type_ref = key_type;
+    using data_type = Serializer::DeclMemberNamesData;
+    using data_type_ref = const data_type &;
+    using hash_value_type = uint32_t;
+    using offset_type = unsigned;
+
+    hash_value_type ComputeHash(key_type_ref key) {
+      assert(!key.empty());
+      return llvm::HashString(key.str());
+    }
+
+    std::pair<unsigned, unsigned> EmitKeyDataLength(raw_ostream &out,
+                                                    key_type_ref key,
+                                                    data_type_ref data) {
+      uint32_t keyLength = key.str().size();
+      uint32_t dataLength = (sizeof(uint32_t) * 2) * data.size();
+      endian::Writer<little> writer(out);
+      writer.write<uint16_t>(keyLength);
+      writer.write<uint32_t>(dataLength);
+      return { keyLength, dataLength };
+    }
+
+    void EmitKey(raw_ostream &out, key_type_ref key, unsigned len) {
+      out << key.str();
+    }
+
+    void EmitData(raw_ostream &out, key_type_ref key, data_type_ref data,
+                  unsigned len) {
+      static_assert(declIDFitsIn32Bits(), "DeclID too large");
+      endian::Writer<little> writer(out);
+      for (auto entry : data) {
+        writer.write<uint32_t>(entry.first);
+        writer.write<uint32_t>(entry.second);
+      }
+    }
+  };
+
+  class NestedTypeDeclsTableInfo {
+  public:
+    using key_type = Identifier;
+    using key_type_ref = key_type;
+    using data_type = Serializer::NestedTypeDeclsData;
+    using data_type_ref = const data_type &;
+    using hash_value_type = uint32_t;
+    using offset_type = unsigned;
+
+    hash_value_type ComputeHash(key_type_ref key) {
+      assert(!key.empty());
+      return llvm::HashString(key.str());
+    }
+
+    std::pair<unsigned, unsigned> EmitKeyDataLength(raw_ostream &out,
+                                                    key_type_ref key,
+                                                    data_type_ref data) {
+      uint32_t keyLength = key.str().size();
+      uint32_t dataLength = (sizeof(uint32_t) * 2) * data.size();
+      endian::Writer<little> writer(out);
+      writer.write<uint16_t>(keyLength);
+      writer.write<uint32_t>(dataLength);
+      return { keyLength, dataLength };
+    }
+
+    void EmitKey(raw_ostream &out, key_type_ref key, unsigned len) {
+      out << key.str();
+    }
+
+    void EmitData(raw_ostream &out, key_type_ref key, data_type_ref data,
+                  unsigned len) {
+      static_assert(declIDFitsIn32Bits(), "DeclID too large");
+      endian::Writer<little> writer(out);
+      for (auto entry : data) {
+        writer.write<uint32_t>(entry.first);
+        writer.write<uint32_t>(entry.second);
+      }
+    }
+  };
+
   class LocalDeclTableInfo {
   public:
     using key_type = std::string;
@@ -1254,6 +1334,10 @@ static bool shouldSerializeMember(Decl *D) {
 void Serializer::writeMembers(DeclRange members, bool isClass) {
   using namespace decls_block;
 
+  // The member loader is handed the offset of this record, so it identifies
+  // the container in DeclMembersByName.
+  BitOffset recordOffset = Out.GetCurrentBitNo();
+
   unsigned abbrCode = DeclTypeAbbrCodes[MembersLayout::Code];
   SmallVector<DeclID, 16> memberIDs;
   for (auto member : members) {
@@ -1263,6 +1347,10 @@ void Serializer::writeMembers(DeclRange members, bool isClass) {
     DeclID memberID = addDeclRef(member);
     memberIDs.push_back(memberID);
 
+    if (auto VD = dyn_cast<ValueDecl>(member))
+      if (VD->hasName())
+        DeclMembersByName[VD->getName()].push_back({recordOffset, memberID});
+
     if (isClass) {
       if (auto VD = dyn_cast<ValueDecl>(member)) {
         if (VD->canBeAccessedByDynamicLookup()) {
@@ -3433,6 +3521,54 @@ static void writeDeclTable(const index_block::DeclListLayout &DeclList,
   DeclList.emit(scratch, kind, tableOffset, hashTableBlob);
 }
 
+static void
+writeDeclMemberNamesTable(const index_block::DeclListLayout &DeclList,
+                          const Serializer::DeclMemberNamesTable &table) {
+  if (table.empty())
+    return;
+
+  SmallVector<uint64_t, 8> scratch;
+  llvm::SmallString<4096> hashTableBlob;
+  uint32_t tableOffset;
+  {
+    llvm::OnDiskChainedHashTableGenerator<DeclMemberNamesTableInfo> generator;
+    for (auto &entry : table)
+      generator.insert(entry.first, entry.second);
+
+    llvm::raw_svector_ostream blobStream(hashTableBlob);
+    // Make sure that no bucket is at offset 0
+    endian::Writer<little>(blobStream).write<uint32_t>(0);
+    tableOffset = generator.Emit(blobStream);
+  }
+
+  DeclList.emit(scratch, index_block::DECL_MEMBER_NAMES, tableOffset,
+                hashTableBlob);
+}
+
+static void
+writeNestedTypeDeclsTable(const index_block::DeclListLayout &DeclList,
+                          const Serializer::NestedTypeDeclsTable &table) {
+  if (table.empty())
+    return;
+
+  SmallVector<uint64_t, 8> scratch;
+  llvm::SmallString<4096> hashTableBlob;
+  uint32_t tableOffset;
+  {
+    llvm::OnDiskChainedHashTableGenerator<NestedTypeDeclsTableInfo> generator;
+    for (auto &entry : table)
+      generator.insert(entry.first, entry.second);
+
+    llvm::raw_svector_ostream blobStream(hashTableBlob);
+    // Make sure that no bucket is at offset 0
+    endian::Writer<little>(blobStream).write<uint32_t>(0);
+    tableOffset = generator.Emit(blobStream);
+  }
+
+  DeclList.emit(scratch, index_block::NESTED_TYPE_DECLS, tableOffset,
+                hashTableBlob);
+}
+
 static void writeLocalDeclTable(const index_block::DeclListLayout &DeclList,
                                 index_block::RecordKind kind,
                                 LocalTypeHashTableGenerator &generator) {
@@ -3910,7 +4046,7 @@ static void writeObjCMethodTable(const index_block::ObjCMethodTableLayout &out,
   out.emit(scratch, tableOffset, hashTableBlob);
 }
 
-/// Add operator methods from the given declaration type.
+/// Add operator methods and nested types from the given declaration type.
 ///
 /// Recursively walks the members and derived global decls of any nested
 /// nominal types.
@@ -3919,6 +4055,7 @@ static void addOperatorsAndTopLevel(Serializer &S, Range members,
                                     Serializer::DeclTable &operatorMethodDecls,
                                     Serializer::DeclTable &topLevelDecls,
                                     Serializer::ObjCMethodTable &objcMethods,
+                                    Serializer::NestedTypeDeclsTable &nestedTypes,
                                     bool isDerivedTopLevel,
                                     bool isLocal = false) {
   for (const Decl *member : members) {
@@ -3926,6 +4063,20 @@ static void addOperatorsAndTopLevel(Serializer &S, Range members,
       if (!memberValue->hasName())
         continue;
 
+      // Record types nested in nominal types and their extensions, so that
+      // cross-references to them do not need to load all of the parent's
+      // members. Members of local types are never cross-referenced.
+      if (!isDerivedTopLevel && !isLocal && isa<TypeDecl>(memberValue)) {
+        auto parent = memberValue->getDeclContext()
+                        ->getAsNominalTypeOrNominalTypeExtensionContext();
+        if (parent) {
+          nestedTypes[memberValue->getName()].push_back({
+            S.addDeclRef(parent),
+            S.addDeclRef(memberValue)
+          });
+        }
+      }
+
       if (isDerivedTopLevel) {
         topLevelDecls[memberValue->getName()].push_back({
           /*ignored*/0,
@@ -3946,10 +4097,10 @@ static void addOperatorsAndTopLevel(Serializer &S, Range members,
     if (auto iterable = dyn_cast<IterableDeclContext>(member)) {
       addOperatorsAndTopLevel(S, iterable->getMembers(),
                              operatorMethodDecls, topLevelDecls, objcMethods,
-                             false);
+                             nestedTypes, false);
       addOperatorsAndTopLevel(S, iterable->getDerivedGlobalDecls(),
                              operatorMethodDecls, topLevelDecls, objcMethods,
-                             true);
+                             nestedTypes, true);
     }
 
     // Record Objective-C methods.
@@ -3971,6 +4122,7 @@ static void addOperatorsAndTopLevel(Serializer &S, Range members,
 void Serializer::writeAST(ModuleOrSourceFile DC) {
   DeclTable topLevelDecls, extensionDecls, operatorDecls, operatorMethodDecls;
   ObjCMethodTable objcMethods;
+  NestedTypeDeclsTable nestedTypeDecls;
   LocalTypeHashTableGenerator localTypeGenerator;
   bool hasLocalTypes = false;
 
@@ -4019,10 +4171,10 @@ void Serializer::writeAST(ModuleOrSourceFile DC) {
       if (auto IDC = dyn_cast<IterableDeclContext>(D)) {
         addOperatorsAndTopLevel(*this, IDC->getMembers(),
                                 operatorMethodDecls, topLevelDecls,
-                                objcMethods, false);
+                                objcMethods, nestedTypeDecls, false);
         addOperatorsAndTopLevel(*this, IDC->getDerivedGlobalDecls(),
                                 operatorMethodDecls, topLevelDecls,
-                                objcMethods, true);
+                                objcMethods, nestedTypeDecls, true);
       }
     }
 
@@ -4043,10 +4195,12 @@ void Serializer::writeAST(ModuleOrSourceFile DC) {
       if (auto IDC = dyn_cast<IterableDeclContext>(TD)) {
         addOperatorsAndTopLevel(*this, IDC->getMembers(),
                                 operatorMethodDecls, topLevelDecls,
-                                objcMethods, false, /*isLocal=*/true);
+                                objcMethods, nestedTypeDecls, false,
+                                /*isLocal=*/true);
         addOperatorsAndTopLevel(*this, IDC->getDerivedGlobalDecls(),
                                 operatorMethodDecls, topLevelDecls,
-                                objcMethods, true, /*isLocal=*/true);
+                                objcMethods, nestedTypeDecls, true,
+                                /*isLocal=*/true);
       }
     }
   }
@@ -4070,6 +4224,8 @@ void Serializer::writeAST(ModuleOrSourceFile DC) {
     writeDeclTable(DeclList, index_block::OPERATORS, operatorDecls);
     writeDeclTable(DeclList, index_block::EXTENSIONS, extensionDecls);
     writeDeclTable(DeclList, index_block::CLASS_MEMBERS, ClassMembersByName);
+    writeDeclMemberNamesTable(DeclList, DeclMembersByName);
+    writeNestedTypeDeclsTable(DeclList, nestedTypeDecls);
     writeDeclTable(DeclList, index_block::OPERATOR_METHODS, operatorMethodDecls);
     if (hasLocalTypes)
       writeLocalDeclTable(DeclList, index_block::LOCAL_TYPE_DECLS,
@@ -117,6 +117,16 @@ public:
   /// with.
   const Decl *getGenericContext(const GenericParamList *paramList);
 
+  using DeclMemberNamesData = SmallVector<std::pair<BitOffset, DeclID>, 4>;
+  /// The in-memory representation of what will eventually be an on-disk hash
+  /// table of members by base name.
+  using DeclMemberNamesTable = llvm::MapVector<Identifier, DeclMemberNamesData>;
+
+  using NestedTypeDeclsData = SmallVector<std::pair<DeclID, DeclID>, 4>;
+  /// The in-memory representation of what will eventually be an on-disk hash
+  /// table of nested types by name, as (parent, nested type) pairs.
+  using NestedTypeDeclsTable = llvm::MapVector<Identifier, NestedTypeDeclsData>;
+
   using ObjCMethodTableData = SmallVector<std::tuple<TypeID, bool, DeclID>, 4>;
 
   // In-memory representation of what will eventually be an on-disk
@@ -129,6 +139,12 @@ private:
   /// This is used for id-style lookup.
   DeclTable ClassMembersByName;
 
+  /// A map from base names to the members with that name, together with
+  /// the offset of the MEMBERS record that lists them.
+  ///
+  /// This is used to load only the members with a given name.
+  DeclMemberNamesTable DeclMembersByName;
+
   /// The queue of types and decls that need to be serialized.
   ///
   /// This is a queue and not simply a vector because serializing one
@@ -43,10 +43,17 @@ openModuleFiles(StringRef DirName, StringRef ModuleFilename,
                 llvm::SmallVectorImpl<char> &Scratch) {
   // Try to open the module file first.  If we fail, don't even look for the
   // module documentation file.
+  //
+  // Serialized modules do not need a null terminator, so large enough module
+  // files are mapped read-only instead of being copied into private memory.
+  // This lets concurrent frontends share the pages of commonly imported
+  // modules. Files smaller than a page are still copied.
   Scratch.clear();
   llvm::sys::path::append(Scratch, DirName, ModuleFilename);
   llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> ModuleOrErr =
-    llvm::MemoryBuffer::getFile(StringRef(Scratch.data(), Scratch.size()));
+    llvm::MemoryBuffer::getFile(StringRef(Scratch.data(), Scratch.size()),
+                                /*FileSize=*/-1,
+                                /*RequiresNullTerminator=*/false);
   if (!ModuleOrErr)
     return ModuleOrErr.getError();
 
@@ -55,7 +62,9 @@ openModuleFiles(StringRef DirName, StringRef ModuleFilename,
   Scratch.clear();
   llvm::sys::path::append(Scratch, DirName, ModuleDocFilename);
   llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> ModuleDocOrErr =
-    llvm::MemoryBuffer::getFile(StringRef(Scratch.data(), Scratch.size()));
+    llvm::MemoryBuffer::getFile(StringRef(Scratch.data(), Scratch.size()),
+                                /*FileSize=*/-1,
+                                /*RequiresNullTerminator=*/false);
   if (!ModuleDocOrErr &&
       ModuleDocOrErr.getError() != std::errc::no_such_file_or_directory) {
     return ModuleDocOrErr.getError();
@@ -456,6 +465,12 @@ TypeDecl *SerializedASTFile::lookupLocalType(llvm::StringRef MangledName) const{
   return File.lookupLocalType(MangledName);
 }
 
+TypeDecl *
+SerializedASTFile::lookupNestedType(Identifier name,
+                                    const NominalTypeDecl *parent) const {
+  return File.lookupNestedType(name, parent);
+}
+
 OperatorDecl *SerializedASTFile::lookupOperator(Identifier name,
                                                 DeclKind fixity) const {
   return File.lookupOperator(name, fixity);
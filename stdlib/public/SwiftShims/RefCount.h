@@ -100,6 +100,19 @@ class StrongRefCount {
     __atomic_fetch_add(&refCount, n << RC_FLAGS_COUNT, __ATOMIC_RELAXED);
   }
 
+  // Increment the reference count, without an atomic read-modify-write.
+  // Only valid if no other thread can access the object concurrently.
+  void incrementNonAtomic() {
+    uint32_t val = __atomic_load_n(&refCount, __ATOMIC_RELAXED);
+    __atomic_store_n(&refCount, val + RC_ONE, __ATOMIC_RELAXED);
+  }
+
+  // Increment the reference count by n, without an atomic read-modify-write.
+  void incrementNonAtomic(uint32_t n) {
+    uint32_t val = __atomic_load_n(&refCount, __ATOMIC_RELAXED);
+    __atomic_store_n(&refCount, val + (n << RC_FLAGS_COUNT), __ATOMIC_RELAXED);
+  }
+
   // Try to simultaneously set the pinned flag and increment the
   // reference count.  If the flag is already set, don't increment the
   // reference count.
@@ -158,6 +171,17 @@ class StrongRefCount {
     return doDecrementShouldDeallocateN<false>(n);
   }
 
+  // Non-atomically decrement the reference count.
+  // Return true if the caller should now deallocate the object.
+  // Only valid if no other thread can access the object concurrently.
+  bool decrementShouldDeallocateNonAtomic() {
+    return doDecrementShouldDeallocateNNonAtomic(1);
+  }
+
+  bool decrementShouldDeallocateNNonAtomic(uint32_t n) {
+    return doDecrementShouldDeallocateNNonAtomic(n);
+  }
+
   // Set the RC_DEALLOCATING_FLAG flag non-atomically.
   //
   // Precondition: the reference count must be 1
@@ -273,6 +297,25 @@ private:
     return __atomic_compare_exchange(&refCount, &oldval, &newval, 0,
                                      __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
   }
+
+  bool doDecrementShouldDeallocateNNonAtomic(uint32_t n) {
+    uint32_t delta = n << RC_FLAGS_COUNT;
+    uint32_t oldval = __atomic_load_n(&refCount, __ATOMIC_RELAXED);
+    assert(oldval >= delta && "releasing reference with a refcount of zero");
+    uint32_t newval = oldval - delta;
+
+    // See doDecrementShouldDeallocate() for the flag test. With no other
+    // threads to race with, setting the deallocating flag needs no
+    // compare-and-swap and no barrier.
+    if ((newval & (RC_COUNT_MASK | RC_PINNED_FLAG | RC_DEALLOCATING_FLAG))
+          != 0) {
+      __atomic_store_n(&refCount, newval, __ATOMIC_RELAXED);
+      return false;
+    }
+
+    __atomic_store_n(&refCount, RC_DEALLOCATING_FLAG, __ATOMIC_RELAXED);
+    return true;
+  }
 };
 
 
@@ -282,8 +325,8 @@ class WeakRefCount {
   uint32_t refCount;
 
   enum : uint32_t {
-    // There isn't really a flag here.
-    RC_UNUSED_FLAG = 1,
+    // Set once the object has a weak reference side table.
+    RC_SIDE_TABLE_FLAG = 1,
 
     RC_FLAGS_COUNT = 1,
     RC_FLAGS_MASK = 1,
@@ -360,6 +403,17 @@ class WeakRefCount {
   uint32_t getCount() const {
     return __atomic_load_n(&refCount, __ATOMIC_RELAXED) >> RC_FLAGS_COUNT;
   }
+
+  // Record that a weak reference side table has been created for the object.
+  void setHasSideTable() {
+    __atomic_fetch_or(&refCount, RC_SIDE_TABLE_FLAG, __ATOMIC_RELAXED);
+  }
+
+  // Return true if a weak reference side table has been created for the
+  // object.
+  bool hasSideTable() const {
+    return __atomic_load_n(&refCount, __ATOMIC_RELAXED) & RC_SIDE_TABLE_FLAG;
+  }
 };
 
 static_assert(swift::IsTriviallyConstructible<StrongRefCount>::value,
@@ -18,16 +18,19 @@
 #include "swift/Basic/Demangle.h"
 #include "swift/Basic/Fallthrough.h"
 #include "swift/Basic/Lazy.h"
+#include "swift/Runtime/Concurrent.h"
 #include "swift/Runtime/Config.h"
 #include "swift/Runtime/Enum.h"
 #include "swift/Runtime/HeapObject.h"
 #include "swift/Runtime/Metadata.h"
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/Hashing.h"
 #include "llvm/ADT/PointerIntPair.h"
 #include "swift/Runtime/Debug.h"
 #include "ErrorObject.h"
 #include "ExistentialMetadataImpl.h"
 #include "Private.h"
+#include "RuntimeStatistics.h"
 #include "../SwiftShims/RuntimeShims.h"
 #include "stddef.h"
 
@@ -662,6 +665,201 @@ static bool _conformsToProtocols(const OpaqueValue *value,
   return true;
 }
 
+//===----------------------------------------------------------------------===//
+// Dynamic cast cache
+//===----------------------------------------------------------------------===//
+
+namespace {
+
+struct DynamicCastCacheKey {
+  const Metadata *Source;
+  const Metadata *Target;
+};
+
+/// Return the number of witness tables stored in an existential of the
+/// given type, or zero if it is not an existential type.
+static unsigned getNumWitnessTablesForTarget(const Metadata *target) {
+  if (auto existential = dyn_cast<ExistentialTypeMetadata>(target))
+    return existential->Flags.getNumWitnessTables();
+  return 0;
+}
+
+/// The remembered outcome of casting values of one type to another, for
+/// pairs of types where the outcome does not depend on the value.
+///
+/// A success is final; for existential targets, the entry also holds the
+/// witness tables of the conformances.  A failure is tagged with the
+/// protocol conformance generation it was observed under, since loading
+/// new code may add conformances that make the cast succeed.
+class DynamicCastCacheEntry {
+  const Metadata *Source;
+  const Metadata *Target;
+
+  enum : uintptr_t {
+    Succeeded = ~uintptr_t(0),
+    /// A thread is filling in the witness tables of a success.
+    Publishing = ~uintptr_t(1),
+    /// No outcome has been recorded yet.
+    Unknown = ~uintptr_t(2),
+    // Any other value is the generation a failure was observed under.
+  };
+  std::atomic<uintptr_t> State;
+
+  const WitnessTable **getWitnessTables() {
+    return reinterpret_cast<const WitnessTable **>(this + 1);
+  }
+
+public:
+  enum class Outcome { Unknown, Succeeded, Failed };
+
+  DynamicCastCacheEntry(DynamicCastCacheKey key)
+    : Source(key.Source), Target(key.Target), State(Unknown) {}
+
+  long getKeyIntValueForDump() const {
+    return reinterpret_cast<long>(Source);
+  }
+
+  int compareWithKey(DynamicCastCacheKey key) const {
+    if (key.Source != Source)
+      return (uintptr_t(key.Source) < uintptr_t(Source) ? -1 : 1);
+    if (key.Target != Target)
+      return (uintptr_t(key.Target) < uintptr_t(Target) ? -1 : 1);
+    return 0;
+  }
+
+  static size_t getKeyHash(DynamicCastCacheKey key) {
+    return llvm::hash_combine(key.Source, key.Target);
+  }
+
+  static size_t getExtraAllocationSize(DynamicCastCacheKey key) {
+    return getNumWitnessTablesForTarget(key.Target) * sizeof(void*);
+  }
+
+  /// Look up the outcome, copying out the witness tables of a success.
+  Outcome getOutcome(uintptr_t generation,
+                     const WitnessTable **conformances = nullptr) {
+    uintptr_t state = State.load(std::memory_order_acquire);
+    if (state == Succeeded) {
+      if (conformances)
+        memcpy(conformances, getWitnessTables(),
+               getNumWitnessTablesForTarget(Target) * sizeof(void*));
+      return Outcome::Succeeded;
+    }
+    if (state == generation)
+      return Outcome::Failed;
+    return Outcome::Unknown;
+  }
+
+  void recordSuccess(const WitnessTable * const *conformances) {
+    uintptr_t state = State.load(std::memory_order_relaxed);
+    while (state != Succeeded && state != Publishing) {
+      if (State.compare_exchange_weak(state, Publishing,
+                                      std::memory_order_acquire,
+                                      std::memory_order_relaxed)) {
+        memcpy(getWitnessTables(), conformances,
+               getNumWitnessTablesForTarget(Target) * sizeof(void*));
+        State.store(Succeeded, std::memory_order_release);
+        return;
+      }
+    }
+  }
+
+  void recordFailure(uintptr_t generation) {
+    uintptr_t state = State.load(std::memory_order_relaxed);
+    // Successes are final, and a newer failure must not be replaced by an
+    // older one.
+    while (state == Unknown || state < generation) {
+      if (State.compare_exchange_weak(state, generation,
+                                      std::memory_order_relaxed))
+        return;
+    }
+  }
+};
+
+} // end anonymous namespace
+
+static Lazy<ConcurrentMap<DynamicCastCacheEntry>> DynamicCasts;
+
+/// Whether the protocols a type conforms to can be decided from the type
+/// alone, rather than also from the value.
+static bool _isConformanceDeterminedByType(
+                                    const Metadata *type,
+                                    const ProtocolDescriptorList &protocols) {
+  switch (type->getKind()) {
+  case MetadataKind::Class:
+  case MetadataKind::ObjCClassWrapper:
+  case MetadataKind::ForeignClass:
+    // Conformances of class instances to Objective-C protocols are checked
+    // on the object.
+    for (unsigned i = 0, n = protocols.NumProtocols; i != n; ++i) {
+      auto flags = protocols[i]->Flags;
+      if (!flags.needsWitnessTable() &&
+          flags.getSpecialProtocol() != SpecialProtocol::AnyObject)
+        return false;
+    }
+    return true;
+
+  case MetadataKind::Existential:
+  case MetadataKind::ExistentialMetatype:
+  case MetadataKind::Function:
+  case MetadataKind::HeapLocalVariable:
+  case MetadataKind::HeapGenericLocalVariable:
+  case MetadataKind::ErrorObject:
+  case MetadataKind::Metatype:
+  case MetadataKind::Enum:
+  case MetadataKind::Optional:
+  case MetadataKind::Opaque:
+  case MetadataKind::Struct:
+  case MetadataKind::Tuple:
+    return true;
+  }
+  _failCorruptType(type);
+}
+
+/// Check whether a type conforms to the protocols of an existential type,
+/// filling in a list of conformances.  The outcome is cached when it does
+/// not depend on the value.
+static bool _conformsToExistential(const OpaqueValue *value,
+                                   const Metadata *type,
+                                   const ExistentialTypeMetadata *existential,
+                                   const WitnessTable **conformances) {
+  if (!_isConformanceDeterminedByType(type, existential->Protocols)) {
+    countRuntimeStatistic(RuntimeStatistic::DynamicCastToExistentialSlowPaths);
+    return _conformsToProtocols(value, type, existential->Protocols,
+                                conformances);
+  }
+
+  // Read the generation first, so that a failure is never tagged with a
+  // generation whose conformances it did not consider.
+  uintptr_t generation = _swift_getProtocolConformanceGeneration();
+  DynamicCastCacheKey key{type, existential};
+  if (auto entry = DynamicCasts->find(key)) {
+    switch (entry->getOutcome(generation, conformances)) {
+    case DynamicCastCacheEntry::Outcome::Succeeded:
+      countRuntimeStatistic(
+        RuntimeStatistic::DynamicCastToExistentialCacheHits);
+      return true;
+    case DynamicCastCacheEntry::Outcome::Failed:
+      countRuntimeStatistic(
+        RuntimeStatistic::DynamicCastToExistentialCacheHits);
+      return false;
+    case DynamicCastCacheEntry::Outcome::Unknown:
+      break;
+    }
+  }
+
+  countRuntimeStatistic(RuntimeStatistic::DynamicCastToExistentialSlowPaths);
+
+  bool result = _conformsToProtocols(value, type, existential->Protocols,
+                                     conformances);
+  auto entry = DynamicCasts->getOrInsert(key).first;
+  if (result)
+    entry->recordSuccess(conformances);
+  else
+    entry->recordFailure(generation);
+  return result;
+}
+
 static bool shouldDeallocateSource(bool castSucceeded, DynamicCastFlags flags) {
   return (castSucceeded && (flags & DynamicCastFlags::TakeOnSuccess)) ||
         (!castSucceeded && (flags & DynamicCastFlags::DestroyOnFailure));
@@ -982,9 +1180,8 @@ static bool _dynamicCastToExistential(OpaqueValue *dest,
     }
 
     // Check for protocol conformances and fill in the witness tables.
-    if (!_conformsToProtocols(srcDynamicValue, srcDynamicType,
-                              targetType->Protocols,
-                              destExistential->getWitnessTables())) {
+    if (!_conformsToExistential(srcDynamicValue, srcDynamicType, targetType,
+                                destExistential->getWitnessTables())) {
       return _fail(src, srcType, targetType, flags, srcDynamicType);
     }
 
@@ -1001,9 +1198,8 @@ static bool _dynamicCastToExistential(OpaqueValue *dest,
       reinterpret_cast<OpaqueExistentialContainer*>(dest);
 
     // Check for protocol conformances and fill in the witness tables.
-    if (!_conformsToProtocols(srcDynamicValue, srcDynamicType,
-                              targetType->Protocols,
-                              destExistential->getWitnessTables()))
+    if (!_conformsToExistential(srcDynamicValue, srcDynamicType, targetType,
+                                destExistential->getWitnessTables()))
       return _fail(src, srcType, targetType, flags, srcDynamicType);
 
     // Fill in the type and value.
@@ -1025,9 +1221,8 @@ static bool _dynamicCastToExistential(OpaqueValue *dest,
     // one we need.
     assert(targetType->Protocols.NumProtocols == 1);
     const WitnessTable *errorWitness;
-    if (!_conformsToProtocols(srcDynamicValue, srcDynamicType,
-                              targetType->Protocols,
-                              &errorWitness))
+    if (!_conformsToExistential(srcDynamicValue, srcDynamicType, targetType,
+                                &errorWitness))
       return _fail(src, srcType, targetType, flags, srcDynamicType);
     
     BoxPair destBox = swift_allocError(srcDynamicType, errorWitness,
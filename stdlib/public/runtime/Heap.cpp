@@ -12,27 +12,434 @@
 //
 // Implementations of the Swift heap
 //
+// By default the heap is the system allocator. Setting the environment
+// variable SWIFT_RUNTIME_ALLOCATOR=slab selects a size-class slab allocator
+// with per-thread caches instead. The choice is made once, at the first
+// allocation, and holds for the lifetime of the process.
+//
 //===----------------------------------------------------------------------===//
 
+#include "swift/Basic/Lazy.h"
 #include "swift/Runtime/HeapObject.h"
 #include "swift/Runtime/Heap.h"
 #include "Private.h"
 #include "swift/Runtime/Debug.h"
+#include "llvm/Support/MathExtras.h"
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <pthread.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#if defined(__APPLE__)
+#include <malloc/malloc.h>
+#elif defined(__GNU_LIBRARY__) || defined(__CYGWIN__)
+#include <malloc.h>
+#elif defined(__FreeBSD__)
+#include <malloc_np.h>
+#endif
 
 using namespace swift;
 
+#if defined(__APPLE__)
+/// On Apple platforms, malloc() is always 16-byte aligned.
+# define MALLOC_ALIGN_MASK 15
+#elif defined(__LP64__)
+/// On 64-bit platforms, malloc() is 16-byte aligned.
+# define MALLOC_ALIGN_MASK 15
+#else
+/// Elsewhere, assume malloc() is only pointer-pair aligned.
+# define MALLOC_ALIGN_MASK (2 * sizeof(void*) - 1)
+#endif
+
+/// Allocate memory from the system allocator, honoring alignments beyond
+/// what malloc() guarantees.
+static void *systemAlloc(size_t size, size_t alignMask) {
+  void *p;
+  if (alignMask <= MALLOC_ALIGN_MASK) {
+    p = malloc(size);
+  } else {
+    size_t alignment = std::max(alignMask + 1, sizeof(void*));
+    if (posix_memalign(&p, alignment, size) != 0)
+      p = nullptr;
+  }
+  if (!p) swift::crash("Could not allocate memory.");
+  return p;
+}
+
+static size_t systemAllocSize(const void *ptr) {
+#if defined(__APPLE__)
+  return malloc_size(ptr);
+#elif defined(__GNU_LIBRARY__) || defined(__CYGWIN__) || defined(__FreeBSD__)
+  return malloc_usable_size(const_cast<void *>(ptr));
+#else
+#error No malloc_size analog known for this platform/libc.
+#endif
+}
+
+//===----------------------------------------------------------------------===//
+//                            Slab Allocator
+//===----------------------------------------------------------------------===//
+//
+// Small allocations are served from 64KB chunks, each of which is carved into
+// objects of a single size class. Every thread keeps, per size class, a free
+// list and the uncarved tail of the chunk it is currently carving. Allocation
+// and deallocation only touch these thread-local lists. Threads exchange
+// memory with a per-size-class central list in batches, and acquire new
+// chunks from a global pool, on their slow paths only.
+//
+// A two-level chunk map records the size class of every chunk, so that
+// deallocation needs no size information and pointers that did not come from
+// a chunk can be identified and handed back to the system allocator. Chunks
+// are never returned to the system.
+//
+//===----------------------------------------------------------------------===//
+
+namespace {
+
+constexpr unsigned ChunkShift = 16;
+constexpr size_t ChunkSize = size_t(1) << ChunkShift;
+
+/// Chunks are carved out of regions of this size, mapped from the system.
+constexpr size_t RegionSize = 64 * ChunkSize;
+
+constexpr unsigned NumSizeClasses = 20;
+
+/// The object size of each size class. Size class 0 means "not a slab
+/// allocation". Power-of-two classes are naturally aligned, because chunks
+/// are chunk-aligned.
+constexpr uint16_t SizeClassSizes[NumSizeClasses + 1] = {
+  0,
+  16, 32, 48, 64, 80, 96, 112, 128,
+  160, 192, 224, 256,
+  320, 384, 448, 512,
+  640, 768, 896, 1024
+};
+
+constexpr size_t MaxSlabSize = 1024;
+
+/// The smallest size class that fits (size + 15) / 16 granules.
+constexpr uint8_t SizeClassForGranules[MaxSlabSize / 16 + 1] = {
+  1, 1, 2, 3, 4, 5, 6, 7, 8, 9, 9, 10, 10, 11, 11, 12, 12,
+  13, 13, 13, 13, 14, 14, 14, 14, 15, 15, 15, 15, 16, 16, 16, 16,
+  17, 17, 17, 17, 17, 17, 17, 17, 18, 18, 18, 18, 18, 18, 18, 18,
+  19, 19, 19, 19, 19, 19, 19, 19, 20, 20, 20, 20, 20, 20, 20, 20
+};
+
+/// Return the size class for an allocation, or 0 if it must be served by the
+/// system allocator.
+static inline unsigned getSizeClass(size_t size, size_t alignMask) {
+  if (LLVM_LIKELY(alignMask <= 15)) {
+    if (LLVM_UNLIKELY(size > MaxSlabSize))
+      return 0;
+    return SizeClassForGranules[(size + 15) >> 4];
+  }
+
+  // Over-aligned allocations use the power-of-two class that is at least as
+  // big as both the size and the alignment.
+  size_t rounded = std::max(size, alignMask + 1);
+  if (rounded > MaxSlabSize)
+    return 0;
+  rounded = llvm::NextPowerOf2(rounded - 1);
+  return SizeClassForGranules[rounded >> 4];
+}
+
+/// A free object. The second word is only used by the first object of a
+/// batch on the central lists.
+struct FreeObject {
+  FreeObject *Next;
+  FreeObject *NextBatch;
+};
+
+/// Maps chunk addresses to their size class. All-zero is the empty map, so
+/// that it needs no initialization.
+class ChunkMap {
+  static constexpr unsigned AddressBits = sizeof(void*) == 8 ? 48 : 32;
+  static constexpr unsigned LeafBits = 16;
+  static constexpr unsigned TopBits = AddressBits - ChunkShift - LeafBits;
+
+  std::atomic<uint8_t *> Top[size_t(1) << TopBits];
+
+public:
+  /// Can the chunk at this address be recorded in the map?
+  static bool isMappable(uintptr_t address) {
+    return (address >> ChunkShift >> LeafBits) < (size_t(1) << TopBits);
+  }
+
+  unsigned lookup(const void *ptr) const {
+    uintptr_t index = uintptr_t(ptr) >> ChunkShift;
+    uintptr_t top = index >> LeafBits;
+    if (LLVM_UNLIKELY(top >= (size_t(1) << TopBits)))
+      return 0;
+    uint8_t *leaf = Top[top].load(std::memory_order_acquire);
+    if (!leaf)
+      return 0;
+    return leaf[index & ((size_t(1) << LeafBits) - 1)];
+  }
+
+  /// Record the size class of a chunk. Must be called with the slab pool's
+  /// chunk lock held.
+  void set(void *chunk, unsigned sizeClass) {
+    uintptr_t index = uintptr_t(chunk) >> ChunkShift;
+    uintptr_t top = index >> LeafBits;
+    uint8_t *leaf = Top[top].load(std::memory_order_relaxed);
+    if (!leaf) {
+      leaf = static_cast<uint8_t *>(
+        mmap(nullptr, size_t(1) << LeafBits, PROT_READ|PROT_WRITE,
+             MAP_ANON|MAP_PRIVATE, -1, 0));
+      if (leaf == MAP_FAILED)
+        swift::crash("Could not allocate memory.");
+      Top[top].store(leaf, std::memory_order_release);
+    }
+    leaf[index & ((size_t(1) << LeafBits) - 1)] = sizeClass;
+  }
+};
+
+static ChunkMap SlabChunks;
+
+/// The process-wide state of the slab allocator that is only needed on the
+/// slow paths.
+struct SlabPool {
+  /// Guards the chunk pool and chunk map updates.
+  std::mutex ChunkLock;
+  char *RegionNext = nullptr;
+  char *RegionEnd = nullptr;
+
+  /// Batches of free objects that threads have released, per size class.
+  struct CentralList {
+    std::mutex Lock;
+    FreeObject *Batches = nullptr;
+  };
+  CentralList Central[NumSizeClasses + 1];
+
+  /// Hand out a fresh chunk for the given size class, or null if the system
+  /// gave us memory we cannot track.
+  char *allocateChunk(unsigned sizeClass) {
+    std::lock_guard<std::mutex> guard(ChunkLock);
+    if (RegionNext == RegionEnd) {
+      // Over-allocate by a chunk so that we can align the region.
+      void *region = mmap(nullptr, RegionSize + ChunkSize,
+                          PROT_READ|PROT_WRITE, MAP_ANON|MAP_PRIVATE, -1, 0);
+      if (region == MAP_FAILED)
+        swift::crash("Could not allocate memory.");
+      uintptr_t begin = (uintptr_t(region) + ChunkSize - 1) & ~(ChunkSize - 1);
+      if (!ChunkMap::isMappable(begin + RegionSize - 1)) {
+        munmap(region, RegionSize + ChunkSize);
+        return nullptr;
+      }
+      RegionNext = reinterpret_cast<char *>(begin);
+      RegionEnd = RegionNext + RegionSize;
+    }
+    char *chunk = RegionNext;
+    RegionNext += ChunkSize;
+    SlabChunks.set(chunk, sizeClass);
+    return chunk;
+  }
+};
+
+static Lazy<SlabPool> Slabs;
+
+/// A thread's private cache of free objects.
+struct ThreadCache {
+  struct SizeClassCache {
+    FreeObject *FreeList;
+    unsigned Count;
+    /// The uncarved part of the chunk this thread is carving.
+    char *BumpNext;
+    char *BumpEnd;
+  };
+  SizeClassCache Classes[NumSizeClasses + 1];
+
+  /// Has this thread arranged for its cache to be flushed when it exits?
+  bool IsRegistered;
+};
+
+static SWIFT_THREAD_LOCAL ThreadCache Cache;
+
+/// The number of objects moved between a thread and the central list at a
+/// time: a quarter of a chunk's worth.
+static inline unsigned getBatchSize(unsigned sizeClass) {
+  return ChunkSize / 4 / SizeClassSizes[sizeClass];
+}
+
+/// Move a batch of up to \p count objects from the front of a thread's free
+/// list to the central list.
+static void releaseBatch(ThreadCache::SizeClassCache &local,
+                         unsigned sizeClass, unsigned count) {
+  FreeObject *first = local.FreeList;
+  if (!first)
+    return;
+  FreeObject *last = first;
+  unsigned taken = 1;
+  while (taken < count && last->Next) {
+    last = last->Next;
+    ++taken;
+  }
+  local.FreeList = last->Next;
+  local.Count -= taken;
+  last->Next = nullptr;
+
+  auto &central = Slabs->Central[sizeClass];
+  std::lock_guard<std::mutex> guard(central.Lock);
+  first->NextBatch = central.Batches;
+  central.Batches = first;
+}
+
+/// Return everything a thread has cached to the central lists.
+static void flushThreadCache(void *) {
+  for (unsigned sizeClass = 1; sizeClass <= NumSizeClasses; ++sizeClass) {
+    auto &local = Cache.Classes[sizeClass];
+    size_t objectSize = SizeClassSizes[sizeClass];
+
+    // Carve up what is left of the current chunk so it is not lost.
+    while (local.BumpNext + objectSize <= local.BumpEnd) {
+      auto object = reinterpret_cast<FreeObject *>(local.BumpNext);
+      object->Next = local.FreeList;
+      local.FreeList = object;
+      ++local.Count;
+      local.BumpNext += objectSize;
+    }
+    local.BumpNext = local.BumpEnd = nullptr;
+
+    while (local.FreeList)
+      releaseBatch(local, sizeClass, getBatchSize(sizeClass));
+  }
+
+  // Destructors of other keys may allocate again; register anew if so.
+  Cache.IsRegistered = false;
+}
+
+static pthread_key_t createThreadCacheKey() {
+  pthread_key_t key;
+  if (pthread_key_create(&key, flushThreadCache) != 0)
+    swift::crash("Could not create the allocator's thread cache key.");
+  return key;
+}
+
+/// The allocation slow path: refill the thread's cache from the central list
+/// or a new chunk, then allocate from it. Returns null if the allocation
+/// must be served by the system allocator instead.
+LLVM_ATTRIBUTE_NOINLINE
+static void *slabAllocSlow(unsigned sizeClass) {
+  if (!Cache.IsRegistered) {
+    // Any non-null value makes the key's destructor run at thread exit.
+    pthread_setspecific(SWIFT_LAZY_CONSTANT(createThreadCacheKey()), &Cache);
+    Cache.IsRegistered = true;
+  }
+
+  auto &local = Cache.Classes[sizeClass];
+  size_t objectSize = SizeClassSizes[sizeClass];
+
+  // Take a batch that another thread released.
+  {
+    auto &central = Slabs->Central[sizeClass];
+    std::lock_guard<std::mutex> guard(central.Lock);
+    if (FreeObject *batch = central.Batches) {
+      central.Batches = batch->NextBatch;
+      local.FreeList = batch->Next;
+      for (FreeObject *o = local.FreeList; o; o = o->Next)
+        ++local.Count;
+      return batch;
+    }
+  }
+
+  // Otherwise start carving a new chunk.
+  char *chunk = Slabs->allocateChunk(sizeClass);
+  if (!chunk)
+    return nullptr;
+  local.BumpNext = chunk + objectSize;
+  local.BumpEnd = chunk + ChunkSize;
+  return chunk;
+}
+
+static inline void *slabAlloc(size_t size, size_t alignMask) {
+  unsigned sizeClass = getSizeClass(size, alignMask);
+  if (LLVM_LIKELY(sizeClass != 0)) {
+    auto &local = Cache.Classes[sizeClass];
+    if (FreeObject *object = local.FreeList) {
+      local.FreeList = object->Next;
+      --local.Count;
+      return object;
+    }
+    size_t objectSize = SizeClassSizes[sizeClass];
+    if (local.BumpNext + objectSize <= local.BumpEnd) {
+      void *object = local.BumpNext;
+      local.BumpNext += objectSize;
+      return object;
+    }
+    if (void *object = slabAllocSlow(sizeClass))
+      return object;
+  }
+  return systemAlloc(size, alignMask);
+}
+
+static inline void slabDealloc(void *ptr) {
+  unsigned sizeClass = SlabChunks.lookup(ptr);
+  if (LLVM_UNLIKELY(sizeClass == 0)) {
+    free(ptr);
+    return;
+  }
+
+  auto &local = Cache.Classes[sizeClass];
+  auto object = static_cast<FreeObject *>(ptr);
+  object->Next = local.FreeList;
+  local.FreeList = object;
+
+  // Don't let a thread that frees what others allocate hoard memory.
+  if (LLVM_UNLIKELY(++local.Count > 2 * getBatchSize(sizeClass)))
+    releaseBatch(local, sizeClass, getBatchSize(sizeClass));
+}
+
+enum class HeapKind : uint8_t {
+  Uninitialized,
+  System,
+  Slab
+};
+
+static std::atomic<HeapKind> CurrentHeapKind(HeapKind::Uninitialized);
+
+LLVM_ATTRIBUTE_NOINLINE
+static HeapKind initializeHeapKind() {
+  const char *setting = getenv("SWIFT_RUNTIME_ALLOCATOR");
+  HeapKind kind = (setting && strcmp(setting, "slab") == 0)
+    ? HeapKind::Slab : HeapKind::System;
+  CurrentHeapKind.store(kind, std::memory_order_relaxed);
+  return kind;
+}
+
+static inline HeapKind getHeapKind() {
+  HeapKind kind = CurrentHeapKind.load(std::memory_order_relaxed);
+  if (LLVM_UNLIKELY(kind == HeapKind::Uninitialized))
+    return initializeHeapKind();
+  return kind;
+}
+
+} // end anonymous namespace
+
 SWIFT_RT_ENTRY_VISIBILITY
 void *swift::swift_slowAlloc(size_t size, size_t alignMask)
     SWIFT_CC(RegisterPreservingCC_IMPL) {
-  // FIXME: use posix_memalign if alignMask is larger than the system guarantee.
-  void *p = malloc(size);
-  if (!p) swift::crash("Could not allocate memory.");
-  return p;
+  if (getHeapKind() == HeapKind::Slab)
+    return slabAlloc(size, alignMask);
+  return systemAlloc(size, alignMask);
 }
 
 SWIFT_RT_ENTRY_VISIBILITY
 void swift::swift_slowDealloc(void *ptr, size_t bytes, size_t alignMask)
     SWIFT_CC(RegisterPreservingCC_IMPL) {
-  free(ptr);
+  // Memory can only have been allocated once the heap kind was chosen.
+  if (CurrentHeapKind.load(std::memory_order_relaxed) == HeapKind::Slab)
+    slabDealloc(ptr);
+  else
+    free(ptr);
+}
+
+size_t swift::_swift_slowAllocUsableSize(const void *ptr) {
+  if (CurrentHeapKind.load(std::memory_order_relaxed) == HeapKind::Slab) {
+    if (unsigned sizeClass = SlabChunks.lookup(ptr))
+      return SizeClassSizes[sizeClass];
+  }
+  return systemAllocSize(ptr);
 }
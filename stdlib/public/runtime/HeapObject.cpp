@@ -19,15 +19,19 @@
 #include "swift/Runtime/Heap.h"
 #include "swift/Runtime/Metadata.h"
 #include "swift/ABI/System.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/Support/MathExtras.h"
 #include "MetadataCache.h"
 #include "Private.h"
 #include "swift/Runtime/Debug.h"
 #include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <cstring>
 #include <cstdio>
 #include <cstdlib>
+#include <mutex>
+#include <sched.h>
 #include <unistd.h>
 #include "../SwiftShims/RuntimeShims.h"
 #if SWIFT_OBJC_INTEROP
@@ -215,6 +219,10 @@ public:
     return "BoxCache";
   }
 
+  static MetadataCacheKind getStatisticsKind() {
+    return MetadataCacheKind::BoxCache;
+  }
+
   FullMetadata<GenericBoxHeapMetadata> *getData() {
     return &Metadata;
   }
@@ -344,6 +352,72 @@ void SWIFT_RT_ENTRY_IMPL(swift_release_n)(HeapObject *object, uint32_t n)
   }
 }
 
+SWIFT_RT_ENTRY_VISIBILITY
+extern "C"
+void swift::swift_nonatomic_retain(HeapObject *object)
+    SWIFT_CC(RegisterPreservingCC_IMPL) {
+  SWIFT_RT_ENTRY_REF(swift_nonatomic_retain)(object);
+}
+
+SWIFT_RT_ENTRY_IMPL_VISIBILITY
+extern "C"
+void SWIFT_RT_ENTRY_IMPL(swift_nonatomic_retain)(HeapObject *object)
+    SWIFT_CC(RegisterPreservingCC_IMPL) {
+  if (object) {
+    object->refCount.incrementNonAtomic();
+  }
+}
+
+SWIFT_RT_ENTRY_VISIBILITY
+extern "C"
+void swift::swift_nonatomic_retain_n(HeapObject *object, uint32_t n)
+    SWIFT_CC(RegisterPreservingCC_IMPL) {
+  SWIFT_RT_ENTRY_REF(swift_nonatomic_retain_n)(object, n);
+}
+
+SWIFT_RT_ENTRY_IMPL_VISIBILITY
+extern "C"
+void SWIFT_RT_ENTRY_IMPL(swift_nonatomic_retain_n)(HeapObject *object,
+                                                   uint32_t n)
+    SWIFT_CC(RegisterPreservingCC_IMPL) {
+  if (object) {
+    object->refCount.incrementNonAtomic(n);
+  }
+}
+
+SWIFT_RT_ENTRY_VISIBILITY
+extern "C"
+void swift::swift_nonatomic_release(HeapObject *object)
+    SWIFT_CC(RegisterPreservingCC_IMPL) {
+  SWIFT_RT_ENTRY_REF(swift_nonatomic_release)(object);
+}
+
+SWIFT_RT_ENTRY_IMPL_VISIBILITY
+extern "C"
+void SWIFT_RT_ENTRY_IMPL(swift_nonatomic_release)(HeapObject *object)
+    SWIFT_CC(RegisterPreservingCC_IMPL) {
+  if (object && object->refCount.decrementShouldDeallocateNonAtomic()) {
+    _swift_release_dealloc(object);
+  }
+}
+
+SWIFT_RT_ENTRY_VISIBILITY
+extern "C"
+void swift::swift_nonatomic_release_n(HeapObject *object, uint32_t n)
+    SWIFT_CC(RegisterPreservingCC_IMPL) {
+  SWIFT_RT_ENTRY_REF(swift_nonatomic_release_n)(object, n);
+}
+
+SWIFT_RT_ENTRY_IMPL_VISIBILITY
+extern "C"
+void SWIFT_RT_ENTRY_IMPL(swift_nonatomic_release_n)(HeapObject *object,
+                                                    uint32_t n)
+    SWIFT_CC(RegisterPreservingCC_IMPL) {
+  if (object && object->refCount.decrementShouldDeallocateNNonAtomic(n)) {
+    _swift_release_dealloc(object);
+  }
+}
+
 void swift::swift_setDeallocating(HeapObject *object) {
   object->refCount.decrementFromOneAndDeallocateNonAtomic();
 }
@@ -607,6 +681,154 @@ static inline void memset_pattern8(void *b, const void *pattern8, size_t len) {
 }
 #endif
 
+/*****************************************************************************/
+/*************************** WEAK REFERENCE TABLES ***************************/
+/*****************************************************************************/
+
+// Weak references do not keep their referent's memory alive. Instead, the
+// first time an object is weakly referenced, it gets a side table that all
+// weak references to it point to. When the object is deallocated, the side
+// table forgets it, so its memory can be freed right away; only the side
+// table lives on until the last weak reference to it is destroyed or found
+// to be dead.
+//
+// Objects cannot point to their side table, since there is no room in the
+// object header, so the side tables of live objects are found through a
+// global map. Only forming a weak reference from a strong one and
+// deallocating a weakly referenced object need to consult it. The weak
+// reference count's flag bit records whether an object has a side table, so
+// deallocating other objects never looks at the map.
+
+namespace {
+
+class WeakReferenceSideTable {
+  /// The referent, or null once it has been deallocated.
+  std::atomic<HeapObject *> Referent;
+
+  /// The number of weak loads that are currently trying to retain the
+  /// referent. Deallocation waits for these to finish before it frees the
+  /// referent's memory.
+  std::atomic<uint32_t> Readers;
+
+  /// One reference for each weak reference, plus one for the referent until
+  /// it is deallocated.
+  std::atomic<uint32_t> RefCount;
+
+public:
+  explicit WeakReferenceSideTable(HeapObject *referent)
+    : Referent(referent), Readers(0), RefCount(1) {}
+
+  void retain() {
+    RefCount.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  void release() {
+    if (RefCount.fetch_sub(1, std::memory_order_acq_rel) == 1)
+      delete this;
+  }
+
+  /// Return true if the referent has been deallocated. A false result is
+  /// only a hint, since the referent may be deallocated at any time.
+  bool isReferentDead() const {
+    return Referent.load(std::memory_order_relaxed) == nullptr;
+  }
+
+  /// Retain the referent unless it is being or has been deallocated.
+  HeapObject *tryRetainReferent() {
+    if (isReferentDead())
+      return nullptr;
+
+    // Announce ourselves before looking at the referent. Deallocation clears
+    // the referent before checking for readers, so either we see it cleared
+    // or it sees us and waits until we are done touching the object.
+    Readers.fetch_add(1, std::memory_order_seq_cst);
+    HeapObject *result = Referent.load(std::memory_order_seq_cst);
+    if (result)
+      result = swift_tryRetain(result);
+    Readers.fetch_sub(1, std::memory_order_release);
+    return result;
+  }
+
+  /// Forget the referent, which is being deallocated, and drop its reference
+  /// to the table.
+  void detachReferent() {
+    Referent.store(nullptr, std::memory_order_seq_cst);
+    while (Readers.load(std::memory_order_seq_cst) != 0)
+      sched_yield();
+    release();
+  }
+};
+
+/// The side tables of live objects, sharded by object address to keep
+/// unrelated objects from contending on the same lock.
+class WeakReferenceSideTableMap {
+  static constexpr unsigned NumShards = 64;
+
+  struct Shard {
+    std::mutex Lock;
+    llvm::DenseMap<HeapObject *, WeakReferenceSideTable *> Tables;
+  };
+
+  Shard Shards[NumShards];
+
+  Shard &getShard(HeapObject *object) {
+    return Shards[(reinterpret_cast<uintptr_t>(object) >> 4) % NumShards];
+  }
+
+public:
+  /// Return the side table of a live object, creating it if necessary, with
+  /// an additional reference for the caller.
+  WeakReferenceSideTable *retainSideTable(HeapObject *object) {
+    auto &shard = getShard(object);
+    std::lock_guard<std::mutex> guard(shard.Lock);
+    auto &table = shard.Tables[object];
+    if (!table) {
+      table = new WeakReferenceSideTable(object);
+      object->weakRefCount.setHasSideTable();
+    }
+    table->retain();
+    return table;
+  }
+
+  /// Detach the side table from an object that is being deallocated.
+  void detachSideTable(HeapObject *object) {
+    WeakReferenceSideTable *table;
+    {
+      auto &shard = getShard(object);
+      std::lock_guard<std::mutex> guard(shard.Lock);
+      auto found = shard.Tables.find(object);
+      assert(found != shard.Tables.end() && "object has no side table");
+      table = found->second;
+      shard.Tables.erase(found);
+    }
+    table->detachReferent();
+  }
+};
+
+} // end anonymous namespace
+
+static Lazy<WeakReferenceSideTableMap> WeakReferenceSideTables;
+
+static WeakReferenceSideTable *getSideTable(const WeakReference *ref) {
+  assert((!ref->Value || ref->isNative()) && "not a native weak reference");
+  return reinterpret_cast<WeakReferenceSideTable *>(
+           reinterpret_cast<uintptr_t>(ref->Value) &
+           ~uintptr_t(WeakReference::NativeTagMask));
+}
+
+static void setSideTable(WeakReference *ref, WeakReferenceSideTable *table) {
+  ref->Value = table ? reinterpret_cast<void *>(
+                         reinterpret_cast<uintptr_t>(table) |
+                         WeakReference::NativeTag)
+                     : nullptr;
+}
+
+static WeakReferenceSideTable *retainSideTableForObject(HeapObject *object) {
+  if (!object)
+    return nullptr;
+  return WeakReferenceSideTables->retainSideTable(object);
+}
+
 SWIFT_RT_ENTRY_VISIBILITY
 void swift::swift_deallocObject(HeapObject *object,
                                 size_t allocatedSize,
@@ -623,6 +845,11 @@ void swift::swift_deallocObject(HeapObject *object,
   // If we are tracking leaks, stop tracking this object.
   SWIFT_LEAKS_STOP_TRACKING_OBJECT(object);
 
+  // Weak references to the object must not see it anymore once its memory
+  // may be reused.
+  if (object->weakRefCount.hasSideTable())
+    WeakReferenceSideTables->detachSideTable(object);
+
   // Drop the initial weak retain of the object.
   //
   // If the outstanding weak retain count is 1 (i.e. only the initial
@@ -698,26 +925,26 @@ void swift::swift_deallocObject(HeapObject *object,
 }
 
 void swift::swift_weakInit(WeakReference *ref, HeapObject *value) {
-  ref->Value = value;
-  SWIFT_RT_ENTRY_CALL(swift_unownedRetain)(value);
+  setSideTable(ref, retainSideTableForObject(value));
 }
 
 void swift::swift_weakAssign(WeakReference *ref, HeapObject *newValue) {
-  SWIFT_RT_ENTRY_CALL(swift_unownedRetain)(newValue);
-  auto oldValue = ref->Value;
-  ref->Value = newValue;
-  SWIFT_RT_ENTRY_CALL(swift_unownedRelease)(oldValue);
+  auto newTable = retainSideTableForObject(newValue);
+  auto oldTable = getSideTable(ref);
+  setSideTable(ref, newTable);
+  if (oldTable)
+    oldTable->release();
 }
 
 HeapObject *swift::swift_weakLoadStrong(WeakReference *ref) {
-  auto object = ref->Value;
-  if (object == nullptr) return nullptr;
-  if (object->refCount.isDeallocating()) {
-    SWIFT_RT_ENTRY_CALL(swift_unownedRelease)(object);
-    ref->Value = nullptr;
-    return nullptr;
-  }
-  return swift_tryRetain(object);
+  auto table = getSideTable(ref);
+  if (table == nullptr) return nullptr;
+  if (auto result = table->tryRetainReferent())
+    return result;
+  // The referent is dead; let go of its side table early.
+  ref->Value = nullptr;
+  table->release();
+  return nullptr;
 }
 
 HeapObject *swift::swift_weakTakeStrong(WeakReference *ref) {
@@ -727,44 +954,45 @@ HeapObject *swift::swift_weakTakeStrong(WeakReference *ref) {
 }
 
 void swift::swift_weakDestroy(WeakReference *ref) {
-  auto tmp = ref->Value;
+  auto table = getSideTable(ref);
   ref->Value = nullptr;
-  SWIFT_RT_ENTRY_CALL(swift_unownedRelease)(tmp);
+  if (table)
+    table->release();
 }
 
 void swift::swift_weakCopyInit(WeakReference *dest, WeakReference *src) {
-  auto object = src->Value;
-  if (object == nullptr) {
+  auto table = getSideTable(src);
+  if (table == nullptr) {
     dest->Value = nullptr;
-  } else if (object->refCount.isDeallocating()) {
+  } else if (table->isReferentDead()) {
     src->Value = nullptr;
     dest->Value = nullptr;
-    SWIFT_RT_ENTRY_CALL(swift_unownedRelease)(object);
+    table->release();
   } else {
-    dest->Value = object;
-    SWIFT_RT_ENTRY_CALL(swift_unownedRetain)(object);
+    dest->Value = src->Value;
+    table->retain();
   }
 }
 
 void swift::swift_weakTakeInit(WeakReference *dest, WeakReference *src) {
-  auto object = src->Value;
-  dest->Value = object;
-  if (object != nullptr && object->refCount.isDeallocating()) {
+  auto table = getSideTable(src);
+  dest->Value = src->Value;
+  if (table != nullptr && table->isReferentDead()) {
     dest->Value = nullptr;
-    SWIFT_RT_ENTRY_CALL(swift_unownedRelease)(object);
+    table->release();
   }
 }
 
 void swift::swift_weakCopyAssign(WeakReference *dest, WeakReference *src) {
-  if (auto object = dest->Value) {
-    SWIFT_RT_ENTRY_CALL(swift_unownedRelease)(object);
+  if (auto table = getSideTable(dest)) {
+    table->release();
   }
   swift_weakCopyInit(dest, src);
 }
 
 void swift::swift_weakTakeAssign(WeakReference *dest, WeakReference *src) {
-  if (auto object = dest->Value) {
-    SWIFT_RT_ENTRY_CALL(swift_unownedRelease)(object);
+  if (auto table = getSideTable(dest)) {
+    table->release();
   }
   swift_weakTakeInit(dest, src);
 }
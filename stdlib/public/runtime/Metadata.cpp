@@ -25,8 +25,10 @@
 #include "MetadataCache.h"
 #include <algorithm>
 #include <condition_variable>
+#include <mutex>
 #include <new>
 #include <cctype>
+#include <cstdlib>
 #include <sys/mman.h>
 #include <pthread.h>
 #include <unistd.h>
@@ -92,6 +94,69 @@ void *MetadataAllocator::alloc(size_t size) {
   return addr;
 }
 
+namespace {
+  /// Threads waiting for metadata cache entries to be initialized, hashed
+  /// by entry address into buckets.  Each parked thread has its own
+  /// condition variable, so publishing an entry wakes exactly the threads
+  /// waiting for it.
+  class MetadataCacheParkingLot {
+  public:
+    struct ParkedThread {
+      const void *Address;
+      bool Unparked = false;
+      std::condition_variable Cond;
+      ParkedThread *Next;
+    };
+
+    struct Bucket {
+      std::mutex Lock;
+      ParkedThread *Head = nullptr;
+    };
+
+  private:
+    static constexpr unsigned NumBuckets = 64;
+    Bucket Buckets[NumBuckets];
+
+  public:
+    Bucket &getBucket(const void *address) {
+      auto bits = reinterpret_cast<uintptr_t>(address);
+      return Buckets[(bits ^ (bits >> 12)) / alignof(void*) % NumBuckets];
+    }
+  };
+} // end anonymous namespace
+
+static Lazy<MetadataCacheParkingLot> MetadataCacheWaiters;
+
+void swift::parkMetadataCacheWaiter(const void *address,
+                                    llvm::function_ref<bool()> isReady) {
+  auto &bucket = MetadataCacheWaiters->getBucket(address);
+  std::unique_lock<std::mutex> guard(bucket.Lock);
+  if (isReady())
+    return;
+
+  MetadataCacheParkingLot::ParkedThread self;
+  self.Address = address;
+  self.Next = bucket.Head;
+  bucket.Head = &self;
+  while (!self.Unparked)
+    self.Cond.wait(guard);
+}
+
+void swift::unparkMetadataCacheWaiters(const void *address) {
+  auto &bucket = MetadataCacheWaiters->getBucket(address);
+  std::lock_guard<std::mutex> guard(bucket.Lock);
+  auto link = &bucket.Head;
+  while (auto thread = *link) {
+    if (thread->Address != address) {
+      link = &thread->Next;
+      continue;
+    }
+    *link = thread->Next;
+    thread->Unparked = true;
+    thread->Cond.notify_one();
+  }
+}
+
 namespace {
   struct GenericCacheEntry;
 
@@ -105,6 +170,9 @@ namespace {
       : CacheEntry<GenericCacheEntry, GenericCacheEntryHeader> {
 
     static const char *getName() { return "GenericCache"; }
+    static MetadataCacheKind getStatisticsKind() {
+      return MetadataCacheKind::GenericCache;
+    }
 
     GenericCacheEntry(unsigned numArguments) {
       NumArguments = numArguments;
@@ -265,6 +333,41 @@ swift::swift_getResilientMetadata(GenericMetadata *pattern) {
   return entry->Value;
 }
 
+namespace {
+  /// A small direct-mapped cache, private to each thread, that sits in front
+  /// of the shared generic metadata caches. A hit compares the key in place;
+  /// it never hashes the full argument vector or touches shared memory.
+  ///
+  /// Generic metadata is never destroyed, so entries never go stale, and a
+  /// collision simply overwrites the previous occupant of the slot.
+  struct GenericMetadataLookasideCache {
+    static const unsigned NumEntries = 64;
+
+    /// Patterns with more key arguments than this bypass the cache.
+    static const unsigned MaxArguments = 4;
+
+    struct Entry {
+      GenericMetadata *Pattern;
+      const void *Arguments[MaxArguments];
+      const Metadata *Value;
+    };
+
+    Entry Entries[NumEntries];
+
+    static unsigned getIndex(GenericMetadata *pattern,
+                             const void * const *arguments,
+                             size_t numArguments) {
+      uintptr_t hash = uintptr_t(pattern) >> 4;
+      if (numArguments)
+        hash ^= uintptr_t(arguments[0]) >> 3;
+      hash ^= hash >> 7;
+      return hash & (NumEntries - 1);
+    }
+  };
+}
+
+static SWIFT_THREAD_LOCAL GenericMetadataLookasideCache LookasideCache;
+
 /// The primary entrypoint.
 SWIFT_RT_ENTRY_VISIBILITY
 const Metadata *
@@ -274,6 +377,23 @@ swift::swift_getGenericMetadata(GenericMetadata *pattern,
   auto genericArgs = (const void * const *) arguments;
   size_t numGenericArgs = pattern->NumKeyArguments;
 
+  // Try the per-thread lookaside cache first.
+  auto &lookaside = LookasideCache;
+  GenericMetadataLookasideCache::Entry *slot = nullptr;
+  if (numGenericArgs <= GenericMetadataLookasideCache::MaxArguments) {
+    slot = &lookaside.Entries[
+      GenericMetadataLookasideCache::getIndex(pattern, genericArgs,
+                                              numGenericArgs)];
+    if (slot->Pattern == pattern &&
+        std::equal(genericArgs, genericArgs + numGenericArgs,
+                   slot->Arguments)) {
+      countRuntimeStatistic(RuntimeStatistic::GenericMetadataLookasideHits);
+      return slot->Value;
+    }
+  }
+
+  countRuntimeStatistic(RuntimeStatistic::GenericMetadataLookasideMisses);
+
   auto entry = getCache(pattern).findOrAdd(genericArgs, numGenericArgs,
     [&]() -> GenericCacheEntry* {
       // Create new metadata to cache.
@@ -283,6 +403,14 @@ swift::swift_getGenericMetadata(GenericMetadata *pattern,
       return entry;
     });
 
+  // findOrAdd only returns fully initialized metadata, so it is safe to
+  // remember it for the next lookup on this thread.
+  if (slot) {
+    slot->Pattern = pattern;
+    std::copy(genericArgs, genericArgs + numGenericArgs, slot->Arguments);
+    slot->Value = entry->Value;
+  }
+
   return entry->Value;
 }
 
@@ -292,6 +420,9 @@ namespace {
 
   public:
     static const char *getName() { return "ObjCClassCache"; }
+    static MetadataCacheKind getStatisticsKind() {
+      return MetadataCacheKind::ObjCClassCache;
+    }
 
     ObjCClassCacheEntry(size_t numArguments) {}
 
@@ -356,6 +487,9 @@ namespace {
     FullMetadata<FunctionTypeMetadata> Metadata;
 
     static const char *getName() { return "FunctionCache"; }
+    static MetadataCacheKind getStatisticsKind() {
+      return MetadataCacheKind::FunctionCache;
+    }
 
     FunctionCacheEntry(size_t numArguments) {
       NumArguments = numArguments;
@@ -507,6 +641,9 @@ namespace {
     FullMetadata<TupleTypeMetadata> Metadata;
 
     static const char *getName() { return "TupleCache"; }
+    static MetadataCacheKind getStatisticsKind() {
+      return MetadataCacheKind::TupleCache;
+    }
 
     TupleCacheEntry(size_t numArguments) {
       NumArguments = numArguments;
@@ -1726,6 +1863,9 @@ namespace {
 
   public:
     static const char *getName() { return "MetatypeCache"; }
+    static MetadataCacheKind getStatisticsKind() {
+      return MetadataCacheKind::MetatypeCache;
+    }
 
     MetatypeCacheEntry(size_t numArguments) {}
 
@@ -1787,6 +1927,9 @@ namespace {
 
   public:
     static const char *getName() { return "ExistentialMetatypeCache"; }
+    static MetadataCacheKind getStatisticsKind() {
+      return MetadataCacheKind::ExistentialMetatypeCache;
+    }
 
     ExistentialMetatypeCacheEntry(size_t numArguments) {}
 
@@ -1909,6 +2052,9 @@ namespace {
     FullMetadata<ExistentialTypeMetadata> Metadata;
 
     static const char *getName() { return "ExistentialCache"; }
+    static MetadataCacheKind getStatisticsKind() {
+      return MetadataCacheKind::ExistentialCache;
+    }
 
     ExistentialCacheEntry(size_t numArguments) {
       Metadata.Protocols.NumProtocols = numArguments;
@@ -2479,6 +2625,9 @@ namespace {
   class WitnessTableCacheEntry : public CacheEntry<WitnessTableCacheEntry> {
   public:
     static const char *getName() { return "WitnessTableCache"; }
+    static MetadataCacheKind getStatisticsKind() {
+      return MetadataCacheKind::WitnessTableCache;
+    }
 
     WitnessTableCacheEntry(size_t numArguments) {
       assert(numArguments == getNumArguments());
@@ -16,8 +16,8 @@
 #include "llvm/ADT/STLExtras.h"
 #include "swift/Runtime/Concurrent.h"
 #include "swift/Runtime/Metadata.h"
-#include <mutex>
-#include <condition_variable>
+#include "RuntimeStatistics.h"
+#include <atomic>
 #include <thread>
 
 #ifndef SWIFT_DEBUG_RUNTIME
@@ -26,6 +26,18 @@
 
 namespace swift {
 
+/// Block the current thread until \p isReady returns true.
+///
+/// \p isReady is evaluated with the wait queue for \p address locked, so a
+/// thread that makes it true and then calls \c unparkMetadataCacheWaiters
+/// with the same address is guaranteed to wake this one.
+void parkMetadataCacheWaiter(const void *address,
+                             llvm::function_ref<bool()> isReady);
+
+/// Wake all threads parked on \p address.  Threads parked on other
+/// addresses are not disturbed.
+void unparkMetadataCacheWaiters(const void *address);
+
 // A wrapper around a pointer to a metadata cache entry that provides
 // DenseMap semantics that compare values in the key vector for the metadata
 // instance.
@@ -177,18 +189,26 @@ template <class ValueTy> class MetadataCache {
     size_t Hash;
     unsigned KeyLength;
 
-    /// Does this entry have a value, or is it currently undergoing
-    /// initialization?
-    ///
-    /// This (and the following field) is ever modified under the lock,
-    /// but it can be read from any thread, including while the lock
-    /// is held.
-    std::atomic<bool> HasValue;
-    union {
-      ValueTy *Value;
-      std::thread::id InitializingThread;
+    enum : uint8_t {
+      /// The entry is being initialized.
+      Initializing,
+      /// The entry is being initialized and some thread is waiting for it.
+      InitializingWithWaiters,
+      /// The entry has a value.
+      Initialized
     };
 
+    /// The initialization state of this entry.  Only the initializing
+    /// thread moves it to Initialized, after which it never changes.
+    std::atomic<uint8_t> State;
+
+    /// The value, once State is Initialized.
+    ValueTy *Value;
+
+    /// The thread that initializes this entry; used to diagnose cyclic
+    /// dependencies.
+    std::thread::id InitializingThread;
+
     const void **getKeyDataBuffer() {
       return reinterpret_cast<const void **>(this + 1);
     }
@@ -197,8 +217,8 @@ template <class ValueTy> class MetadataCache {
     }
   public:
     Entry(const Key &key)
-      : Hash(key.Hash), KeyLength(key.KeyData.size()), HasValue(false) {
-      InitializingThread = std::this_thread::get_id();
+      : Hash(key.Hash), KeyLength(key.KeyData.size()), State(Initializing),
+        Value(nullptr), InitializingThread(std::this_thread::get_id()) {
       memcpy(getKeyDataBuffer(), key.KeyData.begin(),
              KeyLength * sizeof(void*));
     }
@@ -215,6 +235,10 @@ template <class ValueTy> class MetadataCache {
       return Hash;
     }
 
+    static size_t getKeyHash(const Key &key) {
+      return key.Hash;
+    }
+
     static size_t getExtraAllocationSize(const Key &key) {
       return key.KeyData.size() * sizeof(void*);
     }
@@ -229,15 +253,33 @@ template <class ValueTy> class MetadataCache {
     }
 
     ValueTy *getValue() const {
-      if (HasValue.load(std::memory_order_acquire)) {
+      if (State.load(std::memory_order_acquire) == Initialized) {
         return Value;
       }
       return nullptr;
     }
 
+    /// Publish the value and wake any threads waiting for it.
     void setValue(ValueTy *value) {
       Value = value;
-      HasValue.store(true, std::memory_order_release);
+      if (State.exchange(Initialized, std::memory_order_acq_rel)
+            == InitializingWithWaiters)
+        unparkMetadataCacheWaiters(this);
+    }
+
+    /// Wait for another thread to publish the value.
+    ValueTy *waitForValue() {
+      // Let the initializing thread know that it has to wake us.
+      uint8_t state = Initializing;
+      if (!State.compare_exchange_strong(state, InitializingWithWaiters,
+                                         std::memory_order_acquire) &&
+          state == Initialized)
+        return Value;
+
+      parkMetadataCacheWaiter(this, [&] {
+        return State.load(std::memory_order_acquire) == Initialized;
+      });
+      return Value;
     }
   };
 
@@ -252,17 +294,11 @@ template <class ValueTy> class MetadataCache {
   /// structure for the metadata cache.
   const ValueTy *Head;
 
-  struct ConcurrencyControl {
-    std::mutex Lock;
-    std::condition_variable Queue;
-  };
-  std::unique_ptr<ConcurrencyControl> Concurrency;
-
   /// Allocator for entries of this cache.
   MetadataAllocator Allocator;
   
 public:
-  MetadataCache() : Concurrency(new ConcurrencyControl()) {}
+  MetadataCache() {}
   ~MetadataCache() {}
 
   /// Caches are not copyable.
@@ -303,34 +339,33 @@ public:
     if (!insertResult.second) {
 
       // If the entry is already initialized, great.
-      if (auto value = entry->getValue())
+      if (auto value = entry->getValue()) {
+        countMetadataCacheStatistic(ValueTy::getStatisticsKind(),
+                                    MetadataCacheStatistic::Hits);
         return value;
+      }
 
-      // Otherwise, we have to grab the lock and wait for the value to
-      // appear there.  Note that we have to check again immediately
-      // after acquiring the lock to prevent a race.
-      auto concurrency = Concurrency.get();
-      std::unique_lock<std::mutex> guard(concurrency->Lock);
-      while (true) {
-        if (auto value = entry->getValue())
-          return value;
-
-        // As a QoI safe-guard against the simplest form of cyclic
-        // dependency, check whether this thread is the one responsible
-        // for initializing the metadata.
-        if (entry->isBeingInitializedByCurrentThread()) {
-          fprintf(stderr,
-                  "%s(%p): cyclic metadata dependency detected, aborting\n",
-                  ValueTy::getName(), (void*) this);
-          abort();
-        }
-
-        concurrency->Queue.wait(guard);
+      // As a QoI safe-guard against the simplest form of cyclic
+      // dependency, check whether this thread is the one responsible
+      // for initializing the metadata.
+      if (entry->isBeingInitializedByCurrentThread()) {
+        fprintf(stderr,
+                "%s(%p): cyclic metadata dependency detected, aborting\n",
+                ValueTy::getName(), (void*) this);
+        abort();
       }
+
+      // Otherwise, wait for the value to appear there.  Only the
+      // initialization of this entry wakes us.
+      countMetadataCacheStatistic(ValueTy::getStatisticsKind(),
+                                  MetadataCacheStatistic::Waits);
+      return entry->waitForValue();
     }
 
     // Otherwise, we created the entry and are responsible for
     // creating the metadata.
+    countMetadataCacheStatistic(ValueTy::getStatisticsKind(),
+                                MetadataCacheStatistic::Instantiations);
     auto value = builder();
 
     // Update the linked list.
@@ -342,13 +377,8 @@ public:
                ValueTy::getName(), (void*) this, value);
 #endif
 
-    // Acquire the lock, set the value, and notify any waiters.
-    {
-      auto concurrency = Concurrency.get();
-      std::unique_lock<std::mutex> guard(concurrency->Lock);
-      entry->setValue(value);
-      concurrency->Queue.notify_all();
-    }
+    // Set the value and wake any threads waiting for this entry.
+    entry->setValue(value);
 
     return value;
   }
@@ -156,6 +156,11 @@ namespace swift {
   const Metadata *
   _searchConformancesByMangledTypeName(const llvm::StringRef typeName);
 
+  /// Returns a number that changes whenever new protocol conformances are
+  /// registered.  A negative conformance answer obtained under one
+  /// generation may be stale under a later one.
+  uintptr_t _swift_getProtocolConformanceGeneration();
+
 #if SWIFT_OBJC_INTEROP
   Demangle::NodePointer _swift_buildDemanglingForMetadata(const Metadata *type);
 #endif
@@ -18,7 +18,9 @@
 #include "swift/Basic/Lazy.h"
 #include "swift/Runtime/Concurrent.h"
 #include "swift/Runtime/Metadata.h"
+#include "llvm/ADT/Hashing.h"
 #include "Private.h"
+#include "RuntimeStatistics.h"
 
 #if defined(__APPLE__) && defined(__MACH__)
 #include <mach-o/dyld.h>
@@ -193,6 +195,10 @@ namespace {
       }
     }
 
+    static size_t getKeyHash(const ConformanceCacheKey &key) {
+      return llvm::hash_combine(key.Type, key.Proto);
+    }
+
     template <class... Args>
     static size_t getExtraAllocationSize(Args &&... ignored) {
       return 0;
@@ -207,7 +213,9 @@ namespace {
     }
 
     void updateFailureGeneration(uintptr_t failureGeneration) {
-      assert(!isSuccessful());
+      // A concurrent scan may already have found a conformance.
+      if (isSuccessful())
+        return;
       FailureGeneration.store(failureGeneration, std::memory_order_relaxed);
     }
     
@@ -223,6 +231,40 @@ namespace {
       return FailureGeneration.load(std::memory_order_relaxed);
     }
   };
+
+  /// A conformance record, tagged with the index of the section it was
+  /// registered in.
+  struct IndexedConformance {
+    const ProtocolConformanceRecord *Record;
+    uintptr_t SectionIndex;
+  };
+
+  /// All of the registered conformance records for one protocol.
+  struct ConformanceIndexEntry {
+  private:
+    const ProtocolDescriptor *Proto;
+
+  public:
+    /// The records, most recently registered first.
+    ConcurrentList<IndexedConformance> Records;
+
+    ConformanceIndexEntry(const ProtocolDescriptor *proto) : Proto(proto) {}
+
+    int compareWithKey(const ProtocolDescriptor *proto) const {
+      if (proto != Proto)
+        return (uintptr_t(proto) < uintptr_t(Proto) ? -1 : 1);
+      return 0;
+    }
+
+    static size_t getKeyHash(const ProtocolDescriptor *proto) {
+      return llvm::hash_value(proto);
+    }
+
+    template <class... Args>
+    static size_t getExtraAllocationSize(Args &&... ignored) {
+      return 0;
+    }
+  };
 }
 
 // Conformance Cache.
@@ -241,10 +283,22 @@ static void _addImageProtocolConformancesBlock(const uint8_t *conformances,
 
 struct ConformanceState {
   ConcurrentMap<ConformanceCacheEntry> Cache;
+
+  /// The registered conformance records, indexed by protocol.
+  ConcurrentMap<ConformanceIndexEntry> RecordsByProtocol;
+
+  /// The number of sections whose records have been fully indexed. Cached
+  /// failures are tagged with this value, so that they can be recognized as
+  /// stale once new sections are registered.
+  std::atomic<uintptr_t> IndexedSections;
+
+  /// Every registered section, in registration order. Only accessed with
+  /// SectionsToScanLock held; lookups by protocol use RecordsByProtocol and
+  /// take no lock.
   std::vector<ConformanceSection> SectionsToScan;
   pthread_mutex_t SectionsToScanLock;
   
-  ConformanceState() {
+  ConformanceState() : IndexedSections(0) {
     SectionsToScan.reserve(16);
     pthread_mutex_init(&SectionsToScanLock, nullptr);
 #if defined(__APPLE__) && defined(__MACH__)
@@ -267,8 +321,8 @@ struct ConformanceState {
     }
   }
 
-  void cacheFailure(const void *type, const ProtocolDescriptor *proto) {
-    uintptr_t failureGeneration = SectionsToScan.size();
+  void cacheFailure(const void *type, const ProtocolDescriptor *proto,
+                    uintptr_t failureGeneration) {
     auto result = Cache.getOrInsert(ConformanceCacheKey(type, proto),
                                     (const WitnessTable *) nullptr,
                                     failureGeneration);
@@ -283,6 +337,16 @@ struct ConformanceState {
                                     const ProtocolDescriptor *proto) {
     return Cache.find(ConformanceCacheKey(type, proto));
   }
+
+  uintptr_t getGeneration() const {
+    return IndexedSections.load(std::memory_order_acquire);
+  }
+
+  /// Returns the index entry listing every record for the given protocol,
+  /// or null if no record for it has been registered.
+  ConformanceIndexEntry *findRecords(const ProtocolDescriptor *proto) {
+    return RecordsByProtocol.find(proto);
+  }
 };
 
 static Lazy<ConformanceState> Conformances;
@@ -292,8 +356,29 @@ _registerProtocolConformances(ConformanceState &C,
                               const ProtocolConformanceRecord *begin,
                               const ProtocolConformanceRecord *end) {
   pthread_mutex_lock(&C.SectionsToScanLock);
+  uintptr_t sectionIndex = C.SectionsToScan.size();
   C.SectionsToScan.push_back(ConformanceSection{begin, end});
+
+  // Index the new records by protocol before publishing the new section
+  // count, so that a lookup that observes the count also observes them.
+  const ProtocolDescriptor *lastProto = nullptr;
+  ConformanceIndexEntry *lastEntry = nullptr;
+  for (const auto &record : C.SectionsToScan.back()) {
+    auto P = record.getProtocol();
+    // Records for the same protocol tend to be adjacent.
+    if (P != lastProto) {
+      lastProto = P;
+      lastEntry = C.RecordsByProtocol.getOrInsert(P).first;
+    }
+    lastEntry->Records.push_front(IndexedConformance{&record, sectionIndex});
+  }
+
+  C.IndexedSections.store(sectionIndex + 1, std::memory_order_release);
   pthread_mutex_unlock(&C.SectionsToScanLock);
+
+  countRuntimeStatistic(RuntimeStatistic::ConformanceSectionsRegistered);
+  countRuntimeStatistic(RuntimeStatistic::ConformanceRecordsRegistered,
+                        end - begin);
 }
 
 static void _addImageProtocolConformancesBlock(const uint8_t *conformances,
@@ -427,10 +512,6 @@ void swift::_swift_initializeCallbacksToInspectDylib(
 # error No known mechanism to inspect dynamic libraries on this platform.
 #endif
 
-// This variable is used to signal when a cache was generated and
-// it is correct to avoid a new scan.
-static unsigned ConformanceCacheGeneration = 0;
-
 void
 swift::swift_registerProtocolConformances(const ProtocolConformanceRecord *begin,
                                           const ProtocolConformanceRecord *end){
@@ -468,7 +549,7 @@ recur_inside_cache_lock:
         foundEntry = Value;
 
       // If we got a cached negative response, check the generation number.
-      if (Value->getFailureGeneration() == C.SectionsToScan.size()) {
+      if (Value->getFailureGeneration() == C.getGeneration()) {
         // We found an entry with a negative value.
         return std::make_pair(nullptr, true);
       }
@@ -544,14 +625,15 @@ swift::swift_conformsToProtocol(const Metadata *type,
                                 const ProtocolDescriptor *protocol) {
   auto &C = Conformances.get();
   auto origType = type;
-  unsigned numSections = 0;
+  // The generation that our last scan covered, if we have done one.
+  uintptr_t scannedGeneration = ~uintptr_t(0);
   ConformanceCacheEntry *foundEntry;
 
+  countRuntimeStatistic(RuntimeStatistic::ConformanceLookups);
+
 recur:
   // See if we have a cached conformance. The ConcurrentMap data structure
   // allows us to insert and search the map concurrently without locking.
-  // We do lock the slow path because the SectionsToScan data structure is not
-  // concurrent.
   auto FoundConformance = searchInConformanceCache(type, protocol, foundEntry);
   // The negative answer does not always mean that there is no conformance,
   // unless it is an exact match on the type. If it is not an exact match,
@@ -562,49 +644,42 @@ recur:
       return FoundConformance.first;
   }
 
-  unsigned failedGeneration = ConformanceCacheGeneration;
-
-  // If we didn't have an up-to-date cache entry, scan the conformance records.
-  pthread_mutex_lock(&C.SectionsToScanLock);
+  // Only count the first pass; the second one re-reads what the scan cached.
+  if (scannedGeneration == ~uintptr_t(0))
+    countRuntimeStatistic(RuntimeStatistic::ConformanceCacheMisses);
 
-  // If we have no new information to pull in (and nobody else pulled in
-  // new information while we waited on the lock), we're done.
-  if (C.SectionsToScan.size() == numSections) {
-    if (failedGeneration != ConformanceCacheGeneration) {
-      // Someone else pulled in new conformances while we were waiting.
-      // Start over with our newly-populated cache.
-      pthread_mutex_unlock(&C.SectionsToScanLock);
-      type = origType;
-      goto recur;
-    }
+  // Anything registered up to this generation is visible in the index.
+  uintptr_t generation = C.getGeneration();
 
-
-    // Save the failure for this type-protocol pair in the cache.
-    C.cacheFailure(type, protocol);
-
-    pthread_mutex_unlock(&C.SectionsToScanLock);
+  // If we have no new information to pull in, we're done. Save the failure
+  // for this type-protocol pair in the cache.
+  if (generation == scannedGeneration) {
+    C.cacheFailure(type, protocol, generation);
     return nullptr;
   }
 
-  // Update the last known number of sections to scan.
-  numSections = C.SectionsToScan.size();
-
-  // Scan only sections that were not scanned yet.
-  unsigned sectionIdx = foundEntry ? foundEntry->getFailureGeneration() : 0;
-  unsigned endSectionIdx = C.SectionsToScan.size();
+  // Scan only records for this protocol from sections that were not scanned
+  // yet. The index lists the most recently registered records first.
+  uintptr_t firstSectionIdx =
+    foundEntry ? foundEntry->getFailureGeneration() : 0;
+
+  countRuntimeStatistic(RuntimeStatistic::ConformanceScans);
+  uint64_t recordsScanned = 0;
+  if (auto indexEntry = C.findRecords(protocol)) {
+    for (const auto &indexed : indexEntry->Records) {
+      // Records from sections registered after we read the generation
+      // will be picked up by the next pass.
+      if (indexed.SectionIndex >= generation)
+        continue;
+      if (indexed.SectionIndex < firstSectionIdx)
+        break;
+      ++recordsScanned;
 
-  for (; sectionIdx < endSectionIdx; ++sectionIdx) {
-    auto &section = C.SectionsToScan[sectionIdx];
-    // Eagerly pull records for nondependent witnesses into our cache.
-    for (const auto &record : section) {
+      const auto &record = *indexed.Record;
       // If the record applies to a specific type, cache it.
       if (auto metadata = record.getCanonicalTypeMetadata()) {
         auto P = record.getProtocol();
 
-        // Look for an exact match.
-        if (protocol != P)
-          continue;
-
         if (!isRelatedType(type, metadata, /*isMetadata=*/true))
           continue;
 
@@ -613,7 +688,7 @@ recur:
         if (witness) {
           C.cacheSuccess(metadata, P, witness);
         } else {
-          C.cacheFailure(metadata, P);
+          C.cacheFailure(metadata, P, generation);
         }
 
       // If the record provides a nondependent witness table for all instances
@@ -629,10 +704,6 @@ recur:
         auto R = record.getNominalTypeDescriptor();
         auto P = record.getProtocol();
 
-        // Look for an exact match.
-        if (protocol != P)
-          continue;
-
         if (!isRelatedType(type, R, /*isMetadata=*/false))
           continue;
 
@@ -641,14 +712,19 @@ recur:
       }
     }
   }
-  ++ConformanceCacheGeneration;
+  countRuntimeStatistic(RuntimeStatistic::ConformanceRecordsScanned,
+                        recordsScanned);
+  scannedGeneration = generation;
 
-  pthread_mutex_unlock(&C.SectionsToScanLock);
   // Start over with our newly-populated cache.
   type = origType;
   goto recur;
 }
 
+uintptr_t swift::_swift_getProtocolConformanceGeneration() {
+  return Conformances.get().getGeneration();
+}
+
 const Metadata *
 swift::_searchConformancesByMangledTypeName(const llvm::StringRef typeName) {
   auto &C = Conformances.get();
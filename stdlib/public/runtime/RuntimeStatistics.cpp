@@ -0,0 +1,179 @@
+//===--- RuntimeStatistics.cpp - Runtime statistics counters --------------===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2016 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+//
+// Keeps the per-thread blocks of runtime statistics and prints their totals.
+//
+//===----------------------------------------------------------------------===//
+
+#include "RuntimeStatistics.h"
+#include "swift/Basic/Lazy.h"
+#include "swift/Runtime/Debug.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <pthread.h>
+
+using namespace swift;
+
+SWIFT_THREAD_LOCAL RuntimeStatisticsBlock *swift::CurrentRuntimeStatistics;
+
+namespace {
+  /// All the blocks ever handed out.
+  struct RuntimeStatisticsRegistry {
+    std::atomic<RuntimeStatisticsBlock *> Head;
+
+    /// Gives back the block of an exiting thread.
+    pthread_key_t ThreadExitKey;
+
+    RuntimeStatisticsRegistry() : Head(nullptr) {
+      pthread_key_create(&ThreadExitKey, releaseBlock);
+
+      // Print the statistics at exit if the
+      // SWIFT_RUNTIME_DUMP_STATISTICS environment variable is set.
+      if (getenv("SWIFT_RUNTIME_DUMP_STATISTICS"))
+        atexit(swift_runtime_dumpStatistics);
+    }
+
+    static void releaseBlock(void *block) {
+      // The thread may still run code that counts after this; it would
+      // simply claim a block again.
+      CurrentRuntimeStatistics = nullptr;
+      static_cast<RuntimeStatisticsBlock *>(block)
+        ->InUse.store(false, std::memory_order_release);
+    }
+
+    RuntimeStatisticsBlock *claim() {
+      // Reuse the block of a thread that has exited.
+      RuntimeStatisticsBlock *block = Head.load(std::memory_order_acquire);
+      for (; block; block = block->Next) {
+        bool inUse = false;
+        if (!block->InUse.load(std::memory_order_relaxed) &&
+            block->InUse.compare_exchange_strong(inUse, true,
+                                                 std::memory_order_acquire))
+          break;
+      }
+
+      if (!block) {
+        block = static_cast<RuntimeStatisticsBlock *>(
+          calloc(1, sizeof(RuntimeStatisticsBlock)));
+        if (!block)
+          crash("Could not allocate runtime statistics");
+        block->InUse.store(true, std::memory_order_relaxed);
+        auto head = Head.load(std::memory_order_relaxed);
+        do {
+          block->Next = head;
+        } while (!Head.compare_exchange_weak(head, block,
+                                             std::memory_order_release,
+                                             std::memory_order_relaxed));
+      }
+
+      pthread_setspecific(ThreadExitKey, block);
+      return block;
+    }
+
+    /// Sum the counts of all blocks, including the ones that live threads
+    /// are writing.
+    void sum(uint64_t (&counts)[NumRuntimeStatistics],
+             uint64_t (&metadataCacheCounts)[NumMetadataCacheKinds][
+               unsigned(MetadataCacheStatistic::Last_MetadataCacheStatistic)
+                 + 1]) {
+      memset(counts, 0, sizeof(counts));
+      memset(metadataCacheCounts, 0, sizeof(metadataCacheCounts));
+      for (auto block = Head.load(std::memory_order_acquire); block;
+           block = block->Next) {
+        for (unsigned i = 0; i != NumRuntimeStatistics; ++i)
+          counts[i] += block->Counts[i].load(std::memory_order_relaxed);
+        for (unsigned i = 0; i != NumMetadataCacheKinds; ++i)
+          for (unsigned j = 0;
+               j <= unsigned(MetadataCacheStatistic::Last_MetadataCacheStatistic);
+               ++j)
+            metadataCacheCounts[i][j] +=
+              block->MetadataCacheCounts[i][j].load(std::memory_order_relaxed);
+      }
+    }
+  };
+}
+
+static Lazy<RuntimeStatisticsRegistry> RuntimeStatisticsBlocks;
+
+RuntimeStatisticsBlock *swift::claimRuntimeStatisticsBlock() {
+  auto block = RuntimeStatisticsBlocks->claim();
+  CurrentRuntimeStatistics = block;
+  return block;
+}
+
+static const char * const MetadataCacheNames[] = {
+#define METADATA_CACHE(Name) #Name,
+#include "RuntimeStatistics.def"
+};
+
+static const char * const RuntimeStatisticDescriptions[] = {
+#define RUNTIME_STATISTIC(Name, Description) Description,
+#include "RuntimeStatistics.def"
+};
+
+static const char * const RuntimeStatisticNames[] = {
+#define RUNTIME_STATISTIC(Name, Description) #Name,
+#include "RuntimeStatistics.def"
+};
+
+static const char * const MetadataCacheStatisticNames[] = {
+  "Hits", "Instantiations", "Waits"
+};
+
+uint64_t swift::_swift_getRuntimeStatistic(const char *name) {
+  uint64_t counts[NumRuntimeStatistics];
+  uint64_t metadataCacheCounts[NumMetadataCacheKinds][
+    unsigned(MetadataCacheStatistic::Last_MetadataCacheStatistic) + 1];
+  RuntimeStatisticsBlocks->sum(counts, metadataCacheCounts);
+
+  for (unsigned i = 0; i != NumRuntimeStatistics; ++i)
+    if (strcmp(name, RuntimeStatisticNames[i]) == 0)
+      return counts[i];
+
+  for (unsigned i = 0; i != NumMetadataCacheKinds; ++i) {
+    size_t cacheNameLength = strlen(MetadataCacheNames[i]);
+    if (strncmp(name, MetadataCacheNames[i], cacheNameLength) != 0 ||
+        name[cacheNameLength] != '.')
+      continue;
+    for (unsigned j = 0;
+         j <= unsigned(MetadataCacheStatistic::Last_MetadataCacheStatistic);
+         ++j)
+      if (strcmp(name + cacheNameLength + 1,
+                 MetadataCacheStatisticNames[j]) == 0)
+        return metadataCacheCounts[i][j];
+  }
+  return ~uint64_t(0);
+}
+
+void swift::swift_runtime_dumpStatistics() {
+  uint64_t counts[NumRuntimeStatistics];
+  uint64_t metadataCacheCounts[NumMetadataCacheKinds][
+    unsigned(MetadataCacheStatistic::Last_MetadataCacheStatistic) + 1];
+  RuntimeStatisticsBlocks->sum(counts, metadataCacheCounts);
+
+  fprintf(stderr, "Swift runtime statistics:\n");
+  fprintf(stderr, "  %-26s %14s %14s %14s\n",
+          "metadata cache", "hits", "instantiations", "waits");
+  for (unsigned i = 0; i != NumMetadataCacheKinds; ++i) {
+    auto &cacheCounts = metadataCacheCounts[i];
+    fprintf(stderr, "  %-26s %14llu %14llu %14llu\n", MetadataCacheNames[i],
+      (unsigned long long) cacheCounts[unsigned(MetadataCacheStatistic::Hits)],
+      (unsigned long long)
+        cacheCounts[unsigned(MetadataCacheStatistic::Instantiations)],
+      (unsigned long long)
+        cacheCounts[unsigned(MetadataCacheStatistic::Waits)]);
+  }
+  for (unsigned i = 0; i != NumRuntimeStatistics; ++i)
+    fprintf(stderr, "  %-50s %14llu\n", RuntimeStatisticDescriptions[i],
+            (unsigned long long) counts[i]);
+}
@@ -0,0 +1,117 @@
+//===--- RuntimeStatistics.h - Runtime statistics counters ------*- C++ -*-===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2016 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+//
+// Counters for the work done by the metadata caches, the conformance lookup
+// and dynamic casting.  Every thread counts into a block of its own, so
+// counting never writes to memory shared with another thread; the blocks are
+// only summed when the statistics are printed.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef SWIFT_RUNTIME_RUNTIMESTATISTICS_H
+#define SWIFT_RUNTIME_RUNTIMESTATISTICS_H
+
+#include "swift/Runtime/Config.h"
+#include "llvm/Support/Compiler.h"
+#include <atomic>
+#include <cstdint>
+
+namespace swift {
+
+enum class RuntimeStatistic : unsigned {
+#define RUNTIME_STATISTIC(Name, Description) Name,
+#include "RuntimeStatistics.def"
+};
+
+enum : unsigned {
+  NumRuntimeStatistics = 0
+#define RUNTIME_STATISTIC(Name, Description) + 1
+#include "RuntimeStatistics.def"
+};
+
+enum class MetadataCacheKind : unsigned {
+#define METADATA_CACHE(Name) Name,
+#include "RuntimeStatistics.def"
+};
+
+enum : unsigned {
+  NumMetadataCacheKinds = 0
+#define METADATA_CACHE(Name) + 1
+#include "RuntimeStatistics.def"
+};
+
+/// What is counted for every kind of metadata cache.
+enum class MetadataCacheStatistic : unsigned {
+  /// A lookup found the value already initialized.
+  Hits,
+  /// A lookup created the value.
+  Instantiations,
+  /// A lookup waited for another thread to create the value.
+  Waits,
+
+  Last_MetadataCacheStatistic = Waits
+};
+
+/// The counters of one thread.  A block is only written by the thread that
+/// owns it; once that thread exits, the block is handed to a new thread, so
+/// the counts it holds are never lost.
+struct RuntimeStatisticsBlock {
+  std::atomic<uint64_t> Counts[NumRuntimeStatistics];
+  std::atomic<uint64_t> MetadataCacheCounts[NumMetadataCacheKinds][
+    unsigned(MetadataCacheStatistic::Last_MetadataCacheStatistic) + 1];
+
+  /// Whether a live thread owns this block.
+  std::atomic<bool> InUse;
+
+  /// The next block in the list of all blocks.  Blocks are never freed.
+  RuntimeStatisticsBlock *Next;
+};
+
+/// The block of the current thread, or null if it has not counted anything
+/// yet.
+extern SWIFT_THREAD_LOCAL RuntimeStatisticsBlock *CurrentRuntimeStatistics;
+
+/// Give the current thread a block and return it.
+RuntimeStatisticsBlock *claimRuntimeStatisticsBlock();
+
+static inline RuntimeStatisticsBlock *getRuntimeStatisticsBlock() {
+  auto block = CurrentRuntimeStatistics;
+  if (LLVM_UNLIKELY(!block))
+    block = claimRuntimeStatisticsBlock();
+  return block;
+}
+
+/// Add to a counter of the current thread.  No other thread writes it, so a
+/// plain load and store suffice.
+static inline void bumpRuntimeStatistic(std::atomic<uint64_t> &counter,
+                                        uint64_t amount) {
+  counter.store(counter.load(std::memory_order_relaxed) + amount,
+                std::memory_order_relaxed);
+}
+
+static inline void countRuntimeStatistic(RuntimeStatistic statistic,
+                                         uint64_t amount = 1) {
+  bumpRuntimeStatistic(
+    getRuntimeStatisticsBlock()->Counts[unsigned(statistic)], amount);
+}
+
+static inline void countMetadataCacheStatistic(MetadataCacheKind kind,
+                                        MetadataCacheStatistic statistic) {
+  bumpRuntimeStatistic(
+    getRuntimeStatisticsBlock()->MetadataCacheCounts[unsigned(kind)]
+                                                    [unsigned(statistic)],
+    1);
+}
+
+} // end namespace swift
+
+#endif // SWIFT_RUNTIME_RUNTIMESTATISTICS_H
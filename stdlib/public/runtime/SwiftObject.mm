@@ -919,7 +919,8 @@ void swift::swift_unknownWeakAssign(WeakReference *addr, void *newValue) {
   if (isObjCTaggedPointerOrNull(oldValue))
     return doWeakInit(addr, newValue, newIsNative);
 
-  bool oldIsNative = usesNativeSwiftReferenceCounting_allocated(oldValue);
+  // Native weak references point to a side table, not to the object.
+  bool oldIsNative = addr->isNative();
 
   // If they're both native, we can use the native function.
   if (oldIsNative && newIsNative)
@@ -939,7 +940,7 @@ void *swift::swift_unknownWeakLoadStrong(WeakReference *addr) {
   void *value = addr->Value;
   if (isObjCTaggedPointerOrNull(value)) return value;
 
-  if (usesNativeSwiftReferenceCounting_allocated(value)) {
+  if (addr->isNative()) {
     return swift_weakLoadStrong(addr);
   } else {
     return (void*) objc_loadWeakRetained((id*) &addr->Value);
@@ -950,7 +951,7 @@ void *swift::swift_unknownWeakTakeStrong(WeakReference *addr) {
   void *value = addr->Value;
   if (isObjCTaggedPointerOrNull(value)) return value;
 
-  if (usesNativeSwiftReferenceCounting_allocated(value)) {
+  if (addr->isNative()) {
     return swift_weakTakeStrong(addr);
   } else {
     void *result = (void*) objc_loadWeakRetained((id*) &addr->Value);
@@ -962,7 +963,7 @@ void *swift::swift_unknownWeakTakeStrong(WeakReference *addr) {
 void swift::swift_unknownWeakDestroy(WeakReference *addr) {
   id object = (id) addr->Value;
   if (isObjCTaggedPointerOrNull(object)) return;
-  doWeakDestroy(addr, usesNativeSwiftReferenceCounting_allocated(object));
+  doWeakDestroy(addr, addr->isNative());
 }
 void swift::swift_unknownWeakCopyInit(WeakReference *dest, WeakReference *src) {
   id object = (id) src->Value;
@@ -970,7 +971,7 @@ void swift::swift_unknownWeakCopyInit(WeakReference *dest, WeakReference *src) {
     dest->Value = (HeapObject*) object;
     return;
   }
-  if (usesNativeSwiftReferenceCounting_allocated(object))
+  if (src->isNative())
     return swift_weakCopyInit(dest, src);
   objc_copyWeak((id*) &dest->Value, (id*) src);
 }
@@ -980,7 +981,7 @@ void swift::swift_unknownWeakTakeInit(WeakReference *dest, WeakReference *src) {
     dest->Value = (HeapObject*) object;
     return;
   }
-  if (usesNativeSwiftReferenceCounting_allocated(object))
+  if (src->isNative())
     return swift_weakTakeInit(dest, src);
   objc_moveWeak((id*) &dest->Value, (id*) &src->Value);
 }
@@ -16,6 +16,7 @@
 #include <stdio.h>
 #include <string.h>
 #include "../SwiftShims/LibcShims.h"
+#include "swift/Runtime/Heap.h"
 
 #if defined(__linux__)
 #include <bsd/stdlib.h>
@@ -52,22 +53,9 @@ __swift_ssize_t _swift_stdlib_write(int fd, const void *buf,
 
 int _swift_stdlib_close(int fd) { return close(fd); }
 
-#if defined(__APPLE__)
-#include <malloc/malloc.h>
-size_t _swift_stdlib_malloc_size(const void *ptr) { return malloc_size(ptr); }
-#elif defined(__GNU_LIBRARY__) || defined(__CYGWIN__)
-#include <malloc.h>
 size_t _swift_stdlib_malloc_size(const void *ptr) {
-  return malloc_usable_size(const_cast<void *>(ptr));
+  return _swift_slowAllocUsableSize(ptr);
 }
-#elif defined(__FreeBSD__)
-#include <malloc_np.h>
-size_t _swift_stdlib_malloc_size(const void *ptr) {
-  return malloc_usable_size(const_cast<void *>(ptr));
-}
-#else
-#error No malloc_size analog known for this platform/libc.
-#endif
 
 __swift_uint32_t _swift_stdlib_arc4random(void) { return arc4random(); }
 
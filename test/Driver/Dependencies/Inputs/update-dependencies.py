@@ -25,6 +25,9 @@
 #
 # If invoked in non-primary-file mode, it only creates the output file.
 #
+# In batch mode, with several primary files, the Nth output and the Nth
+# dependencies file belong to the Nth primary file, as in the real frontend.
+#
 # ----------------------------------------------------------------------------
 
 from __future__ import print_function
@@ -35,24 +38,26 @@ import sys
 
 assert sys.argv[1] == '-frontend'
 
-if '-primary-file' in sys.argv:
-    primaryFile = sys.argv[sys.argv.index('-primary-file') + 1]
-    depsFile = sys.argv[sys.argv.index(
-        '-emit-reference-dependencies-path') + 1]
 
-    # Replace the dependencies file with the input file.
-    shutil.copyfile(primaryFile, depsFile)
-else:
-    primaryFile = None
+def values_of(option):
+    return [sys.argv[i + 1] for i, arg in enumerate(sys.argv[:-1])
+            if arg == option]
 
-outputFile = sys.argv[sys.argv.index('-o') + 1]
+primaryFiles = values_of('-primary-file')
+depsFiles = values_of('-emit-reference-dependencies-path')
+outputFiles = values_of('-o')
+
+# Replace each dependencies file with its input file.
+for primaryFile, depsFile in zip(primaryFiles, depsFiles):
+    shutil.copyfile(primaryFile, depsFile)
 
-# Update the output file mtime, or create it if necessary.
-# From http://stackoverflow.com/a/1160227.
-with open(outputFile, 'a'):
-    os.utime(outputFile, None)
+for i, outputFile in enumerate(outputFiles):
+    # Update the output file mtime, or create it if necessary.
+    # From http://stackoverflow.com/a/1160227.
+    with open(outputFile, 'a'):
+        os.utime(outputFile, None)
 
-if primaryFile:
-    print("Handled", os.path.basename(primaryFile))
-else:
-    print("Produced", os.path.basename(outputFile))
+    if primaryFiles:
+        print("Handled", os.path.basename(primaryFiles[i]))
+    else:
+        print("Produced", os.path.basename(outputFile))
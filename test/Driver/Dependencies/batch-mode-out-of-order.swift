@@ -0,0 +1,27 @@
+// other ==> main ==> yet-another
+
+// In an incremental build, the jobs of a batch are queued in the order they
+// were found to be out of date: other.swift, then the files that depend on
+// it. Each output must still go to the file it was compiled from.
+
+// RUN: rm -rf %t && cp -r %S/Inputs/chained/ %t
+// RUN: touch -t 201401240005 %t/*
+
+// RUN: cd %t && %swiftc_driver -c -driver-use-frontend-path %S/Inputs/update-dependencies.py -output-file-map %t/output.json -incremental -driver-always-rebuild-dependents -enable-batch-mode ./main.swift ./other.swift ./yet-another.swift -module-name main -j1 -v 2>&1 | FileCheck -check-prefix=CHECK-FIRST %s
+
+// CHECK-FIRST-NOT: warning
+// CHECK-FIRST: Handled main.swift
+// CHECK-FIRST: Handled other.swift
+// CHECK-FIRST: Handled yet-another.swift
+
+// RUN: touch -t 201401240006 %t/other.swift
+// RUN: cd %t && %swiftc_driver -c -driver-use-frontend-path %S/Inputs/update-dependencies.py -output-file-map %t/output.json -incremental -driver-always-rebuild-dependents -enable-batch-mode ./main.swift ./other.swift ./yet-another.swift -module-name main -j1 -v 2>&1 | FileCheck -check-prefix=CHECK-SECOND %s
+
+// CHECK-SECOND: -primary-file ./main.swift -primary-file ./other.swift -primary-file ./yet-another.swift {{.*}}-o ./main.o -o ./other.o -o ./yet-another.o {{.*}}-emit-reference-dependencies-path ./main.swiftdeps -emit-reference-dependencies-path ./other.swiftdeps -emit-reference-dependencies-path ./yet-another.swiftdeps
+// CHECK-SECOND-DAG: Handled other.swift
+// CHECK-SECOND-DAG: Handled main.swift
+// CHECK-SECOND-DAG: Handled yet-another.swift
+
+// RUN: diff %t/main.swift %t/main.swiftdeps
+// RUN: diff %t/other.swift %t/other.swiftdeps
+// RUN: diff %t/yet-another.swift %t/yet-another.swiftdeps
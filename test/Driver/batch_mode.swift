@@ -0,0 +1,38 @@
+// RUN: rm -rf %t && mkdir %t
+// RUN: touch %t/a.swift %t/b.swift %t/c.swift %t/d.swift
+
+// RUN: %target-swiftc_driver -driver-skip-execution -v -enable-batch-mode -j2 -c %t/a.swift %t/b.swift %t/c.swift %t/d.swift -module-name main 2>&1 | FileCheck %s
+
+// CHECK: -frontend -c -primary-file {{.*}}/a.swift -primary-file {{.*}}/b.swift {{.*}}/c.swift {{.*}}/d.swift {{.*}}-o {{[^ ]*}}a{{[^ ]*}}.o -o {{[^ ]*}}b{{[^ ]*}}.o
+// CHECK-NEXT: -frontend -c {{.*}}/a.swift {{.*}}/b.swift -primary-file {{.*}}/c.swift -primary-file {{.*}}/d.swift {{.*}}-o {{[^ ]*}}c{{[^ ]*}}.o -o {{[^ ]*}}d{{[^ ]*}}.o
+// CHECK-NOT: -frontend
+
+// RUN: %target-swiftc_driver -driver-skip-execution -v -enable-batch-mode -j1 -c %t/a.swift %t/b.swift %t/c.swift %t/d.swift -module-name main 2>&1 | FileCheck -check-prefix=SINGLE %s
+
+// SINGLE: -frontend -c -primary-file {{.*}}/a.swift -primary-file {{.*}}/b.swift -primary-file {{.*}}/c.swift -primary-file {{.*}}/d.swift
+// SINGLE-NOT: -frontend
+
+// RUN: %target-swiftc_driver -driver-skip-execution -v -enable-batch-mode -j8 -c %t/a.swift %t/b.swift -module-name main 2>&1 | FileCheck -check-prefix=UNBATCHED %s
+// RUN: %target-swiftc_driver -driver-skip-execution -v -j2 -c %t/a.swift %t/b.swift -module-name main 2>&1 | FileCheck -check-prefix=UNBATCHED %s
+
+// UNBATCHED: -frontend -c -primary-file {{.*}}/a.swift {{.*}}/b.swift
+// UNBATCHED-NOT: -primary-file {{.*}} -primary-file
+// UNBATCHED-NEXT: -frontend -c {{.*}}/a.swift -primary-file {{.*}}/b.swift
+// UNBATCHED-NOT: -primary-file {{.*}} -primary-file
+
+// RUN: %target-swiftc_driver -driver-skip-execution -v -enable-batch-mode -j1 -c %t/a.swift %t/b.swift -module-name main -driver-use-filelists 2>&1 | FileCheck -check-prefix=FILELIST %s
+
+// FILELIST: -frontend -c -filelist {{[^ ]+}} -primary-file {{.*}}/a.swift -primary-file {{.*}}/b.swift
+
+// RUN: %target-swiftc_driver -driver-skip-execution -parseable-output -enable-batch-mode -j1 -c %t/a.swift %t/b.swift -module-name main 2>&1 | FileCheck -check-prefix=PARSEABLE %s
+
+// PARSEABLE: "kind": "began",
+// PARSEABLE: "pid": [[PID:[0-9]+]]
+// PARSEABLE: "kind": "began",
+// PARSEABLE: "pid": [[PID]]
+// PARSEABLE: "kind": "finished",
+// PARSEABLE: "pid": [[PID]]
+// PARSEABLE: "output": "Output placeholder\n"
+// PARSEABLE: "kind": "finished",
+// PARSEABLE: "pid": [[PID]]
+// PARSEABLE-NOT: "kind":
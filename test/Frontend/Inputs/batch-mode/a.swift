@@ -0,0 +1 @@
+func fromA() -> Int { return fromB() + 1 }
@@ -0,0 +1 @@
+func fromB() -> Int { return fromC() + 2 }
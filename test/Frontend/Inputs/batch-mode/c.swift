@@ -0,0 +1 @@
+func fromC() -> Int { return 3 }
@@ -0,0 +1,20 @@
+struct Counter {
+  var value: Int
+
+  var doubled: Int {
+    get { return value * 2 }
+    set { value = newValue / 2 }
+  }
+
+  init(start: Int) { value = start }
+
+  func next() -> Counter {
+    // A parse error, diagnosed only when this body is parsed.
+    let = value
+    return Counter(start: value + 1)
+  }
+}
+
+func makeCounter() -> Counter {
+  return Counter(start: 0)
+}
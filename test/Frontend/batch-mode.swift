@@ -0,0 +1,36 @@
+// RUN: rm -rf %t && mkdir %t
+
+// RUN: %target-swift-frontend -emit-ir -primary-file %S/Inputs/batch-mode/a.swift -primary-file %S/Inputs/batch-mode/b.swift %S/Inputs/batch-mode/c.swift -module-name main -o %t/a.ll -o %t/b.ll -emit-reference-dependencies-path %t/a.swiftdeps -emit-reference-dependencies-path %t/b.swiftdeps
+// RUN: FileCheck -check-prefix=CHECK-A %s < %t/a.ll
+// RUN: FileCheck -check-prefix=CHECK-B %s < %t/b.ll
+// RUN: FileCheck -check-prefix=CHECK-A-DEPS %s < %t/a.swiftdeps
+// RUN: FileCheck -check-prefix=CHECK-B-DEPS %s < %t/b.swiftdeps
+
+// CHECK-A: define {{.*}}@_TF4main5fromAFT_Si(
+// CHECK-A-NOT: define {{.*}}@_TF4main5fromBFT_Si(
+// CHECK-A-NOT: define {{.*}}@_TF4main5fromCFT_Si(
+
+// CHECK-B-NOT: define {{.*}}@_TF4main5fromAFT_Si(
+// CHECK-B: define {{.*}}@_TF4main5fromBFT_Si(
+// CHECK-B-NOT: define {{.*}}@_TF4main5fromCFT_Si(
+
+// CHECK-A-DEPS-LABEL: {{^provides-top-level:$}}
+// CHECK-A-DEPS-NEXT: - "fromA"
+// CHECK-A-DEPS-LABEL: {{^depends-top-level:$}}
+// CHECK-A-DEPS-DAG: - "fromB"
+// CHECK-A-DEPS-NOT: fromC
+
+// CHECK-B-DEPS-LABEL: {{^provides-top-level:$}}
+// CHECK-B-DEPS-NEXT: - "fromB"
+// CHECK-B-DEPS-LABEL: {{^depends-top-level:$}}
+// CHECK-B-DEPS-DAG: - "fromC"
+// CHECK-B-DEPS-NOT: fromA
+
+// RUN: not %target-swift-frontend -emit-ir -primary-file %S/Inputs/batch-mode/a.swift -primary-file %S/Inputs/batch-mode/b.swift %S/Inputs/batch-mode/c.swift -module-name main -o %t/a.ll 2>&1 | FileCheck -check-prefix=OUTPUT-COUNT %s
+// OUTPUT-COUNT: error: '-o' must be given once for each of the 2 primary files
+
+// RUN: not %target-swift-frontend -emit-ir -primary-file %S/Inputs/batch-mode/a.swift -primary-file %S/Inputs/batch-mode/b.swift %S/Inputs/batch-mode/c.swift -module-name main -o %t/a.ll -o %t/b.ll -emit-dependencies-path %t/a.d 2>&1 | FileCheck -check-prefix=DEPS-COUNT %s
+// DEPS-COUNT: error: '-emit-dependencies-path' must be given once for each of the 2 primary files
+
+// RUN: not %target-swift-frontend -emit-ir -primary-file %S/Inputs/batch-mode/a.swift -primary-file %S/Inputs/batch-mode/b.swift %S/Inputs/batch-mode/c.swift -module-name main -o %t/a.ll -o %t/b.ll -serialize-diagnostics-path %t/a.dia 2>&1 | FileCheck -check-prefix=UNSUPPORTED %s
+// UNSUPPORTED: error: '-serialize-diagnostics-path' is not supported with more than one primary file
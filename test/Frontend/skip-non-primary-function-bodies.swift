@@ -0,0 +1,15 @@
+// RUN: not %target-swift-frontend -emit-silgen -primary-file %s %S/Inputs/skip-non-primary-function-bodies/other.swift -module-name main 2>&1 | FileCheck -check-prefix=PARSED %s
+// PARSED: other.swift:{{[0-9]+}}:{{[0-9]+}}: error:
+
+// RUN: %target-swift-frontend -emit-silgen -primary-file %s %S/Inputs/skip-non-primary-function-bodies/other.swift -module-name main -skip-non-primary-function-bodies | FileCheck %s
+
+// Declarations from the other file are still available to the primary file.
+// CHECK-LABEL: sil hidden @_TF4main3useFT_Si
+// CHECK: function_ref @{{.*}}11makeCounter
+// CHECK: function_ref @{{.*}}4next
+// CHECK: function_ref @{{.*}}7doubled
+func use() -> Int {
+  return makeCounter().next().doubled
+}
+
+// CHECK-NOT: sil hidden @{{.*}}11makeCounter
@@ -45,21 +45,43 @@
 // RUN: echo "multi-threaded same compilation" >>%t/log
 // RUN: %target-swift-frontend -O -wmo -num-threads 2 %s %S/Inputs/simple.swift -module-name=test -c -o %t/test.o -o %t/simple.o -Xllvm -debug-only=irgen 2>>%t/log
 
+// With unchanged inputs, not even the IR is generated.
+
 // CHECK-LABEL: multi-threaded same compilation
-// CHECK-DAG: test.o: MD5=[[TEST4_MD5]]
-// CHECK-DAG: test.o: prev MD5=[[TEST4_MD5]] skipping
-// CHECK-DAG: simple.o: MD5=[[SIMPLE_MD5]]
-// CHECK-DAG: simple.o: prev MD5=[[SIMPLE_MD5]] skipping
+// CHECK-NOT: MD5=
+// CHECK: all object files are up to date
+// CHECK-NOT: MD5=
 
 // RUN: echo "multi-threaded one file changed" >>%t/log
 // RUN: %target-swift-frontend -O -wmo -num-threads 2 %s %S/Inputs/simple2.swift -module-name=test -c -o %t/test.o -o %t/simple.o -Xllvm -debug-only=irgen 2>>%t/log
 
+// Changing one file changes the inputs hash of the whole module, so the IR
+// of every file is generated again. Only LLVM is skipped for test.o.
+
 // CHECK-LABEL: multi-threaded one file changed
+// CHECK-NOT: all object files are up to date
 // CHECK-DAG: test.o: MD5=[[TEST4_MD5]]
 // CHECK-DAG: test.o: prev MD5=[[TEST4_MD5]] skipping
 // CHECK-DAG: simple.o: MD5=[[SIMPLE2_MD5:[0-9a-f]+]]
 // CHECK-DAG: simple.o: prev MD5=[[SIMPLE_MD5]] recompiling
 
+// The reused test.o now records the new inputs as well.
+
+// RUN: echo "multi-threaded same compilation after change" >>%t/log
+// RUN: %target-swift-frontend -O -wmo -num-threads 2 %s %S/Inputs/simple2.swift -module-name=test -c -o %t/test.o -o %t/simple.o -Xllvm -debug-only=irgen 2>>%t/log
+
+// CHECK-LABEL: multi-threaded same compilation after change
+// CHECK-NOT: MD5=
+// CHECK: all object files are up to date
+// CHECK-NOT: MD5=
+
+// RUN: echo "multi-threaded option changed" >>%t/log
+// RUN: %target-swift-frontend -O -wmo -num-threads 2 %s %S/Inputs/simple2.swift -module-name=test -c -o %t/test.o -o %t/simple.o -disable-llvm-optzns -Xllvm -debug-only=irgen 2>>%t/log
+
+// CHECK-LABEL: multi-threaded option changed
+// CHECK-NOT: all object files are up to date
+// CHECK: MD5=
+
 // RUN: FileCheck %s < %t/log
 
 // REQUIRES: asserts
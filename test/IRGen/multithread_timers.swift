@@ -0,0 +1,14 @@
+// RUN: rm -rf %t && mkdir -p %t
+
+// Every codegen thread reports how long it was busy.
+
+// RUN: %target-swift-frontend -c %S/Inputs/multithread_module/main.swift -o %t/main.o %s -o %t/mt_module.o -num-threads 3 -module-name test -debug-time-compilation 2>&1 | FileCheck %s
+
+// CHECK: Swift compilation
+// CHECK-DAG: LLVM codegen thread 0
+// CHECK-DAG: LLVM codegen thread 1
+// CHECK-DAG: LLVM codegen thread 2
+
+public func test_func1() {
+  print("Hello")
+}
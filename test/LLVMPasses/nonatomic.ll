@@ -0,0 +1,69 @@
+; RUN: %swift-llvm-opt -swift-llvm-arc-optimize %s | FileCheck %s
+; RUN: %swift-llvm-opt -swift-arc-contract %s | FileCheck %s --check-prefix=CONTRACT
+
+target datalayout = "e-p:64:64:64-S128-i1:8:8-i8:8:8-i16:16:16-i32:32:32-i64:64:64-f16:16:16-f32:32:32-f64:64:64-f128:128:128-v64:64:64-v128:128:128-a0:0:64-s0:64:64-f80:128:128-n8:16:32:64"
+target triple = "x86_64-apple-macosx10.9"
+
+%swift.refcounted = type { %swift.heapmetadata*, i64 }
+%swift.heapmetadata = type { i64 (%swift.refcounted*)*, i64 (%swift.refcounted*)* }
+
+declare void @rt_swift_retain(%swift.refcounted* ) nounwind
+declare void @rt_swift_release(%swift.refcounted* nocapture) nounwind
+declare void @rt_swift_nonatomic_retain(%swift.refcounted* ) nounwind
+declare void @rt_swift_nonatomic_release(%swift.refcounted* nocapture) nounwind
+declare void @noread_user(%swift.refcounted*) readnone
+declare void @user(%swift.refcounted*)
+
+; Non-atomic retains and releases pair up like atomic ones.
+
+; CHECK-LABEL: @trivial_nonatomic_retain_release(
+; CHECK-NEXT: entry:
+; CHECK-NEXT: call void @user
+; CHECK-NEXT: ret void
+define void @trivial_nonatomic_retain_release(%swift.refcounted* %P) {
+entry:
+  tail call void @rt_swift_nonatomic_retain(%swift.refcounted* %P)
+  tail call void @rt_swift_nonatomic_release(%swift.refcounted* %P) nounwind
+  call void @user(%swift.refcounted* %P) nounwind
+  ret void
+}
+
+; Merging non-atomic operations produces the non-atomic _n entry points.
+
+; CONTRACT-LABEL: define{{( protected)?}} void @contract_nonatomic(%swift.refcounted* %A) {
+; CONTRACT-NEXT: entry:
+; CONTRACT-NEXT: tail call void @rt_swift_nonatomic_retain_n(%swift.refcounted* %A, i32 2)
+; CONTRACT-NEXT: call void @noread_user(%swift.refcounted* %A)
+; CONTRACT-NEXT: call void @noread_user(%swift.refcounted* %A)
+; CONTRACT-NEXT: tail call void @rt_swift_nonatomic_release_n(%swift.refcounted* %A, i32 2)
+; CONTRACT-NEXT: ret void
+define void @contract_nonatomic(%swift.refcounted* %A) {
+entry:
+  tail call void @rt_swift_nonatomic_retain(%swift.refcounted* %A)
+  call void @noread_user(%swift.refcounted* %A)
+  tail call void @rt_swift_nonatomic_retain(%swift.refcounted* %A)
+  call void @noread_user(%swift.refcounted* %A)
+  tail call void @rt_swift_nonatomic_release(%swift.refcounted* %A)
+  tail call void @rt_swift_nonatomic_release(%swift.refcounted* %A)
+  ret void
+}
+
+; If any of the merged operations is atomic, the merged one must be too.
+
+; CONTRACT-LABEL: define{{( protected)?}} void @contract_mixed(%swift.refcounted* %A) {
+; CONTRACT-NEXT: entry:
+; CONTRACT-NEXT: tail call void @rt_swift_retain_n(%swift.refcounted* %A, i32 2)
+; CONTRACT-NEXT: call void @noread_user(%swift.refcounted* %A)
+; CONTRACT-NEXT: call void @noread_user(%swift.refcounted* %A)
+; CONTRACT-NEXT: tail call void @rt_swift_release_n(%swift.refcounted* %A, i32 2)
+; CONTRACT-NEXT: ret void
+define void @contract_mixed(%swift.refcounted* %A) {
+entry:
+  tail call void @rt_swift_nonatomic_retain(%swift.refcounted* %A)
+  call void @noread_user(%swift.refcounted* %A)
+  tail call void @rt_swift_retain(%swift.refcounted* %A)
+  call void @noread_user(%swift.refcounted* %A)
+  tail call void @rt_swift_release(%swift.refcounted* %A)
+  tail call void @rt_swift_nonatomic_release(%swift.refcounted* %A)
+  ret void
+}
@@ -0,0 +1,29 @@
+// RUN: rm -rf %t && mkdir -p %t
+// RUN: %target-swift-frontend -parse %s -debug-expression-stats-path %t/stats.json -debug-expression-stats-count 2
+// RUN: FileCheck %s < %t/stats.json
+
+// RUN: %target-parse-verify-swift -warn-long-expression-type-checking 1000000
+
+// Only the two most expensive expressions are listed.
+
+// CHECK: [
+// CHECK: {
+// CHECK:   "file": "{{.*}}expression_stats.swift",
+// CHECK:   "line": {{[0-9]+}},
+// CHECK:   "column": {{[0-9]+}},
+// CHECK:   "wall_time_ms": {{[0-9.e+-]+}},
+// CHECK:   "states_explored": {{[0-9]+}},
+// CHECK:   "disjunctions": {{[0-9]+}},
+// CHECK:   "disjunction_terms": {{[0-9]+}},
+// CHECK:   "type_variable_bindings": {{[0-9]+}},
+// CHECK:   "max_depth": {{[0-9]+}}
+// CHECK: },
+// CHECK: {
+// CHECK:   "file": "{{.*}}expression_stats.swift",
+// CHECK: }
+// CHECK-NEXT: ]
+
+let a = 1 + 2 * 3 - 4
+let b = [1, 2, 3].map { $0 * 2 }
+let c = "x" + "y"
+let d = Double(a) + 1.5
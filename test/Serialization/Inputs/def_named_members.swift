@@ -0,0 +1,40 @@
+public struct Point {
+  public var x: Int
+  public var y: Int
+
+  public init(x: Int, y: Int) {
+    self.x = x
+    self.y = y
+  }
+
+  public func scaled(by factor: Int) -> Point {
+    return Point(x: x * factor, y: y * factor)
+  }
+
+  public func scaled(by factor: Double) -> Point {
+    return Point(x: Int(Double(x) * factor), y: Int(Double(y) * factor))
+  }
+}
+
+extension Point {
+  public var sum: Int { return x + y }
+
+  public static func origin() -> Point {
+    return Point(x: 0, y: 0)
+  }
+}
+
+public class Shape {
+  public init() {}
+  public func area() -> Int { return 0 }
+}
+
+public class Square : Shape {
+  public var side: Int
+
+  public init(side: Int) {
+    self.side = side
+  }
+
+  public override func area() -> Int { return side * side }
+}
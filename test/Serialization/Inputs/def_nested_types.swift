@@ -0,0 +1,23 @@
+public enum Outer {
+  public enum Middle {
+    public struct Inner {
+      public init() {}
+    }
+  }
+
+  public struct Generic<T> {
+    public init() {}
+  }
+}
+
+extension Outer {
+  public struct InExtension {
+    public init() {}
+  }
+}
+
+extension Int {
+  public enum NestedInInt {
+    case value
+  }
+}
@@ -0,0 +1,6 @@
+import def_nested_types
+
+public func takesInner(x: Outer.Middle.Inner) {}
+public func takesGeneric(x: Outer.Generic<Int>) {}
+public func takesInExtension(x: Outer.InExtension) {}
+public func takesNestedInInt(x: Int.NestedInInt) {}
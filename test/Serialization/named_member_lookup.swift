@@ -0,0 +1,22 @@
+// RUN: rm -rf %t
+// RUN: mkdir %t
+// RUN: %target-swift-frontend -emit-module -o %t %S/Inputs/def_named_members.swift
+// RUN: %target-swift-frontend -parse -I %t %s -enable-named-lazy-member-loading
+// RUN: %target-swift-frontend -parse -I %t %s
+
+// Members of deserialized types are found when they are loaded one name at a
+// time, including overloads, members of extensions, and inherited members.
+
+import def_named_members
+
+let p = Point(x: 1, y: 2)
+let _: Int = p.x + p.y
+let _: Point = p.scaled(by: 2)
+let _: Point = p.scaled(by: 0.5)
+let _: Int = p.sum
+let _: Point = Point.origin()
+
+let s: Square = Square(side: 3)
+let _: Int = s.area()
+let _: Int = s.side
+let _: Shape = Shape()
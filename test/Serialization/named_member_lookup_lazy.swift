@@ -0,0 +1,27 @@
+// REQUIRES: asserts
+
+// RUN: rm -rf %t
+// RUN: mkdir %t
+// RUN: %target-swift-frontend -emit-module -o %t %S/Inputs/def_named_members.swift
+// RUN: %target-swift-frontend -parse -I %t %s -enable-named-lazy-member-loading -Xllvm -debug-only=serialization 2> %t/named.log
+// RUN: FileCheck %s < %t/named.log
+// RUN: FileCheck -check-prefix=NO-MEMBERS %s < %t/named.log
+// RUN: %target-swift-frontend -parse -I %t %s -Xllvm -debug-only=serialization 2> %t/all.log
+// RUN: FileCheck -check-prefix=ALL-MEMBERS %s < %t/all.log
+
+// With named lazy member loading, looking up members of Point loads only the
+// members with the names that are looked up, from the type and from its
+// extension. Without it, all members of Point are loaded.
+
+import def_named_members
+
+let p = Point(x: 1, y: 2)
+let _: Point = p.scaled(by: 2)
+let _: Int = p.sum
+
+// CHECK-DAG: loading members named scaled of Point
+// CHECK-DAG: loading members named sum of an extension
+
+// NO-MEMBERS-NOT: loading all members of Point
+
+// ALL-MEMBERS: loading all members of Point
@@ -0,0 +1,19 @@
+// RUN: rm -rf %t
+// RUN: mkdir %t
+// RUN: %target-swift-frontend -emit-module -o %t %S/Inputs/def_nested_types.swift
+// RUN: llvm-bcanalyzer %t/def_nested_types.swiftmodule | FileCheck %s
+// RUN: %target-swift-frontend -emit-module -o %t -I %t %S/Inputs/uses_nested_types.swift
+// RUN: %target-swift-frontend -emit-silgen -I %t %s > /dev/null
+
+// CHECK-NOT: UnknownCode
+
+// Cross-references to nested types, including types nested in extensions and
+// in types from other modules, resolve through the nested type table.
+
+import def_nested_types
+import uses_nested_types
+
+takesInner(Outer.Middle.Inner())
+takesGeneric(Outer.Generic<Int>())
+takesInExtension(Outer.InExtension())
+takesNestedInInt(.value)
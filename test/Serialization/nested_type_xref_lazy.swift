@@ -0,0 +1,25 @@
+// REQUIRES: asserts
+
+// RUN: rm -rf %t
+// RUN: mkdir %t
+// RUN: %target-swift-frontend -emit-module -o %t %S/Inputs/def_nested_types.swift
+// RUN: %target-swift-frontend -emit-module -o %t -I %t %S/Inputs/uses_nested_types.swift
+// RUN: %target-swift-frontend -parse -I %t %s -Xllvm -debug-only=serialization 2> %t/log
+// RUN: FileCheck %s < %t/log
+// RUN: FileCheck -check-prefix=NO-MEMBERS %s < %t/log
+
+// Resolving the cross-references in the signatures of these functions goes
+// through the nested type table, without loading the members of the types
+// that contain the nested types.
+
+import uses_nested_types
+
+let _ = takesInner
+let _ = takesInExtension
+
+// CHECK-DAG: found nested type Middle in Outer through the nested type table
+// CHECK-DAG: found nested type Inner in Middle through the nested type table
+// CHECK-DAG: found nested type InExtension in Outer through the nested type table
+
+// NO-MEMBERS-NOT: loading all members of Outer
+// NO-MEMBERS-NOT: loading all members of Middle
@@ -20,6 +20,7 @@
 #include "swift/Subsystems.h"
 #include "swift/AST/DiagnosticsFrontend.h"
 #include "swift/AST/DiagnosticsSema.h"
+#include "swift/AST/ExpressionStatsTracker.h"
 #include "swift/AST/IRGenOptions.h"
 #include "swift/AST/Mangle.h"
 #include "swift/AST/NameLookup.h"
@@ -28,8 +29,11 @@
 #include "swift/Basic/Dwarf.h"
 #include "swift/Basic/Fallthrough.h"
 #include "swift/Basic/FileSystem.h"
+#include "swift/Basic/JSONSerialization.h"
 #include "swift/Basic/SourceManager.h"
 #include "swift/Basic/Timer.h"
+#include "swift/Basic/Version.h"
+#include "swift/Driver/BinaryDependencyFile.h"
 #include "swift/Frontend/DiagnosticVerifier.h"
 #include "swift/Frontend/Frontend.h"
 #include "swift/Frontend/PrintingDiagnosticConsumer.h"
@@ -51,6 +55,7 @@
 #include "llvm/Option/Option.h"
 #include "llvm/Option/OptTable.h"
 #include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MD5.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/TargetSelect.h"
@@ -120,6 +125,138 @@ static bool emitMakeDependencies(DiagnosticEngine &diags,
   return false;
 }
 
+namespace {
+/// An ExpressionStats entry as written by emitExpressionStats.
+struct ExpressionStatsEntry {
+  std::string File;
+  unsigned Line = 0;
+  unsigned Column = 0;
+  double WallTimeMS;
+  ExpressionStats Stats;
+};
+} // end anonymous namespace
+
+namespace swift {
+namespace json {
+template <> struct ObjectTraits<ExpressionStatsEntry> {
+  static void mapping(Output &out, ExpressionStatsEntry &value) {
+    out.mapRequired("file", value.File);
+    out.mapRequired("line", value.Line);
+    out.mapRequired("column", value.Column);
+    out.mapRequired("wall_time_ms", value.WallTimeMS);
+    out.mapRequired("states_explored", value.Stats.NumStatesExplored);
+    out.mapRequired("disjunctions", value.Stats.NumDisjunctions);
+    out.mapRequired("disjunction_terms", value.Stats.NumDisjunctionTerms);
+    out.mapRequired("type_variable_bindings",
+                    value.Stats.NumTypeVariableBindings);
+    out.mapRequired("max_depth", value.Stats.MaxDepth);
+  }
+};
+
+template <> struct ArrayTraits<std::vector<ExpressionStatsEntry>> {
+  static size_t size(Output &out, std::vector<ExpressionStatsEntry> &seq) {
+    return seq.size();
+  }
+  static ExpressionStatsEntry &element(Output &out,
+                                       std::vector<ExpressionStatsEntry> &seq,
+                                       size_t index) {
+    return seq[index];
+  }
+};
+} // end namespace json
+} // end namespace swift
+
+/// Writes the expressions that took the longest to type-check as a JSON
+/// array, most expensive first.
+static bool emitExpressionStats(DiagnosticEngine &diags,
+                                const ExpressionStatsTracker &tracker,
+                                const SourceManager &sourceMgr,
+                                const FrontendOptions &opts) {
+  std::error_code EC;
+  llvm::raw_fd_ostream out(opts.ExpressionStatsPath, EC,
+                           llvm::sys::fs::F_None);
+
+  if (out.has_error() || EC) {
+    diags.diagnose(SourceLoc(), diag::error_opening_output,
+                   opts.ExpressionStatsPath, EC.message());
+    out.clear_error();
+    return true;
+  }
+
+  std::vector<ExpressionStatsEntry> entries;
+  for (const ExpressionStats &stats : tracker.getMostExpensive()) {
+    ExpressionStatsEntry entry;
+    if (stats.Loc.isValid()) {
+      entry.File = sourceMgr.getBufferIdentifierForLoc(stats.Loc);
+      std::tie(entry.Line, entry.Column) =
+        sourceMgr.getLineAndColumn(stats.Loc);
+    }
+    entry.WallTimeMS = stats.WallTime * 1000;
+    entry.Stats = stats;
+    entries.push_back(entry);
+  }
+
+  json::Output jsonOut(out);
+  jsonOut << entries;
+  out << '\n';
+  return false;
+}
+
+/// Computes the hash of everything the compilation of \p Instance depends on,
+/// for IRGenOptions::InputsHash.
+///
+/// The module's own source files are hashed by contents. The files it
+/// imported, i.e. the ones that go into a Make-style dependencies file, are
+/// hashed by size and modification time, and so is the compiler at
+/// \p MainExecutablePath: the version string alone does not tell apart two
+/// development builds of the compiler. \p Result is left alone if any of
+/// these files cannot be found.
+static void computeInputsHash(CompilerInstance &Instance,
+                              ArrayRef<const char *> Args,
+                              StringRef MainExecutablePath,
+                              std::vector<uint8_t> &Result) {
+  llvm::MD5 Hash;
+  auto update = [&Hash](StringRef Str) {
+    Hash.update(Str);
+    Hash.update(StringRef("", 1));
+  };
+  auto updateFileStatus = [&update](StringRef Path) -> bool {
+    llvm::sys::fs::file_status Status;
+    if (llvm::sys::fs::status(Path, Status))
+      return false;
+    auto ModTime = Status.getLastModificationTime();
+    update(Path);
+    update(std::to_string(Status.getSize()));
+    update(std::to_string(ModTime.seconds()));
+    update(std::to_string(ModTime.nanoseconds()));
+    return true;
+  };
+
+  update(version::getSwiftFullVersion());
+  if (MainExecutablePath.empty() || !updateFileStatus(MainExecutablePath))
+    return;
+  for (const char *Arg : Args)
+    update(Arg);
+
+  const llvm::SourceMgr &SM = Instance.getSourceMgr().getLLVMSourceMgr();
+  for (auto *File : Instance.getMainModule()->getFiles()) {
+    auto *SF = dyn_cast<SourceFile>(File);
+    if (!SF || !SF->getBufferID())
+      continue;
+    const llvm::MemoryBuffer *Buffer = SM.getMemoryBuffer(*SF->getBufferID());
+    update(Buffer->getBufferIdentifier());
+    update(Buffer->getBuffer());
+  }
+
+  for (StringRef Path : Instance.getDependencyTracker()->getDependencies())
+    if (!updateFileStatus(Path))
+      return;
+
+  llvm::MD5::MD5Result Digest;
+  Hash.final(Digest);
+  Result.assign(Digest, Digest + sizeof(Digest));
+}
+
 static void findNominals(llvm::MapVector<const NominalTypeDecl *, bool> &found,
                          DeclRange members) {
   for (const Decl *D : members) {
@@ -175,6 +312,68 @@ static std::string mangleTypeAsContext(const NominalTypeDecl *type) {
   return mangler.finalize();
 }
 
+namespace {
+/// Writes the sections of a reference dependencies file, either as YAML or
+/// in the binary form that the driver reads without parsing.
+class ReferenceDependencyOutput {
+  raw_ostream &Out;
+  Optional<BinaryDependencyFileWriter> Binary;
+  DependencySection Section = DependencySection::ProvidesTopLevel;
+
+  static std::string escape(StringRef name) {
+    return llvm::yaml::escape(name);
+  }
+
+public:
+  ReferenceDependencyOutput(raw_ostream &out, bool binary) : Out(out) {
+    if (binary)
+      Binary.emplace();
+    else
+      Out << "### Swift dependencies file v0 ###\n";
+  }
+
+  void beginSection(DependencySection section) {
+    Section = section;
+    if (!Binary)
+      Out << getDependencySectionName(section) << ":\n";
+  }
+
+  void addName(StringRef name, bool isCascading = true) {
+    if (Binary) {
+      Binary->addName(Section, name, isCascading);
+      return;
+    }
+    Out << "- ";
+    if (!isCascading)
+      Out << "!private ";
+    Out << "\"" << escape(name) << "\"\n";
+  }
+
+  void addMember(StringRef base, StringRef member, bool isCascading = true) {
+    if (Binary) {
+      Binary->addMember(Section, base, member, isCascading);
+      return;
+    }
+    Out << "- ";
+    if (!isCascading)
+      Out << "!private ";
+    Out << "[\"" << escape(base) << "\", \"" << escape(member) << "\"]\n";
+  }
+
+  void setInterfaceHash(StringRef hash) {
+    if (Binary)
+      Binary->setInterfaceHash(hash);
+    else
+      Out << "interface-hash: \"" << hash << "\"\n";
+  }
+
+  void finish() {
+    if (Binary)
+      Binary->write(Out);
+  }
+};
+} // end anonymous namespace
+
 /// Emits a Swift-style dependencies file.
 static bool emitReferenceDependencies(DiagnosticEngine &diags,
                                       SourceFile *SF,
@@ -187,26 +386,22 @@ static bool emitReferenceDependencies(DiagnosticEngine &diags,
   }
 
   std::error_code EC;
-  llvm::raw_fd_ostream out(opts.ReferenceDependenciesFilePath, EC,
-                           llvm::sys::fs::F_None);
+  llvm::raw_fd_ostream stream(opts.ReferenceDependenciesFilePath, EC,
+                              llvm::sys::fs::F_None);
 
-  if (out.has_error() || EC) {
+  if (stream.has_error() || EC) {
     diags.diagnose(SourceLoc(), diag::error_opening_output,
                    opts.ReferenceDependenciesFilePath, EC.message());
-    out.clear_error();
+    stream.clear_error();
     return true;
   }
 
-  auto escape = [](Identifier name) -> std::string {
-    return llvm::yaml::escape(name.str());
-  };
-
-  out << "### Swift dependencies file v0 ###\n";
+  ReferenceDependencyOutput out(stream, opts.EmitBinaryReferenceDependencies);
 
   llvm::MapVector<const NominalTypeDecl *, bool> extendedNominals;
   llvm::SmallVector<const ExtensionDecl *, 8> extensionsWithJustMembers;
 
-  out << "provides-top-level:\n";
+  out.beginSection(DependencySection::ProvidesTopLevel);
   for (const Decl *D : SF->Decls) {
     switch (D->getKind()) {
     case DeclKind::Module:
@@ -245,7 +440,7 @@ static bool emitReferenceDependencies(DiagnosticEngine &diags,
     case DeclKind::InfixOperator:
     case DeclKind::PrefixOperator:
     case DeclKind::PostfixOperator:
-      out << "- \"" << escape(cast<OperatorDecl>(D)->getName()) << "\"\n";
+      out.addName(cast<OperatorDecl>(D)->getName().str());
       break;
 
     case DeclKind::Enum:
@@ -259,7 +454,7 @@ static bool emitReferenceDependencies(DiagnosticEngine &diags,
           NTD->getFormalAccess() == Accessibility::Private) {
         break;
       }
-      out << "- \"" << escape(NTD->getName()) << "\"\n";
+      out.addName(NTD->getName().str());
       extendedNominals[NTD] |= true;
       findNominals(extendedNominals, NTD->getMembers());
       break;
@@ -275,7 +470,7 @@ static bool emitReferenceDependencies(DiagnosticEngine &diags,
           VD->getFormalAccess() == Accessibility::Private) {
         break;
       }
-      out << "- \"" << escape(VD->getName()) << "\"\n";
+      out.addName(VD->getName().str());
       break;
     }
 
@@ -297,21 +492,16 @@ static bool emitReferenceDependencies(DiagnosticEngine &diags,
     }
   }
 
-  out << "provides-nominal:\n";
+  out.beginSection(DependencySection::ProvidesNominal);
   for (auto entry : extendedNominals) {
     if (!entry.second)
       continue;
-    out << "- \"";
-    out << mangleTypeAsContext(entry.first);
-    out << "\"\n";
+    out.addName(mangleTypeAsContext(entry.first));
   }
 
-  out << "provides-member:\n";
-  for (auto entry : extendedNominals) {
-    out << "- [\"";
-    out << mangleTypeAsContext(entry.first);
-    out << "\", \"\"]\n";
-  }
+  out.beginSection(DependencySection::ProvidesMember);
+  for (auto entry : extendedNominals)
+    out.addMember(mangleTypeAsContext(entry.first), "");
 
   // This is also part of "provides-member".
   for (auto *ED : extensionsWithJustMembers) {
@@ -324,8 +514,7 @@ static bool emitReferenceDependencies(DiagnosticEngine &diags,
           VD->getFormalAccess() == Accessibility::Private) {
         continue;
       }
-      out << "- [\"" << mangledName << "\", \""
-          << escape(VD->getName()) << "\"]\n";
+      out.addMember(mangledName, VD->getName().str());
     }
   }
 
@@ -333,36 +522,31 @@ static bool emitReferenceDependencies(DiagnosticEngine &diags,
     // FIXME: This requires a traversal of the whole file to compute.
     // We should (a) see if there's a cheaper way to keep it up to date,
     // and/or (b) see if we can fast-path cases where there's no ObjC involved.
-    out << "provides-dynamic-lookup:\n";
+    out.beginSection(DependencySection::ProvidesDynamicLookup);
     class ValueDeclPrinter : public VisibleDeclConsumer {
     private:
-      raw_ostream &out;
-      std::string (*escape)(Identifier);
+      ReferenceDependencyOutput &out;
     public:
-      ValueDeclPrinter(raw_ostream &out, decltype(escape) escape)
-        : out(out), escape(escape) {}
+      explicit ValueDeclPrinter(ReferenceDependencyOutput &out) : out(out) {}
 
       void foundDecl(ValueDecl *VD, DeclVisibilityKind Reason) override {
-        out << "- \"" << escape(VD->getName()) << "\"\n";
+        out.addName(VD->getName().str());
       }
     };
-    ValueDeclPrinter printer(out, escape);
+    ValueDeclPrinter printer(out);
     SF->lookupClassMembers({}, printer);
   }
 
   ReferencedNameTracker *tracker = SF->getReferencedNameTracker();
 
   // FIXME: Sort these?
-  out << "depends-top-level:\n";
+  out.beginSection(DependencySection::DependsTopLevel);
   for (auto &entry : tracker->getTopLevelNames()) {
     assert(!entry.first.empty());
-    out << "- ";
-    if (!entry.second)
-      out << "!private ";
-    out << "\"" << escape(entry.first) << "\"\n";
+    out.addName(entry.first.str(), entry.second);
   }
 
-  out << "depends-member:\n";
+  out.beginSection(DependencySection::DependsMember);
   auto &memberLookupTable = tracker->getUsedMembers();
   using TableEntryTy = std::pair<ReferencedNameTracker::MemberPair, bool>;
   std::vector<TableEntryTy> sortedMembers{
@@ -382,25 +566,21 @@ static bool emitReferenceDependencies(DiagnosticEngine &diags,
     auto rhsMangledName = mangleTypeAsContext(rhs->first.first);
     return lhsMangledName.compare(rhsMangledName);
   });
-  
+
   for (auto &entry : sortedMembers) {
     assert(entry.first.first != nullptr);
     if (entry.first.first->hasAccessibility() &&
         entry.first.first->getFormalAccess() == Accessibility::Private)
       continue;
 
-    out << "- ";
-    if (!entry.second)
-      out << "!private ";
-    out << "[\"";
-    out << mangleTypeAsContext(entry.first.first);
-    out << "\", \"";
+    StringRef memberName;
     if (!entry.first.second.empty())
-      out << escape(entry.first.second);
-    out << "\"]\n";
+      memberName = entry.first.second.str();
+    out.addMember(mangleTypeAsContext(entry.first.first), memberName,
+                  entry.second);
   }
 
-  out << "depends-nominal:\n";
+  out.beginSection(DependencySection::DependsNominal);
   for (auto i = sortedMembers.begin(), e = sortedMembers.end(); i != e; ++i) {
     bool isCascading = i->second;
     while (i+1 != e && i[0].first.first == i[1].first.first) {
@@ -412,33 +592,25 @@ static bool emitReferenceDependencies(DiagnosticEngine &diags,
         i->first.first->getFormalAccess() == Accessibility::Private)
       continue;
 
-    out << "- ";
-    if (!isCascading)
-      out << "!private ";
-    out << "\"";
-    out <<  mangleTypeAsContext(i->first.first);
-    out << "\"\n";
+    out.addName(mangleTypeAsContext(i->first.first), isCascading);
   }
 
   // FIXME: Sort these?
-  out << "depends-dynamic-lookup:\n";
+  out.beginSection(DependencySection::DependsDynamicLookup);
   for (auto &entry : tracker->getDynamicLookupNames()) {
     assert(!entry.first.empty());
-    out << "- ";
-    if (!entry.second)
-      out << "!private ";
-    out << "\"" << escape(entry.first) << "\"\n";
+    out.addName(entry.first.str(), entry.second);
   }
 
-  out << "depends-external:\n";
-  for (auto &entry : depTracker.getDependencies()) {
-    out << "- \"" << llvm::yaml::escape(entry) << "\"\n";
-  }
+  out.beginSection(DependencySection::DependsExternal);
+  for (auto &entry : depTracker.getDependencies())
+    out.addName(entry);
 
   llvm::SmallString<32> interfaceHash;
   SF->getInterfaceHash(interfaceHash);
-  out << "interface-hash: \"" << interfaceHash << "\"\n";
+  out.setInterfaceHash(interfaceHash);
 
+  out.finish();
   return false;
 }
 
@@ -606,136 +778,20 @@ static void debugFailWithCrash() {
   LLVM_BUILTIN_TRAP;
 }
 
-/// Performs the compile requested by the user.
+/// Performs the steps of a compile that come after type-checking, from SIL
+/// generation on, for \p PrimarySourceFile (or the whole module if it is
+/// null), writing the outputs named by \p opts.
 /// \returns true on error
-static bool performCompile(CompilerInstance &Instance,
-                           CompilerInvocation &Invocation,
-                           ArrayRef<const char *> Args,
-                           int &ReturnValue) {
-  FrontendOptions opts = Invocation.getFrontendOptions();
+static bool performCompileStepsPostSema(CompilerInstance &Instance,
+                                        CompilerInvocation &Invocation,
+                                        const FrontendOptions &opts,
+                                        IRGenOptions &IRGenOpts,
+                                        SourceFile *PrimarySourceFile,
+                                        bool moduleIsPublic,
+                                        int &ReturnValue) {
   FrontendOptions::ActionType Action = opts.RequestedAction;
-
-  IRGenOptions &IRGenOpts = Invocation.getIRGenOptions();
-
-  bool inputIsLLVMIr = Invocation.getInputKind() == InputFileKind::IFK_LLVM_IR;
-  if (inputIsLLVMIr) {
-    auto &LLVMContext = llvm::getGlobalContext();
-
-    // Load in bitcode file.
-    assert(Invocation.getInputFilenames().size() == 1 &&
-           "We expect a single input for bitcode input!");
-    llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> FileBufOrErr =
-      llvm::MemoryBuffer::getFileOrSTDIN(Invocation.getInputFilenames()[0]);
-    if (!FileBufOrErr) {
-      Instance.getASTContext().Diags.diagnose(SourceLoc(),
-                                              diag::error_open_input_file,
-                                              Invocation.getInputFilenames()[0],
-                                              FileBufOrErr.getError().message());
-      return true;
-    }
-    llvm::MemoryBuffer *MainFile = FileBufOrErr.get().get();
-
-    llvm::SMDiagnostic Err;
-    std::unique_ptr<llvm::Module> Module = llvm::parseIR(
-                                             MainFile->getMemBufferRef(),
-                                             Err, LLVMContext);
-    if (!Module) {
-      // TODO: Translate from the diagnostic info to the SourceManager location
-      // if available.
-      Instance.getASTContext().Diags.diagnose(SourceLoc(),
-                                              diag::error_parse_input_file,
-                                              Invocation.getInputFilenames()[0],
-                                              Err.getMessage());
-      return true;
-    }
-
-    // TODO: remove once the frontend understands what action it should perform
-    IRGenOpts.OutputKind = getOutputKind(Action);
-
-    return performLLVM(IRGenOpts, Instance.getASTContext(), Module.get());
-  }
-
-  ReferencedNameTracker nameTracker;
-  bool shouldTrackReferences = !opts.ReferenceDependenciesFilePath.empty();
-  if (shouldTrackReferences)
-    Instance.setReferencedNameTracker(&nameTracker);
-
-  if (Action == FrontendOptions::DumpParse ||
-      Action == FrontendOptions::DumpInterfaceHash)
-    Instance.performParseOnly();
-  else
-    Instance.performSema();
-
-  FrontendOptions::DebugCrashMode CrashMode = opts.CrashMode;
-  if (CrashMode == FrontendOptions::DebugCrashMode::AssertAfterParse)
-    debugFailWithAssertion();
-  else if (CrashMode == FrontendOptions::DebugCrashMode::CrashAfterParse)
-    debugFailWithCrash();
-
   ASTContext &Context = Instance.getASTContext();
 
-  if (Action == FrontendOptions::REPL) {
-    runREPL(Instance, ProcessCmdLine(Args.begin(), Args.end()),
-            Invocation.getParseStdlib());
-    return false;
-  }
-
-  SourceFile *PrimarySourceFile = Instance.getPrimarySourceFile();
-
-  // We've been told to dump the AST (either after parsing or type-checking,
-  // which is already differentiated in CompilerInstance::performSema()),
-  // so dump or print the main source file and return.
-  if (Action == FrontendOptions::DumpParse ||
-      Action == FrontendOptions::DumpAST ||
-      Action == FrontendOptions::PrintAST ||
-      Action == FrontendOptions::DumpTypeRefinementContexts ||
-      Action == FrontendOptions::DumpInterfaceHash) {
-    SourceFile *SF = PrimarySourceFile;
-    if (!SF) {
-      SourceFileKind Kind = Invocation.getSourceFileKind();
-      SF = &Instance.getMainModule()->getMainSourceFile(Kind);
-    }
-    if (Action == FrontendOptions::PrintAST)
-      SF->print(llvm::outs(), PrintOptions::printEverything());
-    else if (Action == FrontendOptions::DumpTypeRefinementContexts)
-      SF->getTypeRefinementContext()->dump(llvm::errs(), Context.SourceMgr);
-    else if (Action == FrontendOptions::DumpInterfaceHash)
-      SF->dumpInterfaceHash(llvm::errs());
-    else
-      SF->dump();
-    return false;
-  }
-
-  // If we were asked to print Clang stats, do so.
-  if (opts.PrintClangStats && Context.getClangModuleLoader())
-    Context.getClangModuleLoader()->printStatistics();
-
-  if (!opts.DependenciesFilePath.empty())
-    (void)emitMakeDependencies(Context.Diags, *Instance.getDependencyTracker(),
-                               opts);
-
-  if (shouldTrackReferences)
-    emitReferenceDependencies(Context.Diags, Instance.getPrimarySourceFile(),
-                              *Instance.getDependencyTracker(), opts);
-
-  if (Context.hadError())
-    return true;
-
-  // FIXME: This is still a lousy approximation of whether the module file will
-  // be externally consumed.
-  bool moduleIsPublic =
-      !Instance.getMainModule()->hasEntryPoint() &&
-      opts.ImplicitObjCHeaderPath.empty() &&
-      !Context.LangOpts.EnableAppExtensionRestrictions;
-
-  // We've just been told to perform a parse, so we can return now.
-  if (Action == FrontendOptions::Parse) {
-    if (!opts.ObjCHeaderOutputPath.empty())
-      return printAsObjC(opts.ObjCHeaderOutputPath, Instance.getMainModule(),
-                         opts.ImplicitObjCHeaderPath, moduleIsPublic);
-    return false;
-  }
-
   assert(Action >= FrontendOptions::EmitSILGen &&
          "All actions not requiring SILGen must have been handled!");
 
@@ -931,6 +987,202 @@ static bool performCompile(CompilerInstance &Instance,
   return false;
 }
 
+/// Performs the compile requested by the user.
+/// \returns true on error
+static bool performCompile(CompilerInstance &Instance,
+                           CompilerInvocation &Invocation,
+                           ArrayRef<const char *> Args,
+                           StringRef MainExecutablePath,
+                           int &ReturnValue) {
+  FrontendOptions opts = Invocation.getFrontendOptions();
+  FrontendOptions::ActionType Action = opts.RequestedAction;
+
+  IRGenOptions &IRGenOpts = Invocation.getIRGenOptions();
+
+  bool inputIsLLVMIr = Invocation.getInputKind() == InputFileKind::IFK_LLVM_IR;
+  if (inputIsLLVMIr) {
+    auto &LLVMContext = llvm::getGlobalContext();
+
+    // Load in bitcode file.
+    assert(Invocation.getInputFilenames().size() == 1 &&
+           "We expect a single input for bitcode input!");
+    llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> FileBufOrErr =
+      llvm::MemoryBuffer::getFileOrSTDIN(Invocation.getInputFilenames()[0]);
+    if (!FileBufOrErr) {
+      Instance.getASTContext().Diags.diagnose(SourceLoc(),
+                                              diag::error_open_input_file,
+                                              Invocation.getInputFilenames()[0],
+                                              FileBufOrErr.getError().message());
+      return true;
+    }
+    llvm::MemoryBuffer *MainFile = FileBufOrErr.get().get();
+
+    llvm::SMDiagnostic Err;
+    std::unique_ptr<llvm::Module> Module = llvm::parseIR(
+                                             MainFile->getMemBufferRef(),
+                                             Err, LLVMContext);
+    if (!Module) {
+      // TODO: Translate from the diagnostic info to the SourceManager location
+      // if available.
+      Instance.getASTContext().Diags.diagnose(SourceLoc(),
+                                              diag::error_parse_input_file,
+                                              Invocation.getInputFilenames()[0],
+                                              Err.getMessage());
+      return true;
+    }
+
+    // TODO: remove once the frontend understands what action it should perform
+    IRGenOpts.OutputKind = getOutputKind(Action);
+
+    return performLLVM(IRGenOpts, Instance.getASTContext(), Module.get());
+  }
+
+  ReferencedNameTracker nameTracker;
+  bool shouldTrackReferences = !opts.ReferenceDependenciesFilePath.empty();
+  if (shouldTrackReferences)
+    Instance.setReferencedNameTracker(&nameTracker);
+
+  ExpressionStatsTracker expressionStats(opts.NumExpressionStats);
+  if (!opts.ExpressionStatsPath.empty())
+    Instance.getASTContext().ExpressionStats = &expressionStats;
+
+  if (Action == FrontendOptions::DumpParse ||
+      Action == FrontendOptions::DumpInterfaceHash)
+    Instance.performParseOnly();
+  else
+    Instance.performSema();
+
+  if (!opts.ExpressionStatsPath.empty()) {
+    ASTContext &Context = Instance.getASTContext();
+    Context.ExpressionStats = nullptr;
+    (void)emitExpressionStats(Context.Diags, expressionStats,
+                              Context.SourceMgr, opts);
+  }
+
+  FrontendOptions::DebugCrashMode CrashMode = opts.CrashMode;
+  if (CrashMode == FrontendOptions::DebugCrashMode::AssertAfterParse)
+    debugFailWithAssertion();
+  else if (CrashMode == FrontendOptions::DebugCrashMode::CrashAfterParse)
+    debugFailWithCrash();
+
+  ASTContext &Context = Instance.getASTContext();
+
+  if (Action == FrontendOptions::REPL) {
+    runREPL(Instance, ProcessCmdLine(Args.begin(), Args.end()),
+            Invocation.getParseStdlib());
+    return false;
+  }
+
+  SourceFile *PrimarySourceFile = Instance.getPrimarySourceFile();
+
+  // We've been told to dump the AST (either after parsing or type-checking,
+  // which is already differentiated in CompilerInstance::performSema()),
+  // so dump or print the main source file and return.
+  if (Action == FrontendOptions::DumpParse ||
+      Action == FrontendOptions::DumpAST ||
+      Action == FrontendOptions::PrintAST ||
+      Action == FrontendOptions::DumpTypeRefinementContexts ||
+      Action == FrontendOptions::DumpInterfaceHash) {
+    SourceFile *SF = PrimarySourceFile;
+    if (!SF) {
+      SourceFileKind Kind = Invocation.getSourceFileKind();
+      SF = &Instance.getMainModule()->getMainSourceFile(Kind);
+    }
+    if (Action == FrontendOptions::PrintAST)
+      SF->print(llvm::outs(), PrintOptions::printEverything());
+    else if (Action == FrontendOptions::DumpTypeRefinementContexts)
+      SF->getTypeRefinementContext()->dump(llvm::errs(), Context.SourceMgr);
+    else if (Action == FrontendOptions::DumpInterfaceHash)
+      SF->dumpInterfaceHash(llvm::errs());
+    else
+      SF->dump();
+    return false;
+  }
+
+  // If we were asked to print Clang stats, do so.
+  if (opts.PrintClangStats && Context.getClangModuleLoader())
+    Context.getClangModuleLoader()->printStatistics();
+
+  if (opts.isInBatchMode()) {
+    // Every primary input gets its own dependencies files. The make-style ones
+    // all list the dependencies of the whole batch.
+    ArrayRef<SourceFile *> PrimarySourceFiles =
+      Instance.getBatchPrimarySourceFiles();
+    for (unsigned i = 0, e = PrimarySourceFiles.size(); i != e; ++i) {
+      FrontendOptions PrimaryOpts = opts.getOptionsForBatchPrimaryInput(i);
+      if (!PrimaryOpts.DependenciesFilePath.empty())
+        (void)emitMakeDependencies(Context.Diags,
+                                   *Instance.getDependencyTracker(),
+                                   PrimaryOpts);
+      if (shouldTrackReferences)
+        emitReferenceDependencies(Context.Diags, PrimarySourceFiles[i],
+                                  *Instance.getDependencyTracker(),
+                                  PrimaryOpts);
+    }
+  } else {
+    if (!opts.DependenciesFilePath.empty())
+      (void)emitMakeDependencies(Context.Diags,
+                                 *Instance.getDependencyTracker(), opts);
+
+    if (shouldTrackReferences)
+      emitReferenceDependencies(Context.Diags, Instance.getPrimarySourceFile(),
+                                *Instance.getDependencyTracker(), opts);
+  }
+
+  if (Context.hadError())
+    return true;
+
+  // FIXME: This is still a lousy approximation of whether the module file will
+  // be externally consumed.
+  bool moduleIsPublic =
+      !Instance.getMainModule()->hasEntryPoint() &&
+      opts.ImplicitObjCHeaderPath.empty() &&
+      !Context.LangOpts.EnableAppExtensionRestrictions;
+
+  // We've just been told to perform a parse, so we can return now.
+  if (Action == FrontendOptions::Parse) {
+    if (!opts.ObjCHeaderOutputPath.empty())
+      return printAsObjC(opts.ObjCHeaderOutputPath, Instance.getMainModule(),
+                         opts.ImplicitObjCHeaderPath, moduleIsPublic);
+    return false;
+  }
+
+  if (opts.isInBatchMode()) {
+    ArrayRef<SourceFile *> PrimarySourceFiles =
+      Instance.getBatchPrimarySourceFiles();
+    for (unsigned i = 0, e = PrimarySourceFiles.size(); i != e; ++i) {
+      FrontendOptions PrimaryOpts = opts.getOptionsForBatchPrimaryInput(i);
+
+      // Each primary input starts from the same IRGen options.
+      IRGenOptions PrimaryIRGenOpts = IRGenOpts;
+      PrimaryIRGenOpts.OutputFilenames = PrimaryOpts.OutputFilenames;
+      if (PrimaryOpts.PrimaryInput->isFilename()) {
+        PrimaryIRGenOpts.MainInputFilename =
+          PrimaryOpts.InputFilenames[PrimaryOpts.PrimaryInput->Index];
+      }
+
+      if (performCompileStepsPostSema(Instance, Invocation, PrimaryOpts,
+                                      PrimaryIRGenOpts, PrimarySourceFiles[i],
+                                      moduleIsPublic, ReturnValue))
+        return true;
+    }
+    return false;
+  }
+
+  // Multi-threaded IRGen can reuse the object files of an earlier
+  // compilation of exactly the same inputs without generating any IR. The
+  // SIL is still generated and optimized, since the object files are only
+  // checked when IRGen starts.
+  if (!PrimarySourceFile && Invocation.getSILOptions().NumThreads != 0 &&
+      Instance.getDependencyTracker())
+    computeInputsHash(Instance, Args, MainExecutablePath,
+                      IRGenOpts.InputsHash);
+
+  return performCompileStepsPostSema(Instance, Invocation, opts, IRGenOpts,
+                                     PrimarySourceFile, moduleIsPublic,
+                                     ReturnValue);
+}
+
 /// Returns true if an error occurred.
 static bool dumpAPI(Module *Mod, StringRef OutDir) {
   using namespace llvm::sys;
@@ -1112,9 +1364,12 @@ int frontend_main(ArrayRef<const char *>Args,
     enableDiagnosticVerifier(Instance.getSourceMgr());
   }
 
+  // Multi-threaded compilation also uses the dependencies to decide whether
+  // the existing object files are up to date.
   DependencyTracker depTracker;
   if (!Invocation.getFrontendOptions().DependenciesFilePath.empty() ||
-      !Invocation.getFrontendOptions().ReferenceDependenciesFilePath.empty()) {
+      !Invocation.getFrontendOptions().ReferenceDependenciesFilePath.empty() ||
+      Invocation.getSILOptions().NumThreads != 0) {
     Instance.setDependencyTracker(&depTracker);
   }
 
@@ -1123,7 +1378,8 @@ int frontend_main(ArrayRef<const char *>Args,
   }
 
   int ReturnValue = 0;
-  bool HadError = performCompile(Instance, Invocation, Args, ReturnValue) ||
+  bool HadError = performCompile(Instance, Invocation, Args,
+                                 MainExecutablePath, ReturnValue) ||
                   Instance.getASTContext().hadError();
 
   if (!HadError && !Invocation.getFrontendOptions().DumpAPIPath.empty()) {
@@ -0,0 +1,210 @@
+//===--- CacheTest.cpp - for swift/Basic/Cache.h --------------------------===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2016 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+
+#include "swift/Basic/Cache.h"
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using namespace swift::sys;
+
+namespace {
+
+/// A cached value with an explicit cost.
+struct TestValue {
+  int Value;
+  size_t Cost;
+};
+
+std::atomic<int> LiveValues(0);
+
+/// Counts the values that are in the cache or retained by it.
+struct TestValueInfo {
+  static void *enterCache(const TestValue &Val) {
+    ++LiveValues;
+    return new TestValue(Val);
+  }
+  static void exitCache(void *Ptr) {
+    --LiveValues;
+    delete static_cast<TestValue*>(Ptr);
+  }
+  static const TestValue &getFromCache(void *Ptr) {
+    return *static_cast<TestValue*>(Ptr);
+  }
+  static size_t getCost(const TestValue &Val) { return Val.Cost; }
+};
+
+typedef Cache<int, TestValue, CacheKeyInfo<int>, TestValueInfo> TestCache;
+
+/// Exposes the retain-based interface that \c Cache wraps.
+struct RetainingTestCache : CacheImpl {
+  explicit RetainingTestCache(size_t Limit) {
+    CallBacks CBs = {
+      /*UserData=*/nullptr,
+      [](void *Key, void *) -> uintptr_t { return uintptr_t(Key) >> 4; },
+      [](void *Key1, void *Key2, void *) { return Key1 == Key2; },
+      [](void *Key, void *) {},
+      [](void *Value, void *) { TestValueInfo::exitCache(Value); }
+    };
+    Impl = create("swift.unittest.RetainingCache", CBs);
+    setCostLimit(Limit);
+  }
+  ~RetainingTestCache() { destroy(); }
+
+  using CacheImpl::setAndRetain;
+  using CacheImpl::getAndRetain;
+  using CacheImpl::releaseValue;
+  using CacheImpl::remove;
+};
+
+} // end anonymous namespace
+
+TEST(Cache, SetGetRemove) {
+  {
+    TestCache C("swift.unittest.Cache");
+    EXPECT_FALSE(C.get(1).hasValue());
+    C.set(1, {10, 1});
+    C.set(2, {20, 1});
+    EXPECT_EQ(10, C.get(1)->Value);
+    EXPECT_EQ(20, C.get(2)->Value);
+
+    C.set(1, {11, 1});
+    EXPECT_EQ(11, C.get(1)->Value);
+
+    EXPECT_TRUE(C.remove(1));
+    EXPECT_FALSE(C.remove(1));
+    EXPECT_FALSE(C.get(1).hasValue());
+    EXPECT_EQ(20, C.get(2)->Value);
+
+    C.clear();
+    EXPECT_FALSE(C.get(2).hasValue());
+  }
+  EXPECT_EQ(0, LiveValues.load());
+}
+
+#if !defined(__APPLE__)
+
+TEST(Cache, EvictsLeastRecentlyUsed) {
+  {
+    TestCache C("swift.unittest.Cache");
+    C.setCostLimit(30);
+    C.set(1, {10, 10});
+    C.set(2, {20, 10});
+    C.set(3, {30, 10});
+    EXPECT_EQ(3, LiveValues.load());
+
+    // Using 1 makes 2 the least recently used value.
+    EXPECT_TRUE(C.get(1).hasValue());
+    C.set(4, {40, 10});
+    EXPECT_EQ(3, LiveValues.load());
+    EXPECT_FALSE(C.get(2).hasValue());
+    EXPECT_TRUE(C.get(1).hasValue());
+    EXPECT_TRUE(C.get(3).hasValue());
+    EXPECT_TRUE(C.get(4).hasValue());
+
+    // Lowering the limit evicts right away.
+    C.setCostLimit(10);
+    EXPECT_EQ(1, LiveValues.load());
+    EXPECT_TRUE(C.get(4).hasValue());
+
+    // A value that costs more than the limit is evicted by the next set.
+    C.set(5, {50, 100});
+    EXPECT_TRUE(C.get(5).hasValue());
+    C.set(6, {60, 1});
+    EXPECT_FALSE(C.get(5).hasValue());
+    EXPECT_TRUE(C.get(6).hasValue());
+  }
+  EXPECT_EQ(0, LiveValues.load());
+}
+
+TEST(Cache, NoLimit) {
+  {
+    TestCache C("swift.unittest.Cache");
+    C.setCostLimit(0);
+    for (int i = 0; i != 100; ++i)
+      C.set(i, {i, 1000});
+    EXPECT_EQ(100, LiveValues.load());
+    for (int i = 0; i != 100; ++i)
+      EXPECT_EQ(i, C.get(i)->Value);
+  }
+  EXPECT_EQ(0, LiveValues.load());
+}
+
+TEST(Cache, RetainedValuesOutliveRemoval) {
+  {
+    RetainingTestCache C(/*Limit=*/10);
+    int Key1, Key2, Key3;
+    void *Value1 = TestValueInfo::enterCache({1, 10});
+    C.setAndRetain(&Key1, Value1, 10);
+
+    // A retained value is neither evicted nor destroyed.
+    void *Value2 = TestValueInfo::enterCache({2, 10});
+    C.setAndRetain(&Key2, Value2, 10);
+    C.releaseValue(Value2);
+    void *Out = nullptr;
+    EXPECT_TRUE(C.getAndRetain(&Key1, &Out));
+    EXPECT_EQ(Value1, Out);
+    C.releaseValue(Out);
+    EXPECT_EQ(2, LiveValues.load());
+
+    // Removing it only destroys it once it is released.
+    EXPECT_TRUE(C.remove(&Key1));
+    EXPECT_FALSE(C.getAndRetain(&Key1, &Out));
+    EXPECT_EQ(2, LiveValues.load());
+    C.releaseValue(Value1);
+    EXPECT_EQ(1, LiveValues.load());
+
+    // Replacing a value works the same way.
+    EXPECT_TRUE(C.getAndRetain(&Key2, &Out));
+    void *Value3 = TestValueInfo::enterCache({3, 1});
+    C.setAndRetain(&Key2, Value3, 1);
+    C.releaseValue(Value3);
+    EXPECT_EQ(2, LiveValues.load());
+    C.releaseValue(Out);
+    EXPECT_EQ(1, LiveValues.load());
+
+    void *Value4 = TestValueInfo::enterCache({4, 1});
+    C.setAndRetain(&Key3, Value4, 1);
+    C.releaseValue(Value4);
+  }
+  EXPECT_EQ(0, LiveValues.load());
+}
+
+#endif
+
+TEST(Cache, ConcurrentAccess) {
+  const int NumThreads = 8;
+  const int NumKeys = 64;
+  {
+    TestCache C("swift.unittest.Cache");
+    C.setCostLimit(NumKeys / 2);
+    std::vector<std::thread> Threads;
+    for (int T = 0; T != NumThreads; ++T) {
+      Threads.emplace_back([&C, T] {
+        for (int I = 0; I != 2000; ++I) {
+          int Key = (I * 7 + T) % NumKeys;
+          if (auto Val = C.get(Key))
+            EXPECT_EQ(Key, Val->Value);
+          else
+            C.set(Key, {Key, 1});
+          if (I % 97 == 0)
+            C.remove(Key);
+        }
+      });
+    }
+    for (auto &Thread : Threads)
+      Thread.join();
+  }
+  EXPECT_EQ(0, LiveValues.load());
+}
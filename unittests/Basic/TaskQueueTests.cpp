@@ -0,0 +1,99 @@
+#include "swift/Basic/TaskQueue.h"
+#include "llvm/ADT/STLExtras.h"
+#include "gtest/gtest.h"
+#include <string>
+#include <vector>
+
+using namespace swift;
+using namespace swift::sys;
+
+#if LLVM_ON_UNIX && !defined(__CYGWIN__)
+
+namespace {
+/// Runs \p numTasks copies of "/bin/sh -c <script> <index>", \p parallelism
+/// at a time, and records what each of them did.
+class TaskQueueStressTest : public ::testing::Test {
+protected:
+  struct Result {
+    bool Finished = false;
+    int ReturnCode = -1;
+    std::string Output;
+    Optional<TaskResourceUsage> Usage;
+  };
+
+  std::vector<std::string> Indices;
+  std::vector<std::vector<const char *>> Arguments;
+  std::vector<Result> Results;
+
+  bool run(const char *script, unsigned numTasks, unsigned parallelism) {
+    Indices.resize(numTasks);
+    Arguments.resize(numTasks);
+    Results.resize(numTasks);
+
+    TaskQueue TQ(parallelism);
+    for (unsigned i = 0; i != numTasks; ++i) {
+      Indices[i] = std::to_string(i);
+      Arguments[i] = { "-c", script, Indices[i].c_str() };
+      TQ.addTask("/bin/sh", Arguments[i], llvm::None, &Results[i]);
+    }
+
+    unsigned began = 0;
+    return TQ.execute(
+      [&](ProcessId Pid, void *Context) { ++began; },
+      [&](ProcessId Pid, int ReturnCode, StringRef Output,
+          Optional<TaskResourceUsage> Usage, void *Context) {
+        auto &result = *static_cast<Result *>(Context);
+        result.Finished = true;
+        result.ReturnCode = ReturnCode;
+        result.Output = Output;
+        result.Usage = Usage;
+        return TaskFinishedResponse::ContinueExecution;
+      },
+      [&](ProcessId Pid, StringRef ErrorMsg, StringRef Output,
+          Optional<TaskResourceUsage> Usage, void *Context) {
+        return TaskFinishedResponse::StopExecution;
+      }) || began != numTasks;
+  }
+};
+} // end anonymous namespace
+
+TEST_F(TaskQueueStressTest, ManyTrivialTasks) {
+  const unsigned numTasks = 2000;
+  ASSERT_FALSE(run("echo $0; exit $(($0 % 3))", numTasks, 64));
+
+  for (unsigned i = 0; i != numTasks; ++i) {
+    ASSERT_TRUE(Results[i].Finished) << i;
+    EXPECT_EQ(int(i % 3), Results[i].ReturnCode) << i;
+    EXPECT_EQ(Indices[i] + "\n", Results[i].Output) << i;
+    ASSERT_TRUE(Results[i].Usage.hasValue()) << i;
+    EXPECT_GT(Results[i].Usage->MaxResidentSetSize, 0u) << i;
+  }
+}
+
+TEST_F(TaskQueueStressTest, LargeOutputDoesNotBlockOtherTasks) {
+  // The first task writes far more than a pipe holds, slowly, while the
+  // others come and go.
+  const unsigned numTasks = 200;
+  ASSERT_FALSE(run("if [ $0 = 0 ]; then "
+                   "  for i in 1 2 3 4 5 6 7 8; do "
+                   "    head -c 65536 /dev/zero | tr '\\0' x; sleep 0.05; "
+                   "  done; "
+                   "else echo $0 >&2; fi",
+                   numTasks, 8));
+
+  EXPECT_EQ(std::string(8 * 65536, 'x'), Results[0].Output);
+  for (unsigned i = 1; i != numTasks; ++i) {
+    ASSERT_TRUE(Results[i].Finished) << i;
+    EXPECT_EQ(0, Results[i].ReturnCode) << i;
+    EXPECT_EQ(Indices[i] + "\n", Results[i].Output) << i;
+  }
+}
+
+TEST_F(TaskQueueStressTest, ResourceUsage) {
+  ASSERT_FALSE(run("i=0; while [ $i -lt 20000 ]; do i=$((i+1)); done",
+                   1, 1));
+  ASSERT_TRUE(Results[0].Usage.hasValue());
+  EXPECT_GT(Results[0].Usage->UserTime + Results[0].Usage->SystemTime, 0u);
+}
+
+#endif
@@ -0,0 +1,151 @@
+//===--- DependencyGraphBenchmark.cpp - Dependency file loading -----------===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2016 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+//
+// Compares loading the YAML and binary forms of reference dependencies files
+// into a DependencyGraph, for a module with 5,000 synthetic files. These are
+// disabled by default; run them with:
+//
+//   SwiftDriverTests --gtest_filter='DependencyGraphBenchmark.*' \
+//     --gtest_also_run_disabled_tests
+//
+//===----------------------------------------------------------------------===//
+
+#include "swift/Driver/BinaryDependencyFile.h"
+#include "swift/Driver/DependencyGraph.h"
+#include "llvm/Support/raw_ostream.h"
+#include "gtest/gtest.h"
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using namespace swift;
+using LoadResult = DependencyGraphImpl::LoadResult;
+
+namespace {
+
+const unsigned NumFiles = 5000;
+const unsigned NamesPerFile = 10;
+const unsigned DependenciesPerFile = 40;
+
+/// Calls back with the contents of the dependencies file of file \p index:
+/// the names it provides and the names it uses from other files.
+template <class Callback>
+void forEachSyntheticEntry(unsigned index, Callback callback) {
+  auto name = [](unsigned file, unsigned n) {
+    return "name" + std::to_string(file) + "_" + std::to_string(n);
+  };
+  auto type = [](unsigned file) {
+    return "V4main" + std::to_string(file) + "Type";
+  };
+
+  for (unsigned n = 0; n != NamesPerFile; ++n)
+    callback(DependencySection::ProvidesTopLevel, name(index, n), "", true);
+  callback(DependencySection::ProvidesNominal, type(index), "", true);
+  callback(DependencySection::ProvidesMember, type(index), "", true);
+  for (unsigned n = 0; n != NamesPerFile; ++n)
+    callback(DependencySection::ProvidesMember, type(index), name(index, n),
+             true);
+
+  auto other = [index](unsigned d) {
+    return (index * 31 + d * 97) % NumFiles;
+  };
+  for (unsigned d = 0; d != DependenciesPerFile; ++d)
+    callback(DependencySection::DependsTopLevel,
+             name(other(d), d % NamesPerFile), "", d % 3 != 0);
+  for (unsigned d = 0; d != DependenciesPerFile; ++d)
+    callback(DependencySection::DependsMember, type(other(d)),
+             name(other(d), d % NamesPerFile), d % 3 != 0);
+  for (unsigned d = 0; d != DependenciesPerFile; ++d)
+    callback(DependencySection::DependsNominal, type(other(d)), "",
+             d % 3 != 0);
+  callback(DependencySection::DependsExternal,
+           "/SDK/Foundation.swiftmodule", "", true);
+}
+
+std::string makeYAMLFile(unsigned index) {
+  std::string result;
+  llvm::raw_string_ostream out(result);
+  out << "### Swift dependencies file v0 ###\n";
+  Optional<DependencySection> lastSection;
+  forEachSyntheticEntry(index, [&](DependencySection section,
+                                   const std::string &name,
+                                   const std::string &member,
+                                   bool isCascading) {
+    if (!lastSection || lastSection.getValue() != section) {
+      out << getDependencySectionName(section) << ":\n";
+      lastSection = section;
+    }
+    out << "- " << (isCascading ? "" : "!private ");
+    if (isMemberDependencySection(section))
+      out << "[\"" << name << "\", \"" << member << "\"]\n";
+    else
+      out << "\"" << name << "\"\n";
+  });
+  out << "interface-hash: \"" << index << "\"\n";
+  return out.str();
+}
+
+std::string makeBinaryFile(unsigned index) {
+  BinaryDependencyFileWriter writer;
+  forEachSyntheticEntry(index, [&](DependencySection section,
+                                   const std::string &name,
+                                   const std::string &member,
+                                   bool isCascading) {
+    if (isMemberDependencySection(section))
+      writer.addMember(section, name, member, isCascading);
+    else
+      writer.addName(section, name, isCascading);
+  });
+  writer.setInterfaceHash(std::to_string(index));
+
+  std::string result;
+  llvm::raw_string_ostream out(result);
+  writer.write(out);
+  return out.str();
+}
+
+void benchmarkLoading(const char *name,
+                      std::string (*makeFile)(unsigned)) {
+  std::vector<std::string> files;
+  size_t totalSize = 0;
+  for (unsigned i = 0; i != NumFiles; ++i) {
+    files.push_back(makeFile(i));
+    totalSize += files.back().size();
+  }
+
+  DependencyGraph<uintptr_t> graph;
+  auto start = std::chrono::steady_clock::now();
+  for (unsigned i = 0; i != NumFiles; ++i)
+    EXPECT_EQ(LoadResult::UpToDate, graph.loadFromString(i, files[i]));
+  auto end = std::chrono::steady_clock::now();
+
+  printf("%s: loaded %u files (%zu KB) in %lld ms\n", name, NumFiles,
+         totalSize / 1024,
+         (long long)std::chrono::duration_cast<std::chrono::milliseconds>(
+           end - start).count());
+
+  // Make sure the graph is connected the way the files say.
+  SmallVector<uintptr_t, 16> marked;
+  graph.markTransitive(marked, 0);
+  EXPECT_FALSE(marked.empty());
+}
+
+} // end anonymous namespace
+
+TEST(DependencyGraphBenchmark, DISABLED_LoadYAML) {
+  benchmarkLoading("YAML", makeYAMLFile);
+}
+
+TEST(DependencyGraphBenchmark, DISABLED_LoadBinary) {
+  benchmarkLoading("binary", makeBinaryFile);
+}
@@ -0,0 +1,246 @@
+#include "swift/Driver/DependencyGraph.h"
+#include "swift/Driver/DependencyGraphCache.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/Process.h"
+#include "llvm/Support/raw_ostream.h"
+#include "gtest/gtest.h"
+#include <algorithm>
+
+#define ASSERT_NO_ERROR(x)                                                     \
+  do if (std::error_code ASSERT_NO_ERROR_ec = x) {                             \
+    llvm::errs() << #x ": did not return errc::success.\n"                     \
+      << "error number: " << ASSERT_NO_ERROR_ec.value() << "\n"                \
+      << "error message: " << ASSERT_NO_ERROR_ec.message() << "\n";            \
+    FAIL();                                                                    \
+  } while (0)
+
+using namespace llvm::sys;
+using namespace swift;
+using LoadResult = DependencyGraphImpl::LoadResult;
+
+namespace {
+/// A temporary directory of dependencies files, all modified well before
+/// now unless a test says otherwise.
+class DependencyGraphCacheTest : public ::testing::Test {
+protected:
+  llvm::SmallString<128> DirPath;
+  std::vector<std::string> Files;
+
+  void SetUp() override {
+    ASSERT_NO_ERROR(fs::createUniqueDirectory("DependencyGraphCache-test",
+                                              DirPath));
+  }
+
+  void TearDown() override {
+    for (auto &file : Files)
+      fs::remove(file);
+    fs::remove(DirPath);
+  }
+
+  std::string getPath(StringRef name) {
+    llvm::SmallString<128> path = DirPath;
+    path::append(path, name);
+    return path.str().str();
+  }
+
+  void writeFile(StringRef name, StringRef contents,
+                 TimeValue modTime = TimeValue(1390550700, 0)) {
+    std::string path = getPath(name);
+    if (std::find(Files.begin(), Files.end(), path) == Files.end())
+      Files.push_back(path);
+
+    int fd;
+    ASSERT_NO_ERROR(fs::openFileForWrite(path, fd, fs::F_None));
+    {
+      llvm::raw_fd_ostream out(fd, /*shouldClose=*/false);
+      out << contents;
+    }
+    ASSERT_NO_ERROR(fs::setLastModificationAndAccessTime(fd, modTime));
+    ASSERT_NO_ERROR(Process::SafelyCloseFileDescriptor(fd));
+  }
+
+  std::string writeCache(const DependencyGraphCache &previous,
+                         ArrayRef<StringRef> names) {
+    std::vector<std::string> paths;
+    for (StringRef name : names)
+      paths.push_back(getPath(name));
+    SmallVector<StringRef, 4> pathRefs(paths.begin(), paths.end());
+
+    std::string result;
+    llvm::raw_string_ostream out(result);
+    previous.write(out, pathRefs);
+    return out.str();
+  }
+
+  bool isUpToDate(const DependencyGraphCache &cache,
+                  ArrayRef<StringRef> names) {
+    std::vector<std::string> paths;
+    for (StringRef name : names)
+      paths.push_back(getPath(name));
+    SmallVector<StringRef, 4> pathRefs(paths.begin(), paths.end());
+    return cache.isUpToDate(pathRefs);
+  }
+};
+
+/// The names of the entries recorded for a file.
+std::vector<std::string>
+getNames(const Optional<DependencyGraphCache::Dependencies> &dependencies) {
+  std::vector<std::string> names;
+  for (auto &entry : dependencies->Entries)
+    names.push_back(entry.Name.str());
+  return names;
+}
+} // end anonymous namespace
+
+TEST_F(DependencyGraphCacheTest, RoundTrip) {
+  writeFile("a.swiftdeps",
+            "interface-hash: \"abc\"\n"
+            "provides-top-level: [a]\n");
+  writeFile("b.swiftdeps",
+            "depends-top-level: [a, !private c]\n"
+            "depends-member: [[\"V\", \"m\"]]\n");
+
+  std::string data = writeCache(DependencyGraphCache(),
+                                {"a.swiftdeps", "b.swiftdeps", "missing"});
+
+  DependencyGraphCache cache;
+  ASSERT_TRUE(cache.loadFromString(data));
+  auto a = cache.lookup(getPath("a.swiftdeps"));
+  auto b = cache.lookup(getPath("b.swiftdeps"));
+  ASSERT_TRUE(a.hasValue());
+  ASSERT_TRUE(b.hasValue());
+  EXPECT_FALSE(cache.lookup(getPath("missing")).hasValue());
+
+  ASSERT_TRUE(a->InterfaceHash.hasValue());
+  EXPECT_EQ("abc", *a->InterfaceHash);
+  ASSERT_EQ(1u, a->Entries.size());
+  EXPECT_EQ(DependencySection::ProvidesTopLevel, a->Entries[0].Section);
+  EXPECT_EQ("a", a->Entries[0].Name);
+  EXPECT_TRUE(a->Entries[0].IsCascading);
+
+  EXPECT_FALSE(b->InterfaceHash.hasValue());
+  ASSERT_EQ(3u, b->Entries.size());
+  EXPECT_EQ(DependencySection::DependsTopLevel, b->Entries[0].Section);
+  EXPECT_EQ("a", b->Entries[0].Name);
+  EXPECT_TRUE(b->Entries[0].IsCascading);
+  EXPECT_EQ(DependencySection::DependsTopLevel, b->Entries[1].Section);
+  EXPECT_EQ("c", b->Entries[1].Name);
+  EXPECT_FALSE(b->Entries[1].IsCascading);
+  EXPECT_EQ(DependencySection::DependsMember, b->Entries[2].Section);
+  EXPECT_EQ(StringRef("V\0m", 3), b->Entries[2].Name);
+
+  // The recorded entries load like the files themselves.
+  DependencyGraph<uintptr_t> graph;
+  EXPECT_EQ(LoadResult::UpToDate,
+            graph.loadFromEntries(0, a->InterfaceHash, a->Entries));
+  EXPECT_EQ(LoadResult::UpToDate,
+            graph.loadFromEntries(1, b->InterfaceHash, b->Entries));
+  SmallVector<uintptr_t, 4> marked;
+  graph.markTransitive(marked, 0);
+  ASSERT_EQ(1u, marked.size());
+  EXPECT_EQ(1u, marked.front());
+
+  // A changed interface hash affects the files downstream.
+  EXPECT_EQ(LoadResult::AffectsDownstream,
+            graph.loadFromEntries(0, StringRef("def"), a->Entries));
+}
+
+TEST_F(DependencyGraphCacheTest, ChangedFiles) {
+  writeFile("a.swiftdeps", "provides-top-level: [a]");
+  writeFile("b.swiftdeps", "provides-top-level: [b]");
+  writeFile("c.swiftdeps", "provides-top-level: [c]");
+
+  std::string data = writeCache(DependencyGraphCache(),
+                                {"a.swiftdeps", "b.swiftdeps", "c.swiftdeps"});
+
+  // A new modification time, a new size, or both.
+  writeFile("a.swiftdeps", "provides-top-level: [x]",
+            TimeValue(1390550760, 0));
+  writeFile("b.swiftdeps", "provides-top-level: [bb]");
+  writeFile("c.swiftdeps", "provides-top-level: [c]");
+
+  DependencyGraphCache cache;
+  ASSERT_TRUE(cache.loadFromString(data));
+  EXPECT_FALSE(cache.lookup(getPath("a.swiftdeps")).hasValue());
+  EXPECT_FALSE(cache.lookup(getPath("b.swiftdeps")).hasValue());
+  EXPECT_TRUE(cache.lookup(getPath("c.swiftdeps")).hasValue());
+
+  // The next cache picks up the new contents.
+  std::string newData = writeCache(cache, {"a.swiftdeps", "b.swiftdeps",
+                                           "c.swiftdeps"});
+  DependencyGraphCache newCache;
+  ASSERT_TRUE(newCache.loadFromString(newData));
+  auto a = newCache.lookup(getPath("a.swiftdeps"));
+  auto b = newCache.lookup(getPath("b.swiftdeps"));
+  auto c = newCache.lookup(getPath("c.swiftdeps"));
+  ASSERT_TRUE(a.hasValue());
+  ASSERT_TRUE(b.hasValue());
+  ASSERT_TRUE(c.hasValue());
+  EXPECT_EQ(std::vector<std::string>{"x"}, getNames(a));
+  EXPECT_EQ(std::vector<std::string>{"bb"}, getNames(b));
+  EXPECT_EQ(std::vector<std::string>{"c"}, getNames(c));
+}
+
+TEST_F(DependencyGraphCacheTest, UpToDate) {
+  writeFile("a.swiftdeps", "provides-top-level: [a]");
+  writeFile("b.swiftdeps", "provides-top-level: [b]");
+
+  std::string data = writeCache(DependencyGraphCache(),
+                                {"a.swiftdeps", "b.swiftdeps"});
+  DependencyGraphCache cache;
+  ASSERT_TRUE(cache.loadFromString(data));
+  EXPECT_TRUE(isUpToDate(cache, {"a.swiftdeps", "b.swiftdeps"}));
+
+  // A different set of files, or a changed file, needs a new cache.
+  EXPECT_FALSE(isUpToDate(cache, {"a.swiftdeps"}));
+  EXPECT_FALSE(isUpToDate(cache, {"a.swiftdeps", "c.swiftdeps"}));
+  writeFile("b.swiftdeps", "provides-top-level: [b]",
+            TimeValue(1390550760, 0));
+  EXPECT_FALSE(isUpToDate(cache, {"a.swiftdeps", "b.swiftdeps"}));
+}
+
+TEST_F(DependencyGraphCacheTest, MalformedFilesLeftOut) {
+  writeFile("a.swiftdeps", "provides-top-level: [a]");
+  writeFile("b.swiftdeps", "provides-top-level: {a: b}");
+
+  std::string data = writeCache(DependencyGraphCache(),
+                                {"a.swiftdeps", "b.swiftdeps"});
+
+  DependencyGraphCache cache;
+  ASSERT_TRUE(cache.loadFromString(data));
+  EXPECT_TRUE(cache.lookup(getPath("a.swiftdeps")).hasValue());
+  EXPECT_FALSE(cache.lookup(getPath("b.swiftdeps")).hasValue());
+}
+
+TEST_F(DependencyGraphCacheTest, RecentFilesLeftOut) {
+  writeFile("a.swiftdeps", "provides-top-level: [a]");
+  writeFile("b.swiftdeps", "provides-top-level: [b]", TimeValue::now());
+
+  std::string data = writeCache(DependencyGraphCache(),
+                                {"a.swiftdeps", "b.swiftdeps"});
+
+  DependencyGraphCache cache;
+  ASSERT_TRUE(cache.loadFromString(data));
+  EXPECT_TRUE(cache.lookup(getPath("a.swiftdeps")).hasValue());
+  EXPECT_FALSE(cache.lookup(getPath("b.swiftdeps")).hasValue());
+}
+
+TEST_F(DependencyGraphCacheTest, Malformed) {
+  writeFile("a.swiftdeps", "provides-top-level: [a]");
+  std::string data = writeCache(DependencyGraphCache(), {"a.swiftdeps"});
+
+  DependencyGraphCache cache;
+  EXPECT_FALSE(cache.loadFromString(""));
+  EXPECT_FALSE(cache.loadFromString("provides-top-level: [a]"));
+  for (size_t size = 4; size < data.size(); ++size) {
+    EXPECT_FALSE(cache.loadFromString(StringRef(data).substr(0, size)));
+    EXPECT_FALSE(cache.lookup(getPath("a.swiftdeps")).hasValue());
+  }
+
+  // A bad cache is the same as an empty one.
+  EXPECT_FALSE(cache.loadFromPath(getPath("missing")));
+  EXPECT_FALSE(cache.lookup(getPath("a.swiftdeps")).hasValue());
+  ASSERT_TRUE(cache.loadFromString(data));
+  EXPECT_TRUE(cache.lookup(getPath("a.swiftdeps")).hasValue());
+}
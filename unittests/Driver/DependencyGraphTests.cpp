@@ -1,4 +1,6 @@
 #include "swift/Driver/DependencyGraph.h"
+#include "swift/Driver/BinaryDependencyFile.h"
+#include "llvm/Support/raw_ostream.h"
 #include "gtest/gtest.h"
 
 using namespace swift;
@@ -790,3 +792,96 @@ TEST(DependencyGraph, ChainedExternalPreMarked) {
   EXPECT_TRUE(graph.isMarked(0));
   EXPECT_FALSE(graph.isMarked(1));
 }
+
+static std::string writeBinary(const BinaryDependencyFileWriter &writer) {
+  std::string result;
+  llvm::raw_string_ostream out(result);
+  writer.write(out);
+  return out.str();
+}
+
+TEST(DependencyGraph, BinaryChainedDependents) {
+  DependencyGraph<uintptr_t> graph;
+
+  BinaryDependencyFileWriter writer0;
+  writer0.addName(DependencySection::ProvidesTopLevel, "a");
+  writer0.addName(DependencySection::ProvidesNominal, "b");
+  writer0.addMember(DependencySection::ProvidesMember, "b", "bb");
+  writer0.setInterfaceHash("hash0");
+
+  BinaryDependencyFileWriter writer1;
+  writer1.addName(DependencySection::DependsTopLevel, "a");
+  writer1.addName(DependencySection::ProvidesTopLevel, "c");
+
+  BinaryDependencyFileWriter writer2;
+  writer2.addName(DependencySection::DependsTopLevel, "c");
+  writer2.addMember(DependencySection::DependsMember, "b", "bb",
+                    /*isCascading=*/false);
+
+  BinaryDependencyFileWriter writer3;
+  writer3.addName(DependencySection::DependsNominal, "b",
+                  /*isCascading=*/false);
+  writer3.addName(DependencySection::DependsExternal, "/foo");
+
+  EXPECT_EQ(graph.loadFromString(0, writeBinary(writer0)),
+            LoadResult::UpToDate);
+  EXPECT_EQ(graph.loadFromString(1, writeBinary(writer1)),
+            LoadResult::UpToDate);
+  EXPECT_EQ(graph.loadFromString(2, writeBinary(writer2)),
+            LoadResult::UpToDate);
+  EXPECT_EQ(graph.loadFromString(3, writeBinary(writer3)),
+            LoadResult::UpToDate);
+  EXPECT_TRUE(contains(graph.getExternalDependencies(), "/foo"));
+
+  SmallVector<uintptr_t, 4> marked;
+  graph.markTransitive(marked, 0);
+  EXPECT_EQ(3u, marked.size());
+  EXPECT_TRUE(contains(marked, 1u));
+  EXPECT_TRUE(contains(marked, 2u));
+  EXPECT_TRUE(contains(marked, 3u));
+
+  // A changed interface hash affects downstream files; an unchanged one
+  // does not.
+  writer0.setInterfaceHash("hash1");
+  EXPECT_EQ(graph.loadFromString(0, writeBinary(writer0)),
+            LoadResult::AffectsDownstream);
+  EXPECT_EQ(graph.loadFromString(0, writeBinary(writer0)),
+            LoadResult::UpToDate);
+}
+
+TEST(DependencyGraph, BinaryMixedWithYAML) {
+  DependencyGraph<uintptr_t> graph;
+
+  BinaryDependencyFileWriter writer;
+  writer.addName(DependencySection::ProvidesTopLevel, "a");
+  EXPECT_EQ(graph.loadFromString(0, writeBinary(writer)),
+            LoadResult::UpToDate);
+  EXPECT_EQ(graph.loadFromString(1, "depends-top-level: [a]"),
+            LoadResult::UpToDate);
+
+  SmallVector<uintptr_t, 4> marked;
+  graph.markTransitive(marked, 0);
+  EXPECT_EQ(1u, marked.size());
+  EXPECT_EQ(1u, marked.front());
+}
+
+TEST(DependencyGraph, BinaryMalformed) {
+  BinaryDependencyFileWriter writer;
+  writer.addName(DependencySection::DependsTopLevel, "a");
+  writer.addMember(DependencySection::DependsMember, "b", "c");
+  writer.setInterfaceHash("hash");
+  std::string data = writeBinary(writer);
+
+  // Every truncation of a valid file that keeps the magic is rejected.
+  for (size_t size = 4; size < data.size(); ++size) {
+    DependencyGraph<uintptr_t> graph;
+    std::string truncated(data.data(), size);
+    EXPECT_EQ(graph.loadFromString(0, truncated), LoadResult::HadError);
+  }
+
+  // So is a file with an unknown version.
+  std::string badVersion = data;
+  badVersion[4] = 2;
+  DependencyGraph<uintptr_t> graph;
+  EXPECT_EQ(graph.loadFromString(0, badVersion), LoadResult::HadError);
+}
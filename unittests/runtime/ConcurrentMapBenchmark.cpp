@@ -0,0 +1,201 @@
+//===--- ConcurrentMapBenchmark.cpp - ConcurrentMap benchmarks ------------===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2016 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+//
+// Multi-threaded microbenchmarks comparing the hash-table based ConcurrentMap
+// with the unbalanced binary tree it replaced. These are disabled by default;
+// run them with:
+//
+//   SwiftRuntimeTests --gtest_filter='ConcurrentMapBenchmark.*' \
+//     --gtest_also_run_disabled_tests
+//
+//===----------------------------------------------------------------------===//
+
+#include "swift/Runtime/Concurrent.h"
+#include "gtest/gtest.h"
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <thread>
+#include <vector>
+
+namespace {
+
+/// The binary tree that ConcurrentMap used to be, kept for comparison.
+template <class EntryTy> class ConcurrentTreeMap {
+  struct Node {
+    std::atomic<Node*> Left;
+    std::atomic<Node*> Right;
+    EntryTy Payload;
+
+    template <class... Args>
+    Node(Args &&... args)
+      : Left(nullptr), Right(nullptr), Payload(std::forward<Args>(args)...) {}
+
+    ~Node() {
+      ::delete Left.load(std::memory_order_relaxed);
+      ::delete Right.load(std::memory_order_relaxed);
+    }
+  };
+
+  std::atomic<Node*> Root;
+  std::atomic<Node*> LastSearch;
+
+public:
+  ConcurrentTreeMap() : Root(nullptr), LastSearch(nullptr) {}
+
+  ~ConcurrentTreeMap() {
+    ::delete Root.load(std::memory_order_relaxed);
+  }
+
+  template <class KeyTy>
+  EntryTy *find(const KeyTy &key) {
+    if (Node *last = LastSearch.load(std::memory_order_acquire)) {
+      if (last->Payload.compareWithKey(key) == 0)
+        return &last->Payload;
+    }
+
+    Node *node = Root.load(std::memory_order_acquire);
+    while (node) {
+      int comparisonResult = node->Payload.compareWithKey(key);
+      if (comparisonResult == 0) {
+        LastSearch.store(node, std::memory_order_release);
+        return &node->Payload;
+      } else if (comparisonResult < 0) {
+        node = node->Left.load(std::memory_order_acquire);
+      } else {
+        node = node->Right.load(std::memory_order_acquire);
+      }
+    }
+    return nullptr;
+  }
+
+  template <class KeyTy>
+  std::pair<EntryTy*, bool> getOrInsert(KeyTy key) {
+    if (Node *last = LastSearch.load(std::memory_order_acquire)) {
+      if (last->Payload.compareWithKey(key) == 0)
+        return { &last->Payload, false };
+    }
+
+    Node *newNode = nullptr;
+    auto edge = &Root;
+    while (true) {
+      Node *node = edge->load(std::memory_order_acquire);
+      if (node) {
+      searchFromNode:
+        int comparisonResult = node->Payload.compareWithKey(key);
+        if (comparisonResult == 0) {
+          ::delete newNode;
+          LastSearch.store(node, std::memory_order_release);
+          return { &node->Payload, false };
+        }
+        edge = (comparisonResult < 0 ? &node->Left : &node->Right);
+        continue;
+      }
+
+      if (!newNode)
+        newNode = new Node(key);
+
+      if (std::atomic_compare_exchange_strong_explicit(edge, &node, newNode,
+                                                  std::memory_order_release,
+                                                  std::memory_order_acquire)) {
+        LastSearch.store(newNode, std::memory_order_release);
+        return { &newNode->Payload, true };
+      }
+      goto searchFromNode;
+    }
+  }
+};
+
+struct Entry {
+  size_t Key;
+  Entry(size_t key) : Key(key) {}
+  long getKeyIntValueForDump() const { return Key; }
+  int compareWithKey(size_t key) const {
+    return (key == Key ? 0 : (key < Key ? -1 : 1));
+  }
+  static size_t getKeyHash(size_t key) {
+    // Runtime cache keys are pointers or precomputed hashes, so mixing them
+    // is the entry's job rather than the map's.
+    return key * 0x9E3779B97F4A7C15ULL;
+  }
+  static size_t getExtraAllocationSize(size_t key) { return 0; }
+};
+
+/// Map the i'th key to a distinct, pointer-like value. The keys are scrambled
+/// so that the tree gets a fair, roughly balanced shape; keys that arrive in
+/// address order degenerate it into a list.
+size_t keyFor(size_t i) {
+  return (size_t(uint32_t(i * 2654435761u)) + 0x10000) << 4;
+}
+
+const unsigned NumThreads = 8;
+const unsigned LookupsPerThread = 250000;
+
+/// Populate the map from all threads at once, each thread inserting the full
+/// key range starting at a different offset, then have every thread perform
+/// lookups of random existing keys. Prints the time spent in each phase.
+template <class MapTy>
+void runBenchmark(const char *name, size_t numEntries) {
+  MapTy map;
+
+  auto runThreads = [&](std::function<void(unsigned)> body) {
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (unsigned t = 0; t < NumThreads; ++t)
+      threads.emplace_back(body, t);
+    for (auto &thread : threads)
+      thread.join();
+    return std::chrono::duration<double, std::milli>(
+      std::chrono::steady_clock::now() - start).count();
+  };
+
+  double insertMs = runThreads([&](unsigned t) {
+    size_t offset = numEntries / NumThreads * t;
+    for (size_t i = 0; i < numEntries; ++i)
+      map.getOrInsert(keyFor((i + offset) % numEntries));
+  });
+
+  std::atomic<size_t> misses(0);
+  double lookupMs = runThreads([&](unsigned t) {
+    size_t state = t + 1;
+    size_t localMisses = 0;
+    for (unsigned i = 0; i < LookupsPerThread; ++i) {
+      state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+      if (!map.find(keyFor((state >> 17) % numEntries)))
+        ++localMisses;
+    }
+    misses += localMisses;
+  });
+
+  EXPECT_EQ(size_t(0), misses.load());
+  printf("%-12s %8zu entries: insert %9.2f ms, %u x %u lookups %9.2f ms\n",
+         name, numEntries, insertMs, NumThreads, LookupsPerThread, lookupMs);
+}
+
+void compare(size_t numEntries) {
+  runBenchmark<ConcurrentMap<Entry>>("hash table", numEntries);
+  runBenchmark<ConcurrentTreeMap<Entry>>("binary tree", numEntries);
+}
+
+} // end anonymous namespace
+
+TEST(ConcurrentMapBenchmark, DISABLED_Entries1K) {
+  compare(1000);
+}
+
+TEST(ConcurrentMapBenchmark, DISABLED_Entries100K) {
+  compare(100000);
+}
+
+TEST(ConcurrentMapBenchmark, DISABLED_Entries1M) {
+  compare(1000000);
+}
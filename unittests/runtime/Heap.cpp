@@ -0,0 +1,55 @@
+//===--- Heap.cpp - Swift runtime heap tests ------------------------------===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2016 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+
+#include "swift/Runtime/Heap.h"
+#include "swift/Runtime/HeapObject.h"
+#include "gtest/gtest.h"
+#include <string.h>
+#include <thread>
+#include <vector>
+
+using namespace swift;
+
+TEST(HeapTest, slowAllocAlignment) {
+  for (size_t alignMask : {0, 7, 15, 31, 63, 255, 4095}) {
+    for (size_t size = 1; size <= 4096; size += 13) {
+      void *ptr = swift_slowAlloc(size, alignMask);
+      EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(ptr) & alignMask);
+      EXPECT_LE(size, _swift_slowAllocUsableSize(ptr));
+      memset(ptr, 0xAB, size);
+      swift_slowDealloc(ptr, size, alignMask);
+    }
+  }
+}
+
+TEST(HeapTest, slowDeallocOnOtherThread) {
+  const size_t numAllocs = 10000;
+  std::vector<void *> ptrs(numAllocs);
+
+  std::thread allocator([&] {
+    for (size_t i = 0; i < numAllocs; ++i)
+      ptrs[i] = swift_slowAlloc(i % 256 + 1, 15);
+  });
+  allocator.join();
+
+  std::thread deallocator([&] {
+    for (size_t i = 0; i < numAllocs; ++i)
+      swift_slowDealloc(ptrs[i], i % 256 + 1, 15);
+  });
+  deallocator.join();
+
+  // Memory released by the other threads must be reusable from this one.
+  for (size_t i = 0; i < numAllocs; ++i)
+    ptrs[i] = swift_slowAlloc(i % 256 + 1, 15);
+  for (size_t i = 0; i < numAllocs; ++i)
+    swift_slowDealloc(ptrs[i], i % 256 + 1, 15);
+}
@@ -12,6 +12,7 @@
 
 #include "swift/Runtime/Metadata.h"
 #include "swift/Runtime/Concurrent.h"
+#include "swift/Runtime/Debug.h"
 #include "gtest/gtest.h"
 #include <iterator>
 #include <functional>
@@ -225,6 +226,7 @@ TEST(Concurrent, ConcurrentMap) {
     int compareWithKey(size_t key) const {
       return (key == Key ? 0 : (key < Key ? -1 : 1));
     }
+    static size_t getKeyHash(size_t key) { return key; }
     static size_t getExtraAllocationSize(size_t key) { return 0; }
   };
 
@@ -248,6 +250,51 @@ TEST(Concurrent, ConcurrentMap) {
   }
 }
 
+TEST(Concurrent, ConcurrentMapGrowth) {
+  const size_t numElem = 10000;
+
+  struct Entry {
+    size_t Key;
+    Entry(size_t key) : Key(key) {}
+    int compareWithKey(size_t key) const {
+      return (key == Key ? 0 : (key < Key ? -1 : 1));
+    }
+    // A deliberately poor hash, to exercise long probe sequences.
+    static size_t getKeyHash(size_t key) { return key >> 3; }
+    static size_t getExtraAllocationSize(size_t key) { return 0; }
+  };
+
+  ConcurrentMap<Entry> Map;
+
+  // Insert enough keys to force several migrations while other threads are
+  // inserting and looking up the same keys. Exactly one thread must win each
+  // insertion, and everyone must agree on the resulting entry.
+  std::vector<std::atomic<Entry *>> winners(numElem);
+  for (auto &winner : winners)
+    winner.store(nullptr);
+
+  auto results = RaceTest<int*, 16>(
+    [&]() -> int* {
+      for (size_t i = 0; i < numElem; i++) {
+        auto result = Map.getOrInsert(i);
+        if (result.second) {
+          Entry *expected = nullptr;
+          EXPECT_TRUE(winners[i].compare_exchange_strong(expected,
+                                                         result.first));
+        }
+        EXPECT_EQ(i, result.first->Key);
+        EXPECT_EQ(result.first, Map.find(i));
+      }
+      return nullptr;
+    }
+  );
+
+  for (size_t i = 0; i < numElem; i++) {
+    EXPECT_EQ(winners[i].load(), Map.find(i));
+  }
+  EXPECT_EQ(nullptr, Map.find(numElem));
+}
+
 
 TEST(MetadataAllocator, alloc_firstAllocationMoreThanPageSized) {
   using swift::MetadataAllocator;
@@ -306,6 +353,76 @@ TEST(MetadataTest, getGenericMetadata) {
     });
 }
 
+TEST(MetadataTest, getGenericMetadataRepeated) {
+  auto metadataTemplate = (GenericMetadata*) &MetadataTest1;
+
+  // Alternate between two argument lists, so that repeated lookups on each
+  // thread are answered from its lookaside cache and slots get reused.
+  void *args2[] = { &Global2 };
+  void *args3[] = { &Global3 };
+  auto first2 = swift_getGenericMetadata(metadataTemplate, args2);
+  auto first3 = swift_getGenericMetadata(metadataTemplate, args3);
+  EXPECT_NE(first2, first3);
+
+  RaceTest_ExpectEqual<const Metadata *>(
+    [&]() -> const Metadata * {
+      for (unsigned i = 0; i < 1000; ++i) {
+        EXPECT_EQ(first2, swift_getGenericMetadata(metadataTemplate, args2));
+        EXPECT_EQ(first3, swift_getGenericMetadata(metadataTemplate, args3));
+      }
+      return first2;
+    });
+}
+
+TEST(MetadataTest, dumpStatistics) {
+  auto metadataTemplate = (GenericMetadata*) &MetadataTest1;
+  // No other test instantiates the metadata for this argument.
+  static uint32_t StatisticsArg = 0;
+  void *args[] = { &StatisticsArg };
+
+  uint64_t instantiations =
+    _swift_getRuntimeStatistic("GenericCache.Instantiations");
+  uint64_t hits = _swift_getRuntimeStatistic("GenericCache.Hits");
+  uint64_t lookasideHits =
+    _swift_getRuntimeStatistic("GenericMetadataLookasideHits");
+  uint64_t lookasideMisses =
+    _swift_getRuntimeStatistic("GenericMetadataLookasideMisses");
+  EXPECT_EQ(~uint64_t(0), _swift_getRuntimeStatistic("NoSuchStatistic"));
+  EXPECT_EQ(~uint64_t(0), _swift_getRuntimeStatistic("GenericCache.Nothing"));
+
+  // The first lookup instantiates the metadata.
+  auto inst = swift_getGenericMetadata(metadataTemplate, args);
+  EXPECT_EQ(instantiations + 1,
+            _swift_getRuntimeStatistic("GenericCache.Instantiations"));
+  EXPECT_EQ(hits, _swift_getRuntimeStatistic("GenericCache.Hits"));
+  EXPECT_EQ(lookasideMisses + 1,
+            _swift_getRuntimeStatistic("GenericMetadataLookasideMisses"));
+
+  // The next lookup on this thread is answered by the lookaside cache.
+  EXPECT_EQ(inst, swift_getGenericMetadata(metadataTemplate, args));
+  EXPECT_EQ(lookasideHits + 1,
+            _swift_getRuntimeStatistic("GenericMetadataLookasideHits"));
+
+  // New threads find the metadata in the cache. Threads that count and then
+  // exit hand their counters to later threads, and none of the counts are
+  // lost.
+  const uint64_t numThreads = 64;
+  for (unsigned round = 1; round <= 2; ++round) {
+    EXPECT_EQ(inst, RaceTest_ExpectEqual<const Metadata *>(
+      [&]() -> const Metadata * {
+        return swift_getGenericMetadata(metadataTemplate, args);
+      }));
+    EXPECT_EQ(instantiations + 1,
+              _swift_getRuntimeStatistic("GenericCache.Instantiations"));
+    EXPECT_EQ(hits + round * numThreads,
+              _swift_getRuntimeStatistic("GenericCache.Hits"));
+    EXPECT_EQ(lookasideMisses + 1 + round * numThreads,
+              _swift_getRuntimeStatistic("GenericMetadataLookasideMisses"));
+  }
+
+  swift_runtime_dumpStatistics();
+}
+
 FullMetadata<ClassMetadata> MetadataTest2 = {
   { { nullptr }, { &_TWVBo } },
   { { { MetadataKind::Class } }, nullptr, 0, ClassFlags(), nullptr, 0, 0, 0, 0, 0 }
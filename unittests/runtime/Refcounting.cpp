@@ -13,6 +13,12 @@
 #include "swift/Runtime/HeapObject.h"
 #include "swift/Runtime/Metadata.h"
 #include "gtest/gtest.h"
+#include <vector>
+#if defined(__APPLE__)
+#include <malloc/malloc.h>
+#elif defined(__GLIBC__)
+#include <malloc.h>
+#endif
 
 using namespace swift;
 
@@ -117,6 +123,37 @@ TEST(RefcountingTest, retain_release_n) {
   EXPECT_EQ(1u, swift_retainCount(object));
 }
 
+TEST(RefcountingTest, nonatomic_retain_release) {
+  size_t value = 0;
+  auto object = allocTestObject(&value, 1);
+  EXPECT_EQ(0u, value);
+  swift_nonatomic_retain(object);
+  EXPECT_EQ(0u, value);
+  EXPECT_EQ(2u, swift_retainCount(object));
+  swift_nonatomic_release(object);
+  EXPECT_EQ(0u, value);
+  swift_nonatomic_release(object);
+  EXPECT_EQ(1u, value);
+}
+
+TEST(RefcountingTest, nonatomic_retain_release_n) {
+  size_t value = 0;
+  auto object = allocTestObject(&value, 1);
+  EXPECT_EQ(0u, value);
+  swift_nonatomic_retain_n(object, 32);
+  swift_nonatomic_retain(object);
+  EXPECT_EQ(0u, value);
+  EXPECT_EQ(34u, swift_retainCount(object));
+  swift_nonatomic_release_n(object, 31);
+  EXPECT_EQ(0u, value);
+  EXPECT_EQ(3u, swift_retainCount(object));
+  swift_nonatomic_release(object);
+  EXPECT_EQ(0u, value);
+  EXPECT_EQ(2u, swift_retainCount(object));
+  swift_nonatomic_release_n(object, 2);
+  EXPECT_EQ(1u, value);
+}
+
 TEST(RefcountingTest, unknown_retain_release_n) {
   size_t value = 0;
   auto object = allocTestObject(&value, 1);
@@ -152,3 +189,119 @@ TEST(RefcountingTest, unowned_retain_release_n) {
   swift_release(object);
   EXPECT_EQ(1u, value);
 }
+
+TEST(RefcountingTest, weak_does_not_retain_unowned) {
+  size_t value = 0;
+  auto object = allocTestObject(&value, 1);
+  WeakReference ref1, ref2;
+  swift_weakInit(&ref1, object);
+  swift_weakCopyInit(&ref2, &ref1);
+  EXPECT_EQ(1u, swift_unownedRetainCount(object));
+
+  auto loaded = swift_weakLoadStrong(&ref2);
+  EXPECT_EQ(object, loaded);
+  swift_release(loaded);
+
+  swift_weakDestroy(&ref1);
+  swift_weakDestroy(&ref2);
+  swift_release(object);
+  EXPECT_EQ(1u, value);
+}
+
+TEST(RefcountingTest, weak_load_after_dealloc) {
+  size_t value = 0;
+  auto object = allocTestObject(&value, 1);
+  WeakReference ref1, ref2, ref3;
+  swift_weakInit(&ref1, object);
+  swift_weakInit(&ref2, object);
+  swift_release(object);
+  EXPECT_EQ(1u, value);
+
+  EXPECT_EQ(nullptr, swift_weakLoadStrong(&ref1));
+  EXPECT_EQ(nullptr, ref1.Value);
+  swift_weakCopyInit(&ref3, &ref2);
+  EXPECT_EQ(nullptr, ref3.Value);
+  EXPECT_EQ(nullptr, swift_weakTakeStrong(&ref2));
+  swift_weakDestroy(&ref1);
+  swift_weakDestroy(&ref3);
+}
+
+TEST(RefcountingTest, weak_assign) {
+  size_t value1 = 0, value2 = 0;
+  auto object1 = allocTestObject(&value1, 1);
+  auto object2 = allocTestObject(&value2, 1);
+  WeakReference ref;
+  swift_weakInit(&ref, object1);
+  swift_weakAssign(&ref, object2);
+  swift_release(object1);
+  EXPECT_EQ(1u, value1);
+
+  auto loaded = swift_weakLoadStrong(&ref);
+  EXPECT_EQ(object2, loaded);
+  swift_release(loaded);
+
+  swift_weakAssign(&ref, nullptr);
+  EXPECT_EQ(nullptr, ref.Value);
+  swift_release(object2);
+  EXPECT_EQ(1u, value2);
+}
+
+#if defined(__APPLE__) || defined(__GLIBC__)
+
+static size_t getHeapBytesInUse() {
+#if defined(__APPLE__)
+  malloc_statistics_t stats;
+  malloc_zone_statistics(nullptr, &stats);
+  return stats.size_in_use;
+#else
+  struct mallinfo info = mallinfo();
+  return size_t(info.uordblks) + size_t(info.hblkhd);
+#endif
+}
+
+namespace {
+struct LargeTestObject : HeapObject {
+  char Payload[256 * 1024];
+};
+}
+
+static void destroyLargeTestObject(HeapObject *object) {
+  swift_deallocObject(object, sizeof(LargeTestObject),
+                      alignof(LargeTestObject) - 1);
+}
+
+static const FullMetadata<ClassMetadata> LargeTestClassObjectMetadata = {
+  { { &destroyLargeTestObject }, { &_TWVBo } },
+  { { { MetadataKind::Class } }, 0, /*rodata*/ 1,
+  ClassFlags::UsesSwift1Refcounting, nullptr, 0, 0, 0, 0, 0 }
+};
+
+// Weakly referenced objects must not keep their memory alive after they are
+// deallocated; only the weak reference side tables remain.
+TEST(RefcountingTest, weak_referenced_memory_is_freed) {
+  const size_t numObjects = 64;
+  std::vector<WeakReference> refs(numObjects);
+  std::vector<HeapObject *> objects;
+  for (size_t i = 0; i != numObjects; ++i) {
+    objects.push_back(swift_allocObject(&LargeTestClassObjectMetadata,
+                                        sizeof(LargeTestObject),
+                                        alignof(LargeTestObject) - 1));
+    swift_weakInit(&refs[i], objects.back());
+  }
+
+  size_t inUseBefore = getHeapBytesInUse();
+  for (auto object : objects)
+    swift_release(object);
+  size_t inUseAfter = getHeapBytesInUse();
+
+  EXPECT_LT(inUseAfter, inUseBefore);
+  EXPECT_GE(inUseBefore - inUseAfter,
+            numObjects * sizeof(LargeTestObject) / 2);
+
+  for (auto &ref : refs) {
+    EXPECT_EQ(nullptr, swift_weakLoadStrong(&ref));
+    swift_weakDestroy(&ref);
+  }
+}
+
+#endif
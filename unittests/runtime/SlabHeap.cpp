@@ -0,0 +1,191 @@
+//===--- SlabHeap.cpp - Swift runtime slab allocator tests ----------------===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2016 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+//
+// The runtime chooses its allocator once per process, on the first
+// allocation. These tests are therefore built into a test binary of their
+// own, which selects the slab allocator before anything is allocated.
+//
+//===----------------------------------------------------------------------===//
+
+#include "swift/Runtime/Heap.h"
+#include "swift/Runtime/HeapObject.h"
+#include "gtest/gtest.h"
+#include <set>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace swift;
+
+namespace {
+
+/// Sets SWIFT_RUNTIME_ALLOCATOR=slab before the first test runs, and
+/// restores the previous setting after the last one.
+class SlabAllocatorEnvironment : public ::testing::Environment {
+  bool HadSetting = false;
+  std::string Setting;
+
+public:
+  void SetUp() override {
+    if (const char *setting = getenv("SWIFT_RUNTIME_ALLOCATOR")) {
+      HadSetting = true;
+      Setting = setting;
+    }
+    setenv("SWIFT_RUNTIME_ALLOCATOR", "slab", 1);
+  }
+
+  void TearDown() override {
+    if (HadSetting)
+      setenv("SWIFT_RUNTIME_ALLOCATOR", Setting.c_str(), 1);
+    else
+      unsetenv("SWIFT_RUNTIME_ALLOCATOR");
+  }
+};
+
+::testing::Environment *const SlabEnvironment =
+  ::testing::AddGlobalTestEnvironment(new SlabAllocatorEnvironment);
+
+} // end anonymous namespace
+
+class SlabHeapTest : public ::testing::Test {
+protected:
+  /// The object sizes of the slab allocator's size classes.
+  static const std::vector<size_t> &getSizeClasses() {
+    static const std::vector<size_t> sizes = {
+      16, 32, 48, 64, 80, 96, 112, 128,
+      160, 192, 224, 256,
+      320, 384, 448, 512,
+      640, 768, 896, 1024
+    };
+    return sizes;
+  }
+
+  static size_t getExpectedUsableSize(size_t size) {
+    for (size_t classSize : getSizeClasses())
+      if (size <= classSize)
+        return classSize;
+    return 0;
+  }
+};
+
+TEST_F(SlabHeapTest, allocRoundsUpToSizeClass) {
+  for (size_t size = 1; size <= 1024; ++size) {
+    void *ptr = swift_slowAlloc(size, 15);
+    EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(ptr) & 15);
+    EXPECT_EQ(getExpectedUsableSize(size), _swift_slowAllocUsableSize(ptr));
+    memset(ptr, 0xAB, size);
+    swift_slowDealloc(ptr, size, 15);
+  }
+}
+
+TEST_F(SlabHeapTest, overAlignedAlloc) {
+  // Over-aligned allocations use a power-of-two class at least as big as
+  // the alignment.
+  for (size_t alignMask : {31, 63, 127, 255, 511, 1023}) {
+    for (size_t size : {1, 16, 100, 1024}) {
+      void *ptr = swift_slowAlloc(size, alignMask);
+      EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(ptr) & alignMask);
+      size_t usable = _swift_slowAllocUsableSize(ptr);
+      EXPECT_LE(size, usable);
+      EXPECT_LE(alignMask + 1, usable);
+      memset(ptr, 0xAB, size);
+      swift_slowDealloc(ptr, size, alignMask);
+    }
+  }
+}
+
+TEST_F(SlabHeapTest, largeAllocFallsBackToSystem) {
+  for (size_t size : {1025, 4096, 100000}) {
+    void *ptr = swift_slowAlloc(size, 15);
+    EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(ptr) & 15);
+    EXPECT_LE(size, _swift_slowAllocUsableSize(ptr));
+    memset(ptr, 0xAB, size);
+    swift_slowDealloc(ptr, size, 15);
+  }
+}
+
+TEST_F(SlabHeapTest, deallocatedMemoryIsReused) {
+  for (size_t classSize : getSizeClasses()) {
+    void *ptr = swift_slowAlloc(classSize, 15);
+    swift_slowDealloc(ptr, classSize, 15);
+
+    // Any size of the same class gets the object back.
+    size_t smallerSize = classSize - 15;
+    void *again = swift_slowAlloc(smallerSize, 15);
+    EXPECT_EQ(ptr, again);
+    swift_slowDealloc(again, smallerSize, 15);
+  }
+}
+
+TEST_F(SlabHeapTest, manyAllocsInEachSizeClass) {
+  // Enough objects to use up several chunks of every size class.
+  const size_t numAllocs = 1000;
+  for (size_t classSize : getSizeClasses()) {
+    std::vector<void *> ptrs(numAllocs);
+    for (size_t i = 0; i < numAllocs; ++i) {
+      ptrs[i] = swift_slowAlloc(classSize, 15);
+      memset(ptrs[i], int(i), classSize);
+    }
+
+    // No object was handed out twice, and none was overwritten.
+    std::set<void *> distinct(ptrs.begin(), ptrs.end());
+    EXPECT_EQ(numAllocs, distinct.size());
+    for (size_t i = 0; i < numAllocs; ++i) {
+      auto bytes = static_cast<unsigned char *>(ptrs[i]);
+      EXPECT_EQ((unsigned char)i, bytes[0]);
+      EXPECT_EQ((unsigned char)i, bytes[classSize - 1]);
+    }
+
+    for (size_t i = 0; i < numAllocs; ++i)
+      swift_slowDealloc(ptrs[i], classSize, 15);
+
+    // The freed objects are handed out again. At most the rest of the chunk
+    // that was being carved is new memory.
+    std::vector<void *> reused(numAllocs);
+    size_t numReused = 0;
+    for (size_t i = 0; i < numAllocs; ++i) {
+      reused[i] = swift_slowAlloc(classSize, 15);
+      numReused += distinct.count(reused[i]);
+    }
+    EXPECT_LT(0u, numReused);
+    EXPECT_LE(numAllocs - numReused, 65536 / classSize);
+    for (size_t i = 0; i < numAllocs; ++i)
+      swift_slowDealloc(reused[i], classSize, 15);
+  }
+}
+
+TEST_F(SlabHeapTest, slowDeallocOnOtherThread) {
+  const size_t numAllocs = 10000;
+  std::vector<void *> ptrs(numAllocs);
+
+  std::thread allocator([&] {
+    for (size_t i = 0; i < numAllocs; ++i)
+      ptrs[i] = swift_slowAlloc(i % 1024 + 1, 15);
+  });
+  allocator.join();
+
+  std::thread deallocator([&] {
+    for (size_t i = 0; i < numAllocs; ++i)
+      swift_slowDealloc(ptrs[i], i % 1024 + 1, 15);
+  });
+  deallocator.join();
+
+  for (size_t i = 0; i < numAllocs; ++i) {
+    ptrs[i] = swift_slowAlloc(i % 1024 + 1, 15);
+    EXPECT_EQ(getExpectedUsableSize(i % 1024 + 1),
+              _swift_slowAllocUsableSize(ptrs[i]));
+  }
+  for (size_t i = 0; i < numAllocs; ++i)
+    swift_slowDealloc(ptrs[i], i % 1024 + 1, 15);
+}
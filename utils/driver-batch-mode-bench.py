@@ -0,0 +1,120 @@
+#!/usr/bin/env python
+# ===--- driver-batch-mode-bench.py ------------------*- coding: utf-8 -*-===//
+#
+# This source file is part of the Swift.org open source project
+#
+# Copyright (c) 2014 - 2016 Apple Inc. and the Swift project authors
+# Licensed under Apache License v2.0 with Runtime Library Exception
+#
+# See http://swift.org/LICENSE.txt for license information
+# See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+
+# Measures the compile time of a synthetic many-file module with and without
+# the driver's -enable-batch-mode.
+#
+# The generated module has one type and one function per file, and each file
+# uses the declarations of a few others, so that every frontend invocation
+# has to parse and type-check part of the rest of the module. The harness
+# times a clean build, then an incremental build after touching a single
+# file, for each mode, and reports the best of several runs.
+
+from __future__ import print_function
+
+import argparse
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+import time
+
+
+def generate_module(directory, num_files):
+    paths = []
+    for i in range(num_files):
+        path = os.path.join(directory, 'file%d.swift' % i)
+        with open(path, 'w') as f:
+            f.write('public struct Type%d {\n' % i)
+            f.write('  public var value: Int\n')
+            f.write('  public init(value: Int) { self.value = value }\n')
+            f.write('}\n\n')
+            f.write('public func function%d(x: Int) -> Type%d {\n' % (i, i))
+            f.write('  var result = x\n')
+            for j in (i // 2, i // 3, i // 5):
+                if j != i:
+                    f.write('  result += function%d(x).value\n' % j)
+            f.write('  return Type%d(value: result)\n' % i)
+            f.write('}\n')
+        paths.append(path)
+    return paths
+
+
+def write_output_file_map(directory, paths):
+    path = os.path.join(directory, 'output-file-map.json')
+    with open(path, 'w') as f:
+        f.write('{\n  "": {"swift-dependencies": "%s"}' %
+                os.path.join(directory, 'main.swiftdeps'))
+        for source in paths:
+            base = os.path.splitext(source)[0]
+            f.write(',\n  "%s": {"object": "%s.o", "swift-dependencies": '
+                    '"%s.swiftdeps"}' % (source, base, base))
+        f.write('\n}\n')
+    return path
+
+
+def time_build(args, extra_flags):
+    start = time.time()
+    subprocess.check_call([args.swiftc] + extra_flags)
+    return time.time() - start
+
+
+def bench_mode(args, batch_mode):
+    directory = tempfile.mkdtemp(prefix='driver-batch-mode-bench-')
+    try:
+        paths = generate_module(directory, args.files)
+        output_file_map = write_output_file_map(directory, paths)
+        flags = ['-c', '-module-name', 'Bench', '-parse-as-library',
+                 '-incremental', '-output-file-map', output_file_map,
+                 '-j%d' % args.jobs] + paths
+        if batch_mode:
+            flags.append('-enable-batch-mode')
+
+        clean, incremental = [], []
+        for _ in range(args.iterations):
+            for path in os.listdir(directory):
+                if not path.endswith('.swift') and not path.endswith('.json'):
+                    os.remove(os.path.join(directory, path))
+            clean.append(time_build(args, flags))
+            # Touching the first file rebuilds it and every file that uses it.
+            os.utime(paths[0], None)
+            incremental.append(time_build(args, flags))
+        return min(clean), min(incremental)
+    finally:
+        shutil.rmtree(directory)
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description='Compare build times with and without driver batch mode.')
+    parser.add_argument('--swiftc', default='swiftc',
+                        help='the compiler driver to benchmark')
+    parser.add_argument('--files', type=int, default=1000,
+                        help='the number of files in the generated module')
+    parser.add_argument('--jobs', '-j', type=int, default=8,
+                        help='the number of parallel jobs')
+    parser.add_argument('--iterations', type=int, default=3,
+                        help='the number of runs per measurement')
+    args = parser.parse_args()
+
+    results = [('single file', bench_mode(args, batch_mode=False)),
+               ('batch mode', bench_mode(args, batch_mode=True))]
+
+    print('%d files, -j%d' % (args.files, args.jobs))
+    print('%-12s %12s %12s' % ('', 'clean (s)', 'incr. (s)'))
+    for name, (clean, incremental) in results:
+        print('%-12s %12.2f %12.2f' % (name, clean, incremental))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())